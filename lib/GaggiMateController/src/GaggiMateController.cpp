@@ -27,10 +27,14 @@ void GaggiMateController::setup() {
     this->valve = new SimpleRelay(_config.valvePin, _config.valveOn);
     this->alt = new SimpleRelay(_config.altPin, _config.altOn);
     if (_config.capabilites.pressure) {
-        pressureSensor = new PressureSensor(_config.pressureSda, _config.pressureScl, [this](float pressure) { /* noop */ });
+        pressureSensor = new PressureSensor(_config.pressureSda, _config.pressureScl, _config.pressureRdy,
+                                            [this](float pressure) { /* noop */ });
     }
     if (_config.capabilites.dimming) {
-        pump = new DimmedPump(_config.pumpPin, _config.pumpSensePin, pressureSensor);
+        auto dimmedPump = new DimmedPump(_config.pumpPin, _config.pumpSensePin, pressureSensor);
+        profileMutex = xSemaphoreCreateMutex();
+        dimmedPump->setLoopHook([this]() { runProfile(); });
+        pump = dimmedPump;
     } else {
         pump = new SimplePump(_config.pumpPin, _config.pumpOn, _config.capabilites.ssrPump ? 1000.0f : 5000.0f);
     }
@@ -73,6 +77,7 @@ void GaggiMateController::setup() {
     lastPingTime = millis();
 
     _ble.registerOutputControlCallback([this](bool valve, float pumpSetpoint, float heaterSetpoint) {
+        stopProfile();
         this->pump->setPower(pumpSetpoint);
         this->valve->set(valve);
         this->heater->setSetpoint(heaterSetpoint);
@@ -84,6 +89,7 @@ void GaggiMateController::setup() {
     });
     _ble.registerAdvancedOutputControlCallback(
         [this](bool valve, float heaterSetpoint, bool pressureTarget, float pressure, float flow) {
+            stopProfile();
             this->valve->set(valve);
             this->heater->setSetpoint(heaterSetpoint);
             if (!_config.capabilites.dimming) {
@@ -97,6 +103,21 @@ void GaggiMateController::setup() {
             }
             dimmedPump->setValveState(valve);
         });
+    if (_config.capabilites.dimming) {
+        _ble.registerProfileCallback([this](const BleProfileFrame &profile) {
+            xSemaphoreTake(profileMutex, portMAX_DELAY);
+            profileRunner.load(profile);
+            profileRunner.takeStatusChange();
+            xSemaphoreGive(profileMutex);
+        });
+        _ble.registerProfileControlCallback([this](uint8_t command, uint8_t phase) { handleProfileCommand(command, phase); });
+        _ble.registerProfileOutputCallback([this](float heaterSetpoint) { this->heater->setSetpoint(heaterSetpoint); });
+        if (ControlTrace::ENABLED) {
+            _ble.registerControlTraceCallback([this](uint32_t &first, BleControlTraceSample *samples, size_t capacity) {
+                return readControlTrace(first, samples, capacity);
+            });
+        }
+    }
     _ble.registerAltControlCallback([this](bool state) { this->alt->set(state); });
     _ble.registerPidControlCallback([this](float Kp, float Ki, float Kd) { this->heater->setTunings(Kp, Ki, Kd); });
     _ble.registerPumpModelCoeffsCallback([this](float a, float b, float c, float d) {
@@ -122,6 +143,7 @@ void GaggiMateController::setup() {
         auto dimmedPump = static_cast<DimmedPump *>(pump);
         dimmedPump->tare();
     });
+    lastLoopWake = xTaskGetTickCount();
     ESP_LOGI(LOG_TAG, "Initialization done");
 }
 
@@ -130,8 +152,19 @@ void GaggiMateController::loop() {
     if ((now - lastPingTime) / 1000 > PING_TIMEOUT_SECONDS) {
         handlePingTimeout();
     }
-    sendSensorData();
-    delay(250);
+    // Clients that support batches get a sample every SENSOR_SAMPLE_INTERVAL_MS, others a snapshot per update interval
+    if (_ble.isBatchingSensorData()) {
+        addSensorSample(now);
+    }
+    if (now - lastSensorUpdate >= SENSOR_UPDATE_INTERVAL_MS) {
+        lastSensorUpdate = now;
+        sendSensorData();
+    }
+    handleSerialCommands();
+    if (dumpingTrace) {
+        dumpControlTrace();
+    }
+    xTaskDelayUntil(&lastLoopWake, pdMS_TO_TICKS(SENSOR_SAMPLE_INTERVAL_MS));
 }
 
 void GaggiMateController::registerBoardConfig(ControllerConfig config) { configs.push_back(config); }
@@ -162,6 +195,7 @@ void GaggiMateController::detectAddon() {
 
 void GaggiMateController::handlePingTimeout() {
     ESP_LOGE(LOG_TAG, "Ping timeout detected. Turning off heater and pump for safety.\n");
+    stopProfile();
     // Turn off the heater and pump as a safety measure
     this->heater->setSetpoint(0);
     this->pump->setPower(0);
@@ -171,6 +205,7 @@ void GaggiMateController::handlePingTimeout() {
 
 void GaggiMateController::thermalRunawayShutdown() {
     ESP_LOGE(LOG_TAG, "Thermal runaway detected! Turning off heater and pump!\n");
+    stopProfile();
     // Turn off the heater and pump immediately
     this->heater->setSetpoint(0);
     this->pump->setPower(0);
@@ -180,12 +215,150 @@ void GaggiMateController::thermalRunawayShutdown() {
 }
 
 void GaggiMateController::sendSensorData() {
+    const bool batching = _ble.isBatchingSensorData();
     if (_config.capabilites.pressure) {
         auto dimmedPump = static_cast<DimmedPump *>(pump);
-        _ble.sendSensorData(this->thermocouple->read(), this->pressureSensor->getPressure(), dimmedPump->getPuckFlow(),
-                            dimmedPump->getPumpFlow(), dimmedPump->getPuckResistance());
+        if (!batching) {
+            _ble.sendSensorData(this->thermocouple->read(), this->pressureSensor->getPressure(), dimmedPump->getPuckFlow(),
+                                dimmedPump->getPumpFlow(), dimmedPump->getPuckResistance());
+        }
         _ble.sendVolumetricMeasurement(dimmedPump->getCoffeeVolume());
-    } else {
+    } else if (!batching) {
         _ble.sendSensorData(this->thermocouple->read(), 0.0f, 0.0f, 0.0f, 0.0f);
     }
 }
+
+void GaggiMateController::addSensorSample(unsigned long timestamp) {
+    if (_config.capabilites.pressure) {
+        auto dimmedPump = static_cast<DimmedPump *>(pump);
+        _ble.addSensorSample(timestamp, this->thermocouple->read(), this->pressureSensor->getPressure(),
+                             dimmedPump->getPuckFlow(), dimmedPump->getPumpFlow(), dimmedPump->getPuckResistance());
+    } else {
+        _ble.addSensorSample(timestamp, this->thermocouple->read(), 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+}
+
+// Outputs and the status notification follow with the next pump control loop, see runProfile
+void GaggiMateController::handleProfileCommand(uint8_t command, uint8_t phase) {
+    xSemaphoreTake(profileMutex, portMAX_DELAY);
+    switch (command) {
+    case BLE_PROFILE_START:
+        if (!profileRunner.start(millis())) {
+            ESP_LOGW(LOG_TAG, "No profile loaded");
+        }
+        break;
+    case BLE_PROFILE_STOP:
+        profileRunner.stop();
+        break;
+    case BLE_PROFILE_ADVANCE:
+        profileRunner.advance(phase, millis());
+        break;
+    default:
+        ESP_LOGW(LOG_TAG, "Unknown profile command %d", command);
+        break;
+    }
+    xSemaphoreGive(profileMutex);
+}
+
+// Called from the pump control loop, applies the setpoints of the running profile phase
+void GaggiMateController::runProfile() {
+    auto dimmedPump = static_cast<DimmedPump *>(pump);
+    ProfileSetpoints setpoints{};
+    xSemaphoreTake(profileMutex, portMAX_DELAY);
+    const bool running = profileRunner.update(millis(), pressureSensor->getPressure(), dimmedPump->getPumpFlow(), setpoints);
+    const bool statusChanged = profileRunner.takeStatusChange();
+    const uint8_t state = profileRunner.getState();
+    const uint8_t phase = profileRunner.getPhase();
+    xSemaphoreGive(profileMutex);
+
+    if (statusChanged) {
+        _ble.sendProfileStatus(state, phase);
+    }
+    if (!running) {
+        if (statusChanged) {
+            // Finished or stopped, keep the pump off until the display takes over again
+            dimmedPump->setPower(0);
+            this->valve->set(false);
+            dimmedPump->setValveState(false);
+        }
+        return;
+    }
+    if (statusChanged) {
+        this->valve->set(setpoints.valve);
+        dimmedPump->setValveState(setpoints.valve);
+    }
+    if (setpoints.simple) {
+        dimmedPump->setPower(setpoints.pumpPower);
+    } else if (setpoints.pressureTarget) {
+        dimmedPump->setPressureTarget(setpoints.pressure, setpoints.flow);
+    } else {
+        dimmedPump->setFlowTarget(setpoints.flow, setpoints.pressure);
+    }
+}
+
+// Direct output commands and safety shutdowns take over from a running profile. The display is told, so a brew it
+// follows on this board ends there as well.
+void GaggiMateController::stopProfile() {
+    if (profileMutex == nullptr) {
+        return;
+    }
+    xSemaphoreTake(profileMutex, portMAX_DELAY);
+    profileRunner.stop();
+    const bool statusChanged = profileRunner.takeStatusChange();
+    const uint8_t state = profileRunner.getState();
+    const uint8_t phase = profileRunner.getPhase();
+    xSemaphoreGive(profileMutex);
+
+    if (statusChanged) {
+        _ble.sendProfileStatus(state, phase);
+    }
+}
+
+// Serial console: 't' prints the buffered control trace
+void GaggiMateController::handleSerialCommands() {
+    while (Serial.available() > 0) {
+        if (Serial.read() != 't') {
+            continue;
+        }
+        if (!ControlTrace::ENABLED || !_config.capabilites.dimming) {
+            Serial.println("Control trace not available, build the controller-trace environment");
+            continue;
+        }
+        serialTraceCursor = 0;
+        dumpingTrace = true;
+        Serial.println("tick\tsetpoint\tpressure\tdP/dt\tresistance\tpuckFlow\tcovariance\tpumpFlow\tduty");
+    }
+}
+
+// A few lines per loop so the sensor samples and the ping timeout keep running while the trace is printed
+void GaggiMateController::dumpControlTrace() {
+    const ControlTrace &trace = static_cast<DimmedPump *>(pump)->getControlTrace();
+    ControlTraceRecord records[CONTROL_TRACE_DUMP_LINES];
+    const size_t count = trace.read(serialTraceCursor, records, CONTROL_TRACE_DUMP_LINES);
+    const uint32_t first = serialTraceCursor - count;
+    for (size_t i = 0; i < count; i++) {
+        const ControlTraceRecord &r = records[i];
+        Serial.printf("%lu\t%.3f\t%.3f\t%.3f\t%.4e\t%.3f\t%.4e\t%.3f\t%.1f\n", static_cast<unsigned long>(first + i),
+                      r.setpoint, r.pressure, r.pressureDerivative, r.resistance, r.puckFlow, r.covariance, r.pumpFlow, r.duty);
+    }
+    if (serialTraceCursor == trace.ticks()) {
+        dumpingTrace = false;
+    }
+}
+
+// The trace records are copied straight into the BLE frame, both are the same eight floats in the same order
+static_assert(sizeof(ControlTraceRecord) == sizeof(BleControlTraceSample), "Control trace sample layout changed");
+static_assert(offsetof(ControlTraceRecord, setpoint) == offsetof(BleControlTraceSample, setpoint) &&
+                  offsetof(ControlTraceRecord, resistance) == offsetof(BleControlTraceSample, resistance) &&
+                  offsetof(ControlTraceRecord, duty) == offsetof(BleControlTraceSample, duty),
+              "Control trace sample layout changed");
+
+// Called from the BLE host task when the client reads the control trace characteristic. samples points into the
+// 4 byte aligned frame buffer of the BLE server, so nothing is copied on the host task stack.
+size_t GaggiMateController::readControlTrace(uint32_t &first, BleControlTraceSample *samples, size_t capacity) {
+    const ControlTrace &trace = static_cast<DimmedPump *>(pump)->getControlTrace();
+    const size_t count = trace.read(bleTraceCursor, reinterpret_cast<ControlTraceRecord *>(samples),
+                                    std::min(capacity, BLE_CONTROL_TRACE_MAX_SAMPLES));
+    first = bleTraceCursor - count;
+    return count;
+}
@@ -2,6 +2,7 @@
 #define GAGGIMATECONTROLLER_H
 #include "ControllerConfig.h"
 #include "NimBLEServerController.h"
+#include "ProfileRunner.h"
 #include <peripherals/DigitalInput.h>
 #include <peripherals/DistanceSensor.h>
 #include <peripherals/Heater.h>
@@ -13,6 +14,9 @@
 #include <vector>
 
 constexpr double PING_TIMEOUT_SECONDS = 20.0;
+constexpr unsigned long SENSOR_SAMPLE_INTERVAL_MS = 30;  // batched samples for the display, a few pump control steps
+constexpr unsigned long SENSOR_UPDATE_INTERVAL_MS = 250; // single sensor notifications and volumetric updates
+constexpr size_t CONTROL_TRACE_DUMP_LINES = 4;           // per loop, about what 115200 baud sends in 30 ms
 
 constexpr int DETECT_EN_PIN = 40;
 constexpr int DETECT_VALUE_PIN = 11;
@@ -33,6 +37,13 @@ class GaggiMateController {
     void startPidAutotune(void);
     void stopPidAutotune(void);
     void sendSensorData(void);
+    void addSensorSample(unsigned long timestamp);
+    void handleProfileCommand(uint8_t command, uint8_t phase);
+    void runProfile(void);
+    void stopProfile(void);
+    void handleSerialCommands(void);
+    void dumpControlTrace(void);
+    size_t readControlTrace(uint32_t &first, BleControlTraceSample *samples, size_t capacity);
 
     ControllerConfig _config = ControllerConfig{};
     NimBLEServerController _ble;
@@ -50,7 +61,18 @@ class GaggiMateController {
 
     std::vector<ControllerConfig> configs;
 
+    // Accessed from the BLE host task and the pump control loop
+    ProfileRunner profileRunner;
+    SemaphoreHandle_t profileMutex = nullptr;
+
     unsigned long lastPingTime = 0;
+    unsigned long lastSensorUpdate = 0;
+    TickType_t lastLoopWake = 0;
+
+    // Next control trace tick to send over BLE and to print on the serial console
+    uint32_t bleTraceCursor = 0;
+    uint32_t serialTraceCursor = 0;
+    bool dumpingTrace = false;
 
     const char *LOG_TAG = "GaggiMateController";
 };
@@ -0,0 +1,187 @@
+#include "ProfileRunner.h"
+
+namespace {
+constexpr float PHASE_TIME_SCALE = 10.0f; // BleProfilePhase durations are in 0.1 s
+
+float applyEasing(float t, uint8_t type) {
+    if (t <= 0.0f)
+        return 0.0f;
+    if (t >= 1.0f)
+        return 1.0f;
+    switch (type) {
+    case BLE_TRANSITION_LINEAR:
+        return t;
+    case BLE_TRANSITION_EASE_IN:
+        return t * t;
+    case BLE_TRANSITION_EASE_OUT:
+        return 1.0f - (1.0f - t) * (1.0f - t);
+    case BLE_TRANSITION_EASE_IN_OUT:
+        return (t < 0.5f) ? 2.0f * t * t : 1.0f - 2.0f * (1.0f - t) * (1.0f - t);
+    case BLE_TRANSITION_INSTANT:
+    default:
+        return 1.0f;
+    }
+}
+
+bool isReached(const BleProfileTarget &target, float input) {
+    return (target.type & BLE_TARGET_FLAG_GTE) ? input >= target.value : input <= target.value;
+}
+} // namespace
+
+void ProfileRunner::load(const BleProfileFrame &profile) {
+    stop();
+    this->profile = profile;
+    loaded = profile.phaseCount > 0;
+}
+
+bool ProfileRunner::start(unsigned long now) {
+    if (!loaded) {
+        return false;
+    }
+    waterPumped = 0.0f;
+    phaseStartPressure = 0.0f;
+    phaseStartFlow = 0.0f;
+    state = BLE_PROFILE_RUNNING;
+    lastUpdate = now;
+    enterPhase(0, now);
+    return true;
+}
+
+void ProfileRunner::stop() {
+    if (state != BLE_PROFILE_IDLE) {
+        state = BLE_PROFILE_IDLE;
+        statusChanged = true;
+    }
+}
+
+void ProfileRunner::advance(uint8_t phase, unsigned long now) {
+    // A late request for a phase that already ended must not skip the next one
+    if (isRunning() && phase == this->phase) {
+        finishPhase(now);
+    }
+}
+
+bool ProfileRunner::update(unsigned long now, float pressure, float flow, ProfileSetpoints &setpoints) {
+    if (!isRunning()) {
+        return false;
+    }
+    currentPressure = pressure;
+    currentFlow = flow;
+    waterPumped += flow * static_cast<float>(now - lastUpdate) / 1000.0f;
+    lastUpdate = now;
+    while (isRunning() && isPhaseFinished(now)) {
+        finishPhase(now);
+    }
+    if (!isRunning()) {
+        return false;
+    }
+    const BleProfilePhase &current = profile.phases[phase];
+    setpoints.valve = current.flags & BLE_PHASE_FLAG_VALVE;
+    setpoints.simple = current.flags & BLE_PHASE_FLAG_SIMPLE_PUMP;
+    setpoints.pressureTarget = current.flags & BLE_PHASE_FLAG_PRESSURE_TARGET;
+    setpoints.pumpPower = current.pumpSimple;
+    setpoints.pressure = getPressure(now);
+    setpoints.flow = getFlow(now);
+    return true;
+}
+
+bool ProfileRunner::takeStatusChange() {
+    const bool changed = statusChanged;
+    statusChanged = false;
+    return changed;
+}
+
+void ProfileRunner::enterPhase(uint8_t index, unsigned long now) {
+    const BleProfilePhase &next = profile.phases[index];
+    const bool adaptive = next.flags & BLE_PHASE_FLAG_ADAPTIVE;
+    // Non adaptive transitions start where the setpoints of the previous phase ended
+    if (index > 0) {
+        phaseStartPressure = adaptive ? currentPressure : getPressure(now);
+        phaseStartFlow = adaptive ? currentFlow : getFlow(now);
+    } else if (adaptive) {
+        phaseStartPressure = currentPressure;
+        phaseStartFlow = currentFlow;
+    }
+    phase = index;
+    phaseStarted = now;
+    waterPumped = 0.0f;
+    statusChanged = true;
+
+    if (next.flags & BLE_PHASE_FLAG_SIMPLE_PUMP) {
+        effectivePressure = 0.0f;
+        effectiveFlow = 0.0f;
+        return;
+    }
+    // -1 keeps the value at the start of the phase
+    effectivePressure = next.pressure == -100 ? phaseStartPressure : bleFloat(next.pressure, BLE_SCALE_TARGET);
+    effectiveFlow = next.flow == -100 ? phaseStartFlow : bleFloat(next.flow, BLE_SCALE_TARGET);
+    if (next.flags & BLE_PHASE_FLAG_PRESSURE_TARGET) {
+        phaseStartFlow = effectiveFlow;
+    } else {
+        phaseStartPressure = effectivePressure;
+    }
+}
+
+void ProfileRunner::finishPhase(unsigned long now) {
+    if (phase + 1 < profile.phaseCount) {
+        enterPhase(phase + 1, now);
+    } else {
+        state = BLE_PROFILE_FINISHED;
+        statusChanged = true;
+    }
+}
+
+bool ProfileRunner::isPhaseFinished(unsigned long now) const {
+    const BleProfilePhase &current = profile.phases[phase];
+    for (uint8_t i = 0; i < current.targetCount && i < BLE_PROFILE_MAX_TARGETS; i++) {
+        const BleProfileTarget &target = current.targets[i];
+        switch (target.type & BLE_TARGET_TYPE_MASK) {
+        case BLE_TARGET_PRESSURE:
+            if (isReached(target, currentPressure)) {
+                return true;
+            }
+            break;
+        case BLE_TARGET_FLOW:
+            if (isReached(target, currentFlow)) {
+                return true;
+            }
+            break;
+        case BLE_TARGET_PUMPED:
+            if (isReached(target, waterPumped)) {
+                return true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    if (current.flags & BLE_PHASE_FLAG_NO_DURATION) {
+        return false;
+    }
+    return static_cast<float>(now - phaseStarted) > static_cast<float>(current.duration) * 1000.0f / PHASE_TIME_SCALE;
+}
+
+float ProfileRunner::getTransitionAlpha(unsigned long now) const {
+    const BleProfilePhase &current = profile.phases[phase];
+    // If the transition has no duration, use the phase duration
+    const uint16_t duration = current.transitionDuration > 0 ? current.transitionDuration : current.duration;
+    if (current.transition == BLE_TRANSITION_INSTANT || duration == 0) {
+        return 1.0f;
+    }
+    const float t = static_cast<float>(now - phaseStarted) / (static_cast<float>(duration) * 1000.0f / PHASE_TIME_SCALE);
+    return applyEasing(t, current.transition);
+}
+
+float ProfileRunner::getPressure(unsigned long now) const {
+    if (profile.phases[phase].flags & BLE_PHASE_FLAG_SIMPLE_PUMP) {
+        return 0.0f;
+    }
+    return phaseStartPressure + (effectivePressure - phaseStartPressure) * getTransitionAlpha(now);
+}
+
+float ProfileRunner::getFlow(unsigned long now) const {
+    if (profile.phases[phase].flags & BLE_PHASE_FLAG_SIMPLE_PUMP) {
+        return 0.0f;
+    }
+    return phaseStartFlow + (effectiveFlow - phaseStartFlow) * getTransitionAlpha(now);
+}
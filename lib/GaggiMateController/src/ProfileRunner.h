@@ -0,0 +1,63 @@
+#ifndef PROFILERUNNER_H
+#define PROFILERUNNER_H
+
+#include <BleProfile.h>
+
+// Pump and valve setpoints of the running phase
+struct ProfileSetpoints {
+    bool valve;
+    bool simple; // pumpPower applies, pressure and flow otherwise
+    bool pressureTarget;
+    float pumpPower;
+    float pressure;
+    float flow;
+};
+
+// Runs a profile uploaded by the display, see BleProfile.h. Phases, transitions and targets behave like the
+// BrewProcess of the display, except for volumetric targets which the display reports with advance().
+//
+// Not thread safe, callers serialize access. Times are millis() values passed in by the caller.
+class ProfileRunner {
+  public:
+    void load(const BleProfileFrame &profile);
+    bool start(unsigned long now);
+    void stop();
+    void advance(uint8_t phase, unsigned long now);
+
+    // Called every pump control loop with the latest measurements. Returns false if no profile is running.
+    bool update(unsigned long now, float pressure, float flow, ProfileSetpoints &setpoints);
+
+    bool isRunning() const { return state == BLE_PROFILE_RUNNING; }
+    uint8_t getState() const { return state; }
+    uint8_t getPhase() const { return phase; }
+
+    // True once after the state or phase changed
+    bool takeStatusChange();
+
+  private:
+    void enterPhase(uint8_t index, unsigned long now);
+    void finishPhase(unsigned long now);
+    bool isPhaseFinished(unsigned long now) const;
+    float getTransitionAlpha(unsigned long now) const;
+    float getPressure(unsigned long now) const;
+    float getFlow(unsigned long now) const;
+
+    BleProfileFrame profile{};
+    bool loaded = false;
+    uint8_t state = BLE_PROFILE_IDLE;
+    uint8_t phase = 0;
+    bool statusChanged = false;
+
+    unsigned long phaseStarted = 0;
+    unsigned long lastUpdate = 0;
+    float waterPumped = 0.0f;
+    float currentPressure = 0.0f;
+    float currentFlow = 0.0f;
+
+    float phaseStartPressure = 0.0f;
+    float phaseStartFlow = 0.0f;
+    float effectivePressure = 0.0f;
+    float effectiveFlow = 0.0f;
+};
+
+#endif // PROFILERUNNER_H
@@ -4,7 +4,8 @@
 
 DimmedPump::DimmedPump(uint8_t ssr_pin, uint8_t sense_pin, PressureSensor *pressure_sensor)
     : _ssr_pin(ssr_pin), _sense_pin(sense_pin), _psm(_sense_pin, _ssr_pin, 100, FALLING, 2, 4), _pressureSensor(pressure_sensor),
-      _pressureController(0.03f, &_ctrlPressure, &_ctrlFlow, &_currentPressure, &_controllerPower, &_valveStatus) {
+      _pressureController(PRESSURE_SAMPLE_INTERVAL_US / 1000000.0f, &_ctrlPressure, &_ctrlFlow, &_currentPressure,
+                          &_controllerPower, &_valveStatus) {
     _psm.set(0);
 }
 
@@ -13,13 +14,34 @@ void DimmedPump::setup() {
     if (_cps > 70) {
         _cps = _cps / 2;
     }
+    if (_cps > 0) {
+        _pressureController.setDeliveredPower(&_deliveredPower);
+    }
     xTaskCreate(loopTask, "DimmedPump::loop", configMINIMAL_STACK_SIZE * 4, this, 1, &taskHandle);
 }
 
 void DimmedPump::loop() {
-    _currentPressure = _pressureSensor->getRawPressure();
-    updatePower();
-    _currentFlow = 0.1f * _pressureController.getPumFlowRate()  + 0.9f * _currentFlow;
+    PressureSample sample{};
+    if (_pressureSensor->waitForSample(sample, pdMS_TO_TICKS(PUMP_SAMPLE_TIMEOUT_MS))) {
+        _currentPressure = sample.pressure;
+    } else {
+        // No sensor reading, keep the pump going on the last one
+        sample.time = micros();
+    }
+    // Signed, a sample taken before a step that ran on the timeout is older than that step and counts as MIN_STEP
+    const auto elapsed = static_cast<int32_t>(sample.time - _lastStepTime);
+    const float dt =
+        _lastStepTime ? std::clamp(elapsed / 1000000.0f, MIN_STEP, MAX_STEP) : PRESSURE_SAMPLE_INTERVAL_US / 1000000.0f;
+    if (_lastStepTime == 0 || elapsed > 0) {
+        _lastStepTime = sample.time;
+    }
+    countPumpStrokes(dt);
+    if (_loopHook) {
+        _loopHook();
+    }
+    updatePower(dt);
+    const float alpha = dt / (FLOW_FILTER_TAU + dt);
+    _currentFlow = alpha * _pressureController.getPumFlowRate() + (1.0f - alpha) * _currentFlow;
 }
 
 void DimmedPump::setPower(float setpoint) {
@@ -49,21 +71,35 @@ void DimmedPump::tare() {
 
 void DimmedPump::loopTask(void *arg) {
     auto *pump = static_cast<DimmedPump *>(arg);
-    TickType_t lastWake = xTaskGetTickCount();
     while (true) {
         pump->loop();
-        xTaskDelayUntil(&lastWake, pdMS_TO_TICKS(30));
     }
 }
 
-void DimmedPump::updatePower() {
-    _pressureController.update(static_cast<PressureController::ControlMode>(_mode));
+void DimmedPump::updatePower(float dt) {
+    _pressureController.update(static_cast<PressureController::ControlMode>(_mode), dt);
     if (_mode != ControlMode::POWER) {
         _power = _controllerPower;
     }
+    // Only latched by the PSM at the next zero crossing, a cycle always runs on one power
     _psm.set(static_cast<int>(_power));
 }
 
+// The PSM decides once per mains cycle whether the pump runs for that cycle and counts the cycles it ran. A stroke
+// counted during this step can carry on into the next ones, so the delivered power never exceeds 100 %.
+void DimmedPump::countPumpStrokes(float dt) {
+    // No mains frequency detected, the controller runs on its commanded power instead
+    if (_cps <= 0) {
+        return;
+    }
+    const long strokes = _psm.getCounter();
+    _pumpOnTime += static_cast<float>(strokes - _pumpStrokes) / static_cast<float>(_cps);
+    _pumpStrokes = strokes;
+    const float onTime = std::min(_pumpOnTime, dt);
+    _pumpOnTime -= onTime;
+    _deliveredPower = 100.0f * onTime / dt;
+}
+
 void DimmedPump::setFlowTarget(float targetFlow, float pressureLimit) {
     _mode = ControlMode::FLOW;
     _ctrlFlow = targetFlow;
@@ -5,15 +5,18 @@
 #include "PressureSensor.h"
 #include "Pump.h"
 #include <Arduino.h>
+#include <functional>
 
 class DimmedPump : public Pump {
   public:
     enum class ControlMode { POWER, PRESSURE, FLOW };
+    using loop_hook_t = std::function<void()>;
 
     DimmedPump(uint8_t ssr_pin, uint8_t sense_pin, PressureSensor *pressureSensor);
     ~DimmedPump() = default;
 
     void setup() override;
+    // One control step per pressure sample, or after PUMP_SAMPLE_TIMEOUT_MS without one
     void loop() override;
     void setPower(float setpoint) override;
 
@@ -30,6 +33,9 @@ class DimmedPump : public Pump {
     void stop();
     void fullPower();
     void setValveState(bool open);
+    // Runs in the pump control loop after the pressure was read and before the pump power is updated
+    void setLoopHook(const loop_hook_t &hook) { _loopHook = hook; }
+    const ControlTrace &getControlTrace() const { return _pressureController.getTrace(); }
 
   private:
     uint8_t _ssr_pin;
@@ -47,16 +53,26 @@ class DimmedPump : public Pump {
     float _currentPressure = 0.0f;
     float _currentFlow = 0.0f;
     float _lastPressure = 0.0f;
+    uint32_t _lastStepTime = 0; // micros() of the pressure sample of the previous step
+    long _pumpStrokes = 0;      // PSM counter at the previous step
+    float _pumpOnTime = 0.0f;   // s of counted strokes not yet attributed to a step
+    float _deliveredPower = 0.0f;
     int _valveStatus = 0;
     int _cps = MAX_FREQ;
 
     float _opvPressure = 0.0f;
+    loop_hook_t _loopHook = nullptr;
 
     static constexpr float BASE_FLOW_RATE = 0.25f;
     static constexpr float MAX_PRESSURE = 15.0f;
     static constexpr float MAX_FREQ = 60.0f;
+    static constexpr int PUMP_SAMPLE_TIMEOUT_MS = 30;
+    static constexpr float MIN_STEP = 0.001f;       // s
+    static constexpr float MAX_STEP = 0.1f;         // s, bounds the controller integrators after a stall
+    static constexpr float FLOW_FILTER_TAU = 0.27f; // s
 
-    void updatePower();
+    void updatePower(float dt);
+    void countPumpStrokes(float dt);
     void onPressureUpdate(float pressure);
 
     const char *LOG_TAG = "DimmedPump";
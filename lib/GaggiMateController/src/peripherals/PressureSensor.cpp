@@ -1,54 +1,100 @@
 #include "PressureSensor.h"
 #include "Wire.h"
 
-PressureSensor::PressureSensor(uint8_t sda_pin, uint8_t scl_pin, const pressure_callback_t &callback, float pressure_scale,
-                               float voltage_floor, float voltage_ceil)
-    : _sda_pin(sda_pin), _scl_pin(scl_pin), _pressure_scale(pressure_scale), _callback(callback), taskHandle(nullptr) {
+PressureSensor::PressureSensor(uint8_t sda_pin, uint8_t scl_pin, uint8_t ready_pin, const pressure_callback_t &callback,
+                               float pressure_scale, float voltage_floor, float voltage_ceil)
+    : _sda_pin(sda_pin), _scl_pin(scl_pin), _ready_pin(ready_pin), _pressure_scale(pressure_scale), _callback(callback),
+      taskHandle(nullptr) {
     _adc_floor = static_cast<int16_t>(voltage_floor / ADC_STEP);
     _pressure_adc_range = (voltage_ceil - voltage_floor) / ADC_STEP;
     _pressure_step = pressure_scale / _pressure_adc_range;
+    // Created here since the pump control loop may start waiting before setup
+    _samples = xQueueCreate(PRESSURE_SAMPLE_QUEUE_LENGTH, sizeof(PressureSample));
 }
 
 void PressureSensor::setup() {
-    Wire1.begin(_sda_pin, _scl_pin);
-    ESP_LOGV(LOG_TAG, "Initializing pressure sensor on SDA: %d, SCL: %d", _sda_pin, _scl_pin);
+    Wire1.begin(_sda_pin, _scl_pin, 400000);
+    ESP_LOGV(LOG_TAG, "Initializing pressure sensor on SDA: %d, SCL: %d, RDY: %d", _sda_pin, _scl_pin, _ready_pin);
     delay(100);
     ads = new ADS1115(0x48, &Wire1);
     if (!ads->begin()) {
         ESP_LOGE(LOG_TAG, "Failed to initialize ADS1115");
     }
     ads->setGain(0);
-    ads->setDataRate(4);
+    ads->setDataRate(PRESSURE_DATA_RATE);
+    if (_ready_pin) {
+        // Thresholds with the high bit set turn the comparator into a conversion ready signal on ALERT/RDY
+        ads->setComparatorThresholdHigh(0x8000);
+        ads->setComparatorThresholdLow(0x0000);
+        ads->setComparatorQueConvert(0);
+    }
     ads->setMode(0);
-    ads->readADC(0);
-    xTaskCreate(loopTask, "Heater::loop", configMINIMAL_STACK_SIZE * 4, this, 1, &taskHandle);
+    ads->requestADC(0);
+    xTaskCreate(loopTask, "PressureSensor::loop", configMINIMAL_STACK_SIZE * 4, this, 1, &taskHandle);
+    if (_ready_pin) {
+        pinMode(_ready_pin, INPUT_PULLUP);
+        attachInterruptArg(_ready_pin, onReady, this, FALLING);
+    }
 }
 
-void PressureSensor::loop() {
+void PressureSensor::loop() { read(micros()); }
+
+void PressureSensor::read(uint32_t time) {
     if (ads->isConnected()) {
-        int16_t reading = ads->readADC();
+        // Continuous mode: only fetch the last conversion, requesting one would restart the converter
+        int16_t reading = ads->getValue();
         reading = reading - _adc_floor;
         float pressure = reading * _pressure_step;
+        const float dt = _lastSampleTime ? (time - _lastSampleTime) / 1000000.0f : PRESSURE_SAMPLE_INTERVAL_US / 1000000.0f;
+        _lastSampleTime = time;
+        const float alpha = dt / (PRESSURE_FILTER_TAU + dt);
         _raw_pressure = pressure;
-        _pressure = 0.05f * pressure + 0.95f * _pressure;
+        _pressure = alpha * pressure + (1.0f - alpha) * _pressure;
         _raw_pressure = std::clamp(_raw_pressure, 0.0f, _pressure_scale);
         _pressure = std::clamp(_pressure, 0.0f, _pressure_scale);
         ESP_LOGV(LOG_TAG, "ADC Reading: %d, Pressure Reading: %f, Pressure Step: %f, Floor: %d", reading, _pressure,
                  _pressure_step, _adc_floor);
+        const PressureSample sample{time, _raw_pressure};
+        if (xQueueSend(_samples, &sample, 0) != pdTRUE) {
+            PressureSample discarded;
+            xQueueReceive(_samples, &discarded, 0);
+            xQueueSend(_samples, &sample, 0);
+        }
         _callback(_pressure);
     }
 }
 
+bool PressureSensor::waitForSample(PressureSample &sample, TickType_t timeout) {
+    return xQueueReceive(_samples, &sample, timeout) == pdTRUE;
+}
+
 void PressureSensor::setScale(float pressure_scale) {
     _pressure_scale = pressure_scale;
     _pressure_step = pressure_scale / _pressure_adc_range;
 }
 
+void IRAM_ATTR PressureSensor::onReady(void *arg) {
+    auto *sensor = static_cast<PressureSensor *>(arg);
+    sensor->_readyTime = micros();
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(sensor->taskHandle, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
 [[noreturn]] void PressureSensor::loopTask(void *arg) {
     TickType_t lastWake = xTaskGetTickCount();
     auto *sensor = static_cast<PressureSensor *>(arg);
     while (true) {
-        sensor->loop();
-        xTaskDelayUntil(&lastWake, pdMS_TO_TICKS(PRESSURE_READ_INTERVAL_MS));
+        if (sensor->_ready_pin) {
+            // Skip a beat if the pin stays quiet, the pump control loop carries on without samples
+            if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PRESSURE_POLL_INTERVAL_MS * 4)) > 0) {
+                sensor->read(sensor->_readyTime);
+            }
+        } else {
+            xTaskDelayUntil(&lastWake, pdMS_TO_TICKS(PRESSURE_POLL_INTERVAL_MS));
+            sensor->loop();
+        }
     }
 }
@@ -3,16 +3,30 @@
 
 #include <ADS1X15.h>
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 
-constexpr int PRESSURE_READ_INTERVAL_MS = 30;
+constexpr uint8_t PRESSURE_DATA_RATE = 4;                      // ADS1115: 128 samples per second
+constexpr uint32_t PRESSURE_SAMPLE_INTERVAL_US = 1000000 / 128; // one conversion at PRESSURE_DATA_RATE
+constexpr int PRESSURE_POLL_INTERVAL_MS = 8;                    // without the ready pin, at least one conversion apart
+constexpr int PRESSURE_SAMPLE_QUEUE_LENGTH = 8;
+constexpr float PRESSURE_FILTER_TAU = 0.57f; // s, smoothing of getPressure()
 constexpr float ADC_STEP = 6.144f / 32767.0f;
 
 using pressure_callback_t = std::function<void(float)>;
 
+struct PressureSample {
+    uint32_t time;  // micros() at the end of the conversion
+    float pressure; // bar, unfiltered
+};
+
+// Reads the ADS1115 in continuous conversion mode. With the ALERT/RDY pin connected every finished conversion is
+// timestamped by an interrupt and read right away, otherwise the sensor is polled at the conversion rate. Each reading
+// is queued for the pump control loop, see waitForSample.
 class PressureSensor {
   public:
-    PressureSensor(uint8_t sda_pin, uint8_t scl_pin, const pressure_callback_t &callback, float pressure_scale = 16.0f,
-                   float voltage_floor = 0.5, float voltage_ceil = 4.5);
+    PressureSensor(uint8_t sda_pin, uint8_t scl_pin, uint8_t ready_pin, const pressure_callback_t &callback,
+                   float pressure_scale = 16.0f, float voltage_floor = 0.5, float voltage_ceil = 4.5);
     ~PressureSensor() = default;
 
     void setup();
@@ -20,10 +34,14 @@ class PressureSensor {
     inline float getPressure() const { return _pressure; };
     inline float getRawPressure() const { return _raw_pressure; };
     void setScale(float pressure_scale);
+    // Next reading in the order they were taken. Drops the oldest ones if nobody takes them for
+    // PRESSURE_SAMPLE_QUEUE_LENGTH conversions.
+    bool waitForSample(PressureSample &sample, TickType_t timeout);
 
   private:
     uint8_t _sda_pin;
     uint8_t _scl_pin;
+    uint8_t _ready_pin;
     float _pressure = 0.0f;
     float _raw_pressure = 0.0f;
     float _pressure_adc_range;
@@ -33,9 +51,15 @@ class PressureSensor {
     ADS1115 *ads = nullptr;
     pressure_callback_t _callback;
     xTaskHandle taskHandle;
+    QueueHandle_t _samples;
+    volatile uint32_t _readyTime = 0;
+    uint32_t _lastSampleTime = 0;
+
+    void read(uint32_t time);
 
     const char *LOG_TAG = "PressureSensor";
     static void loopTask(void *arg);
+    static void onReady(void *arg);
 };
 
 #endif // PRESSURESENSOR_H
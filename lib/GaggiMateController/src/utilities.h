@@ -2,6 +2,7 @@
 #define UTILITIES_H
 #include "ControllerConfig.h"
 #include <Arduino.h>
+#include <BleProfile.h>
 #include <ArduinoJson.h>
 
 inline String make_system_info(ControllerConfig config) {
@@ -13,6 +14,9 @@ inline String make_system_info(ControllerConfig config) {
     capabilities["dm"] = config.capabilites.dimming;
     capabilities["led"] = config.capabilites.ledControls;
     capabilities["tof"] = config.capabilites.tof;
+    capabilities["bin"] = BLE_PROTOCOL_VERSION;
+    // Profiles are executed by the pressure control loop of the dimmed pump
+    capabilities["prof"] = config.capabilites.dimming ? BLE_PROFILE_VERSION : 0;
     doc["cp"] = capabilities;
     return doc.as<String>();
 }
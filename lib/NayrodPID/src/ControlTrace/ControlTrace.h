@@ -0,0 +1,90 @@
+#ifndef CONTROL_TRACE_H
+#define CONTROL_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef NAYRODPID_CONTROL_TRACE
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#endif
+
+#ifndef NAYRODPID_CONTROL_TRACE_CAPACITY
+#define NAYRODPID_CONTROL_TRACE_CAPACITY 1024 // 8 s of the pump control loop, one step per pressure sample
+#endif
+
+// Controller internals of one control loop tick
+struct ControlTraceRecord {
+    float setpoint;           // filtered pressure setpoint (bar)
+    float pressure;           // filtered pressure (bar)
+    float pressureDerivative; // bar/s
+    float resistance;         // puck resistance estimate
+    float puckFlow;           // estimated flow out of the puck (ml/s)
+    float covariance;         // estimator covariance of the resistance
+    float pumpFlow;           // modelled pump flow (ml/s)
+    float duty;               // pump power (%)
+};
+
+// Flight recorder for the pressure controller, built with -DNAYRODPID_CONTROL_TRACE. Without it recording compiles to
+// nothing and reads return no records.
+//
+// The control loop is the only writer and never waits: it overwrites the oldest record once the ring is full. Any
+// number of readers keep their own cursor, the index of the next tick to read, and copy records out without locking.
+// Records the writer overwrote while they were being copied are dropped from the result, so readers see a gap in
+// the tick indices instead of a torn record.
+class ControlTrace {
+  public:
+#ifdef NAYRODPID_CONTROL_TRACE
+    static constexpr bool ENABLED = true;
+    static constexpr size_t CAPACITY = NAYRODPID_CONTROL_TRACE_CAPACITY;
+    static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "Control trace capacity must be a power of two");
+
+    void record(const ControlTraceRecord &record) {
+        const uint32_t head = _head.load(std::memory_order_relaxed);
+        // Readers that saw the previous head must also see that this slot is being rewritten
+        std::atomic_thread_fence(std::memory_order_release);
+        _records[head & (CAPACITY - 1)] = record;
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    // Copies up to max records from cursor on and advances cursor past them, the records returned are the ticks
+    // cursor - count to cursor - 1. Skips ahead to the oldest record still available if the cursor fell behind.
+    size_t read(uint32_t &cursor, ControlTraceRecord *out, size_t max) const {
+        const uint32_t head = _head.load(std::memory_order_acquire);
+        if (head - cursor > CAPACITY) {
+            cursor = head - CAPACITY;
+        }
+        const size_t count = std::min<size_t>(max, head - cursor);
+        for (size_t i = 0; i < count; i++) {
+            out[i] = _records[(cursor + i) & (CAPACITY - 1)];
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // The writer may have started on tick now, which reuses the slot of tick now - CAPACITY
+        const uint32_t now = _head.load(std::memory_order_relaxed);
+        const int64_t overwritten = int64_t(now) - int64_t(CAPACITY) + 1 - int64_t(cursor);
+        const size_t torn = std::min<size_t>(count, std::max<int64_t>(0, overwritten));
+        if (torn > 0) {
+            memmove(out, out + torn, (count - torn) * sizeof(ControlTraceRecord));
+        }
+        cursor += count;
+        return count - torn;
+    }
+
+    uint32_t ticks() const { return _head.load(std::memory_order_acquire); }
+
+  private:
+    std::array<ControlTraceRecord, CAPACITY> _records{};
+    std::atomic<uint32_t> _head{0};
+#else
+    static constexpr bool ENABLED = false;
+    static constexpr size_t CAPACITY = 0;
+
+    void record(const ControlTraceRecord &) {}
+    size_t read(uint32_t &, ControlTraceRecord *, size_t) const { return 0; }
+    uint32_t ticks() const { return 0; }
+#endif
+};
+
+#endif // CONTROL_TRACE_H
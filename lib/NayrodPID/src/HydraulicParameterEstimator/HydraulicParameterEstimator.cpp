@@ -14,9 +14,9 @@ HydraulicParameterEstimator::HydraulicParameterEstimator(float dt_)
     X_state[2] = 0.0f;       // Qout
 
     // init covariance
-    P_cov[0][0] = 1e6f;   P_cov[0][1] = 0.0f;    P_cov[0][2] = 0.0f;
-    P_cov[1][0] = 0.0f;    P_cov[1][1] = 1e6f;    P_cov[1][2] = 0.0f;
-    P_cov[2][0] = 0.0f;    P_cov[2][1] = 0.0f;    P_cov[2][2] = 1e6f;
+    P_cov[COV_PP] = 1e6f;  P_cov[COV_PK] = 0.0f;  P_cov[COV_PQ] = 0.0f;
+                           P_cov[COV_KK] = 1e6f;  P_cov[COV_KQ] = 0.0f;
+                                                  P_cov[COV_QQ] = 1e6f;
 
     // process noise
     float sigmaQin      = 0.7f;  // ml/s incertitude pompe
@@ -31,11 +31,11 @@ HydraulicParameterEstimator::HydraulicParameterEstimator(float dt_)
 
 void HydraulicParameterEstimator::setPhysicalNoises(float sigmaQin, float kDrift, float qOutDrift, float pressureNoise) {
     // bruit sur conservation volume (propagation incertitude Qin -> P)
-    Qk[0][0] = powf(dt / C_fixed * sigmaQin, 2.0f);
+    Qk[0] = powf(sigmaQin / C_fixed, 2.0f);
     // marche aléatoire de k (variation max attendue)
-    Qk[1][1] = powf(kDrift * dt, 2.0f);
+    Qk[1] = powf(kDrift, 2.0f);
     // variation rapide de Qout
-    Qk[2][2] = powf(qOutDrift * dt, 2.0f);
+    Qk[2] = powf(qOutDrift, 2.0f);
     // bruit de mesure capteur
     meas_noise_var = powf(pressureNoise, 2.0f);
 }
@@ -46,15 +46,15 @@ void HydraulicParameterEstimator::reset() {
     X_state[1] = K_est_init;// k
     X_state[2] = 0.0f;      // Qout
 
-    P_cov[0][0] = 0.01f;  P_cov[0][1] = 0.0f;   P_cov[0][2] = 0.0f;
-    P_cov[1][0] = 0.0f;   P_cov[1][1] = 1e6f;   P_cov[1][2] = 0.0f;
-    P_cov[2][0] = 0.0f;   P_cov[2][1] = 0.0f;   P_cov[2][2] = 1.0f;
+    P_cov[COV_PP] = 0.01f; P_cov[COV_PK] = 0.0f;  P_cov[COV_PQ] = 0.0f;
+                           P_cov[COV_KK] = 1e6f;  P_cov[COV_KQ] = 0.0f;
+                                                  P_cov[COV_QQ] = 1.0f;
 
     Vin_cum = 0.0f;
 }
 
 bool HydraulicParameterEstimator::hasConverged() {
-    return P_cov[1][1] < 1e-16f;
+    return P_cov[COV_KK] < 1e-16f;
 }
 float HydraulicParameterEstimator:: getEffectiveCompliance(float Vin) {
     // Paramètres à tuner
@@ -63,18 +63,18 @@ float HydraulicParameterEstimator:: getEffectiveCompliance(float Vin) {
     const float C_init = 8.0f;     // ml/bar, moins extrême
     const float C_puck = C_fixed;  // compliance normale
 
-    float C_eff = C_puck + (C_init - C_puck) *exp((-Vin+Vmin)/Vfill);
-
     if(Vin<Vmin){
-      C_eff =C_init;
+      return C_init;
     }
-    return C_eff ;
+    return C_puck + (C_init - C_puck) * expf((Vmin - Vin) / Vfill);
 }
 
-bool HydraulicParameterEstimator::update(float Q_in, float P_meas) {
+bool HydraulicParameterEstimator::update(float Q_in, float P_meas) { return update(Q_in, P_meas, dt); }
+
+bool HydraulicParameterEstimator::update(float Q_in, float P_meas, float dt_) {
     counter++;
     
-    Vin_cum += Q_in * dt;
+    Vin_cum += Q_in * dt_;
     // if(P_meas<0.8)
     //     return false;
     C_eff = getEffectiveCompliance(Vin_cum);
@@ -82,67 +82,53 @@ bool HydraulicParameterEstimator::update(float Q_in, float P_meas) {
     float kk = X_state[1];
     float Qoutk = X_state[2];
 
-    float sqrtP = (Pk > epsilon) ? sqrtf(Pk) : sqrtf(epsilon);
+    float sqrtP = sqrtf(fmaxf(Pk, epsilon));
 
     // === Prediction ===
-    float P_pred    = Pk + dt * ((Q_in - Qoutk) / C_eff);
+    float dtC       = dt_ / C_eff;
+    float P_pred    = Pk + dtC * (Q_in - Qoutk);
     float k_pred    = kk;
     float Qout_pred = kk * sqrtP;
 
-    float X_pred[3] = {P_pred, k_pred, Qout_pred};
-
-    // Jacobian F
-    float dPdP    = 1.0f;
-    float dPdQout = -dt / C_eff;
-    float dQoutdP = (kk > 0.0f) ? (0.5f * kk / sqrtP) : 0.0f;
-    float dQoutdk = sqrtP;
-
-    float F[3][3] = {
-        {dPdP, 0.0f, dPdQout},
-        {0.0f, 1.0f, 0.0f},
-        {dQoutdP, dQoutdk, 0.0f}
-    };
-
-    // covariance prédite
-    float P_pred_cov[3][3] = {0};
-    for (int i = 0; i < 3; ++i)
-      for (int j = 0; j < 3; ++j) {
-        for (int k = 0; k < 3; ++k)
-          for (int l = 0; l < 3; ++l)
-            P_pred_cov[i][j] += F[i][k] * P_cov[k][l] * F[j][l];
-        P_pred_cov[i][j] += Qk[i][j];
-      }
+    // Jacobian F = [[1, 0, a], [0, 1, 0], [b, c, 0]]
+    float a = -dtC;                                     // dP/dQout
+    float b = (kk > 0.0f) ? (0.5f * kk / sqrtP) : 0.0f; // dQout/dP
+    float c = sqrtP;                                    // dQout/dk
+
+    // covariance prédite F·P·Fᵀ + Q, written out for the zeros of F
+    float p00 = P_cov[COV_PP], p01 = P_cov[COV_PK], p02 = P_cov[COV_PQ];
+    float p11 = P_cov[COV_KK], p12 = P_cov[COV_KQ], p22 = P_cov[COV_QQ];
+    float fp00 = p00 + a * p02; // first row of F·P
+    float fp01 = p01 + a * p12;
+    float dt2 = dt_ * dt_;
+    float m00 = fp00 + a * (p02 + a * p22) + Qk[0] * dt2;
+    float m01 = fp01;
+    float m02 = b * fp00 + c * fp01;
+    float m11 = p11 + Qk[1] * dt2;
+    float m12 = b * p01 + c * p11;
+    float m22 = b * (b * p00 + c * p01) + c * (b * p01 + c * p11) + Qk[2] * dt2;
 
     // === Correction ===
-    float H[3] = {1.0f, 0.0f, 0.0f}; // mesure: P
-    float S = 0.0f;
-    for (int i = 0; i < 3; ++i) S += H[i] * P_pred_cov[i][0];
-    S += meas_noise_var;
-
-    float K_gain[3];
-    for (int i = 0; i < 3; ++i)
-        K_gain[i] = P_pred_cov[i][0] / S;
-
-    float innov = P_meas - X_pred[0];
-
-    for (int i = 0; i < 3; ++i)
-        X_state[i] = X_pred[i] + K_gain[i] * innov;
-
-    // Joseph form
-    float I_KH[3][3];
-    for (int i = 0; i < 3; ++i)
-      for (int j = 0; j < 3; ++j)
-        I_KH[i][j] = (i==j ? 1.0f : 0.0f) - K_gain[i] * H[j];
-
-    float temp[3][3] = {0};
-    for (int i = 0; i < 3; ++i)
-      for (int j = 0; j < 3; ++j)
-        for (int k = 0; k < 3; ++k)
-          temp[i][j] += I_KH[i][k] * P_pred_cov[k][j];
-
-    for (int i = 0; i < 3; ++i)
-      for (int j = 0; j < 3; ++j)
-        P_cov[i][j] = temp[i][j];
+    // mesure: P, H = [1, 0, 0] so S and the gain only need the first column
+    float S = m00 + meas_noise_var;
+    float invS = 1.0f / S;
+    float K0 = m00 * invS;
+    float K1 = m01 * invS;
+    float K2 = m02 * invS;
+
+    float innov = P_meas - P_pred;
+
+    X_state[0] = P_pred + K0 * innov;
+    X_state[1] = k_pred + K1 * innov;
+    X_state[2] = Qout_pred + K2 * innov;
+
+    // (I - K·H)·P_pred, symmetric again
+    P_cov[COV_PP] = m00 - K0 * m00;
+    P_cov[COV_PK] = m01 - K0 * m01;
+    P_cov[COV_PQ] = m02 - K0 * m02;
+    P_cov[COV_KK] = m11 - K1 * m01;
+    P_cov[COV_KQ] = m12 - K1 * m02;
+    P_cov[COV_QQ] = m22 - K2 * m02;
 
     K_est = fmaxf(X_state[1], 0.0f);
 
@@ -9,6 +9,8 @@ class HydraulicParameterEstimator {
     HydraulicParameterEstimator(float dt_ = 0.03f);
 
     bool update(float Q_in, float P_raw);
+    // Same as update() for a sample dt_ seconds after the previous one
+    bool update(float Q_in, float P_raw, float dt_);
     void reset();
     bool hasConverged();
     void setPhysicalNoises(float sigmaQin, float kDrift, float qOutDrift, float pressureNoise);
@@ -17,8 +19,8 @@ class HydraulicParameterEstimator {
     float getQout() { return X_state[2]; };        // Qout
     float getPressure() { return X_state[0]; };    // P
 
-    float getCovarianceK() { return P_cov[1][1]; };
-    float getCovarianceQout() { return P_cov[2][2]; };
+    float getCovarianceK() { return P_cov[COV_KK]; };
+    float getCovarianceQout() { return P_cov[COV_QQ]; };
     float getCeff(){return C_eff;};
     float C_fixed;
     float K_est_init;
@@ -30,8 +32,10 @@ class HydraulicParameterEstimator {
 
     // === Etat & hyperparamètres EKF ===
     float X_state[3] = {0.0f, 0.0f, 0.0f}; // [P, k, Qout]
-    float P_cov[3][3] = {0};
-    float Qk[3][3] = {0};   // process noise
+    // Upper triangle of the symmetric state covariance
+    enum CovarianceIndex { COV_PP, COV_PK, COV_PQ, COV_KK, COV_KQ, COV_QQ };
+    float P_cov[6] = {0};
+    float Qk[3] = {0};      // process noise per s², diagonal, scaled by dt² in update
     float meas_noise_var;   // noise on P
     float lambda;           // forget factor
 
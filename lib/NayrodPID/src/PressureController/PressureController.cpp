@@ -14,6 +14,7 @@ PressureController::PressureController(float dt, float *rawPressureSetpoint, flo
     this->_ctrlOutput = controllerOutput;
     this->_ValveStatus = ValveStatus;
     this->_dt = dt;
+    this->_nominalDt = dt;
 
     this->pressureKF = new SimpleKalmanFilter(0.1f, 10.0f, powf(4 * _dt, 2));
     this->_P_previous = *sensorOutput;
@@ -60,7 +61,13 @@ void PressureController::tare() {
     pumpVolume = 0.0f;
 }
 
-void PressureController::update(ControlMode mode) {
+void PressureController::update(ControlMode mode) { update(mode, _nominalDt); }
+
+void PressureController::update(ControlMode mode, float dt) {
+    if (dt != _dt) {
+        _dt = dt;
+        pressureKF->setProcessNoise((4 * _dt) * (4 * _dt));
+    }
     old_ValveStatus = *_ValveStatus;
     filterSetpoint(*_rawPressureSetpoint);
     filterSensor();
@@ -79,6 +86,8 @@ void PressureController::update(ControlMode mode) {
         *_ctrlOutput = getPumpDutyCycleForPressure();
     }
     virtualScale();
+    trace.record({_r, _filteredPressureSensor, _dFilteredPressure, R_estimator->getResistance(), R_estimator->getQout(),
+                  R_estimator->getCovarianceK(), pumpFlowRate, *_ctrlOutput});
 }
 
 float PressureController::computeAdustedCoffeeFlowRate(float pressure) const {
@@ -127,21 +136,22 @@ void PressureController::setPumpFlowPolyCoeffs(float a, float b, float c, float
 }
 
 void PressureController::virtualScale() {
+    const float power = _deliveredPower != nullptr ? *_deliveredPower : *_ctrlOutput;
     // Estimate puck input flow
     if(pumpVolume < deadVolume ){  // Proportionnaly increase flow rate at the beginning  
-        float flow = pumpFlowModel(*_ctrlOutput)*1e6f;
+        float flow = pumpFlowModel(power)*1e6f;
         pumpFlowInstant += flow *_dt;
         pumpFlowRate = pumpFlowInstant * flow /8.0f;     
     }else{
         // pumpFlowRate = pumpFlowModel(*_ctrlOutput)*1e6f;
         float alpha = 0.3/(0.3+_dt);
-        pumpFlowRate = pumpFlowModel(*_ctrlOutput)*1e6f *alpha + pumpFlowRate * (1-alpha);
+        pumpFlowRate = pumpFlowModel(power)*1e6f *alpha + pumpFlowRate * (1-alpha);
     }
     pumpVolume += pumpFlowRate *_dt;
     
     // Update puck resistance estimation:
     float badFlow = 0.0f;
-    bool isPpressurized = this->R_estimator->update(pumpFlowRate, _filteredPressureSensor);
+    bool isPpressurized = this->R_estimator->update(pumpFlowRate, _filteredPressureSensor, _dt);
     flowPerSecond = R_estimator->getQout();
     if (flowPerSecond > 0.0f) {
         badFlow = pumpFlowRate - R_estimator->getCeff()*_dFilteredPressure;
@@ -152,7 +162,6 @@ void PressureController::virtualScale() {
             flowPerSecond = 0.0f;
         }
     }
-    ESP_LOGI("","%.2e\t%.2e\t%.2e\t%.2e\t%.2e\t%.2e\t%.2e",badFlow, coffeeBadVolume, R_estimator->getPressure(),_filteredPressureSensor,R_estimator->getResistance(),R_estimator->getQout(),R_estimator->getCovarianceK());
 }
 
 
@@ -183,7 +192,8 @@ float PressureController::getPumpDutyCycleForPressure() {
     float dP_ref = _dr;
 
     float error = P - P_ref;
-    float dP_actual = 0.3f * _dP_previous + 0.7f * (P - _P_previous) / _dt;
+    float beta = 0.013f / (0.013f + _dt); // 0.3 at 30 ms
+    float dP_actual = beta * _dP_previous + (1.0f - beta) * (P - _P_previous) / _dt;
     _dP_previous = dP_actual;
     float error_dot = dP_actual - dP_ref;
 
@@ -230,5 +240,5 @@ void PressureController::reset() {
     estimationConvergenceCounter = 0;
     timer = 0.0f;
     pumpFlowInstant = 0.0f;
-    ESP_LOGI("","RESET");
+    ESP_LOGD("PressureController", "Reset");
 }
@@ -5,6 +5,7 @@
 static constexpr float M_PI = 3.14159265358979323846f;
 #endif
 
+#include "ControlTrace/ControlTrace.h"
 #include "HydraulicParameterEstimator/HydraulicParameterEstimator.h"
 #include "SimpleKalmanFilter/SimpleKalmanFilter.h"
 #include <algorithm>
@@ -24,6 +25,8 @@ class PressureController {
     float getFilteredSetpointDeriv() const { return _dr; };
 
     void update(ControlMode mode);
+    // Same as update() for a pressure sample dt seconds after the previous one
+    void update(ControlMode mode, float dt);
     void tare();
     void reset();
 
@@ -31,12 +34,17 @@ class PressureController {
     float getFilteredPressure() { return _filteredPressureSensor; };
     void setPumpFlowCoeff(float oneBarFlow, float nineBarFlow);
     void setPumpFlowPolyCoeffs(float a, float b, float c, float d);
+    // Pump power the pump actually got since the previous update, e.g. counted from the PSM. The flow estimation
+    // uses the controller output without it.
+    void setDeliveredPower(const float *deliveredPower) { _deliveredPower = deliveredPower; };
     float getPumFlowRate() { return pumpFlowRate; };
     float getCoffeeFlowRate() { return *_ValveStatus == 1 ? flowPerSecond : 0.0f; };
     float getPuckResistance() { return R_estimator->getResistance(); }
     float getEstimatorCovariance() { return R_estimator->getCovarianceQout(); };
     float getPumpDutyCycleForFlowRate() const;
     float getFilteredPressureDerivative() const { return _dFilteredPressure; };
+    // Controller internals of every update, see ControlTrace
+    const ControlTrace &getTrace() const { return trace; };
 
 
   private:
@@ -47,13 +55,15 @@ class PressureController {
     float pumpFlowModel(float alpha = 100.0f) const;
     float getAvailableFlow() const;
 
-    float _dt = 1; // Controler frequency sampling
+    float _dt = 1;        // Time since the previous update
+    float _nominalDt = 1; // Controler frequency sampling
 
-    float *_rawPressureSetpoint = nullptr; // pointer to the Pressure profile current setpoint / limit
-    float *_rawFlowSetpoint = nullptr;     // pointer to the flow profile current setpoint / limit
-    float *_rawPressure = nullptr;         // pointer to the pressure measurement ,raw output from sensor
-    float *_ctrlOutput = nullptr;          // pointer to controller output value of power ratio 0-100%
-    int *_ValveStatus = nullptr;           // pointer to 3WV status regarding group head canal open/closed
+    float *_rawPressureSetpoint = nullptr;  // pointer to the Pressure profile current setpoint / limit
+    float *_rawFlowSetpoint = nullptr;      // pointer to the flow profile current setpoint / limit
+    float *_rawPressure = nullptr;          // pointer to the pressure measurement ,raw output from sensor
+    float *_ctrlOutput = nullptr;           // pointer to controller output value of power ratio 0-100%
+    int *_ValveStatus = nullptr;            // pointer to 3WV status regarding group head canal open/closed
+    const float *_deliveredPower = nullptr; // pointer to the pump power delivered since the previous update
     int old_ValveStatus = 0;
     float _filteredPressureSensor = 0.0f;
     float _filtfreqHz = 1.0f; // Setpoint filter cuttoff frequency
@@ -104,6 +114,7 @@ class PressureController {
 
     SimpleKalmanFilter *pressureKF;
     HydraulicParameterEstimator *R_estimator;
+    ControlTrace trace;
 };
 
 #endif // PRESSURE_CONTROLLER_H
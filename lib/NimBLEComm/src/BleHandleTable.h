@@ -0,0 +1,55 @@
+#ifndef BLEHANDLETABLE_H
+#define BLEHANDLETABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Maps attribute handles of one remote service to their handlers in constant time. Handles are resolved once after
+// connecting, so notifications can be dispatched by their handle without comparing UUIDs.
+//
+// Handles are stored relative to the start handle of the service, which keeps the index table small. A slot holds
+// the 1-based position of the handler, 0 marks an unused handle.
+//
+// This header has no Arduino dependencies so it can be used by host tools, see scripts/bench.
+
+template <typename Handler, size_t Capacity, size_t Slots = 256> class BleHandleTable {
+    static_assert(Capacity < 256, "Handler positions are stored as uint8_t");
+
+  public:
+    void reset(uint16_t startHandle) {
+        _startHandle = startHandle;
+        _count = 0;
+        memset(_slots, 0, sizeof(_slots));
+    }
+
+    // Returns false if the table is full or the handle is outside of the service range
+    bool add(uint16_t handle, Handler handler) {
+        if (_count >= Capacity || !inRange(handle)) {
+            return false;
+        }
+        _handlers[_count++] = handler;
+        _slots[handle - _startHandle] = _count;
+        return true;
+    }
+
+    const Handler *find(uint16_t handle) const {
+        if (!inRange(handle)) {
+            return nullptr;
+        }
+        const uint8_t position = _slots[handle - _startHandle];
+        return position > 0 ? &_handlers[position - 1] : nullptr;
+    }
+
+  private:
+    bool inRange(uint16_t handle) const {
+        return handle >= _startHandle && static_cast<size_t>(handle - _startHandle) < Slots;
+    }
+
+    uint16_t _startHandle = 0;
+    uint8_t _count = 0;
+    uint8_t _slots[Slots] = {};
+    Handler _handlers[Capacity] = {};
+};
+
+#endif // BLEHANDLETABLE_H
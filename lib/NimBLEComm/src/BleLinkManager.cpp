@@ -0,0 +1,77 @@
+#include "BleLinkManager.h"
+
+const BleConnParams &BleLinkManager::getParams(BleLinkMode mode) {
+    switch (mode) {
+    case BleLinkMode::BREWING:
+        return BLE_CONN_PARAMS_BREWING;
+    case BleLinkMode::STANDBY:
+        return BLE_CONN_PARAMS_STANDBY;
+    case BleLinkMode::IDLE:
+    default:
+        return BLE_CONN_PARAMS_IDLE;
+    }
+}
+
+void BleLinkManager::onConnect(NimBLEClient *client) {
+    this->client = client;
+    lastSample = millis();
+    lastNotifications = notifications;
+    applyParams();
+}
+
+void BleLinkManager::clearLinkState() {
+    rssi = 0;
+    interval = 0;
+    latency = 0;
+    notificationRate = 0.0f;
+}
+
+void BleLinkManager::setMode(BleLinkMode mode) {
+    if (mode == this->mode) {
+        return;
+    }
+    this->mode = mode;
+    applyParams();
+}
+
+void BleLinkManager::onWrite(bool success) {
+    if (!success) {
+        writeErrors.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void BleLinkManager::loop() {
+    const unsigned long now = millis();
+    if (now - lastSample < BLE_LINK_STATS_INTERVAL_MS) {
+        return;
+    }
+    const uint32_t count = notifications;
+    notificationRate = static_cast<float>(count - lastNotifications) * 1000.0f / static_cast<float>(now - lastSample);
+    lastNotifications = count;
+    lastSample = now;
+    if (client == nullptr || !client->isConnected()) {
+        clearLinkState();
+        return;
+    }
+    NimBLEConnInfo info = client->getConnInfo();
+    mtu = client->getMTU();
+    interval = info.getConnInterval();
+    latency = info.getConnLatency();
+    rssi = static_cast<int8_t>(client->getRssi());
+}
+
+BleLinkStats BleLinkManager::getStats() const {
+    return BleLinkStats{mode, mtu, interval, latency, rssi, notificationRate, notifications, writeErrors, paramUpdates};
+}
+
+// The update is negotiated in the background, loop() picks up the result
+void BleLinkManager::applyParams() {
+    if (client == nullptr || !client->isConnected()) {
+        return;
+    }
+    const BleConnParams &params = getParams(mode);
+    ESP_LOGI(LOG_TAG, "Requesting connection interval %.2f - %.2f ms, latency %d", params.minInterval * 1.25f,
+             params.maxInterval * 1.25f, params.latency);
+    client->updateConnParams(params.minInterval, params.maxInterval, params.latency, params.timeout);
+    paramUpdates++;
+}
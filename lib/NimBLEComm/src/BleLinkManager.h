@@ -0,0 +1,75 @@
+#ifndef BLELINKMANAGER_H
+#define BLELINKMANAGER_H
+
+#include "BleProtocol.h"
+#include <NimBLEDevice.h>
+#include <atomic>
+
+constexpr unsigned long BLE_LINK_STATS_INTERVAL_MS = 1000;
+
+// What the link is used for, selects the connection parameters
+enum class BleLinkMode : uint8_t { IDLE, BREWING, STANDBY };
+
+// Connection parameters in controller units: intervals 1.25 ms, supervision timeout 10 ms
+struct BleConnParams {
+    uint16_t minInterval;
+    uint16_t maxInterval;
+    uint16_t latency; // connection events the controller board may skip while it has nothing to send
+    uint16_t timeout;
+};
+
+// 7.5 ms, the shortest interval, for the sensor stream and setpoints of a running shot
+constexpr BleConnParams BLE_CONN_PARAMS_BREWING{6, 6, 0, 200};
+// 30 - 50 ms while the machine is heating or waiting for a shot
+constexpr BleConnParams BLE_CONN_PARAMS_IDLE{24, 40, 0, 400};
+// 100 - 150 ms with slave latency in standby, leaves most of the radio time to BLE scales
+constexpr BleConnParams BLE_CONN_PARAMS_STANDBY{80, 120, 4, 600};
+
+struct BleLinkStats {
+    BleLinkMode mode;
+    uint16_t mtu;
+    uint16_t interval;      // negotiated, 1.25 ms units
+    uint16_t latency;       // negotiated
+    int8_t rssi;            // dBm, 0 if not connected
+    float notificationRate; // notifications per second over the last stats interval
+    uint32_t notifications; // since boot
+    uint32_t writeErrors;   // writes the host could not send, e.g. while out of buffers
+    uint32_t paramUpdates;  // connection parameter update requests
+};
+
+// Keeps the connection to the controller board at the parameters of the current link mode and measures it
+class BleLinkManager {
+  public:
+    static const BleConnParams &getParams(BleLinkMode mode);
+
+    void onConnect(NimBLEClient *client);
+    void setMode(BleLinkMode mode);
+    void onNotification() { notifications.fetch_add(1, std::memory_order_relaxed); }
+    void onWrite(bool success);
+    // Samples RSSI and the negotiated parameters once per stats interval, called from the loop task
+    void loop();
+
+    BleLinkStats getStats() const;
+
+  private:
+    void applyParams();
+    void clearLinkState();
+
+    NimBLEClient *client = nullptr;
+    BleLinkMode mode = BleLinkMode::IDLE;
+    std::atomic<uint32_t> notifications{0};
+    std::atomic<uint32_t> writeErrors{0};
+    uint32_t paramUpdates = 0;
+
+    unsigned long lastSample = 0;
+    uint32_t lastNotifications = 0;
+    float notificationRate = 0.0f;
+    uint16_t mtu = 0;
+    uint16_t interval = 0;
+    uint16_t latency = 0;
+    int8_t rssi = 0;
+
+    const char *LOG_TAG = "BleLinkManager";
+};
+
+#endif // BLELINKMANAGER_H
@@ -0,0 +1,120 @@
+#ifndef BLEPROFILE_H
+#define BLEPROFILE_H
+
+#include "BleProtocol.h"
+
+// Brew profiles executed by the controller board.
+//
+// The controller announces the profile version it can run as "prof" in the INFO capabilities. The display uploads the
+// phases of a brew profile with a single long write to the profile characteristic and starts it with a control frame.
+// The controller then steps through the phases in its pump control loop and notifies the display of every phase
+// change. Volumetric targets depend on the scale connected to the display, they are evaluated there and reported
+// back with BLE_PROFILE_ADVANCE.
+//
+// This header has no Arduino dependencies so it can be used by host tools.
+
+constexpr uint8_t BLE_PROFILE_VERSION = 1;
+constexpr size_t BLE_PROFILE_MAX_PHASES = 12;
+constexpr size_t BLE_PROFILE_MAX_TARGETS = 3;
+
+constexpr uint8_t BLE_PHASE_FLAG_VALVE = 1 << 0;
+constexpr uint8_t BLE_PHASE_FLAG_SIMPLE_PUMP = 1 << 1;
+constexpr uint8_t BLE_PHASE_FLAG_PRESSURE_TARGET = 1 << 2;
+constexpr uint8_t BLE_PHASE_FLAG_ADAPTIVE = 1 << 3;
+constexpr uint8_t BLE_PHASE_FLAG_NO_DURATION = 1 << 4; // only ends by a target or BLE_PROFILE_ADVANCE
+
+enum BleTransitionType : uint8_t {
+    BLE_TRANSITION_INSTANT = 0,
+    BLE_TRANSITION_LINEAR = 1,
+    BLE_TRANSITION_EASE_IN = 2,
+    BLE_TRANSITION_EASE_OUT = 3,
+    BLE_TRANSITION_EASE_IN_OUT = 4,
+};
+
+enum BleTargetType : uint8_t {
+    BLE_TARGET_PRESSURE = 1,
+    BLE_TARGET_FLOW = 2,
+    BLE_TARGET_PUMPED = 3,
+};
+constexpr uint8_t BLE_TARGET_FLAG_GTE = 0x80; // target is reached at or above the value, below otherwise
+constexpr uint8_t BLE_TARGET_TYPE_MASK = 0x7F;
+
+struct __attribute__((packed)) BleProfileTarget {
+    uint8_t type; // BleTargetType | BLE_TARGET_FLAG_GTE
+    float value;
+};
+
+// Pressure and flow of -1 keep the value the previous phase ended with
+struct __attribute__((packed)) BleProfilePhase {
+    uint8_t flags;
+    uint8_t transition;          // BleTransitionType
+    uint16_t duration;           // 0.1 s
+    uint16_t transitionDuration; // 0.1 s, 0 uses the phase duration
+    uint8_t pumpSimple;          // % pump power of simple pump phases
+    int16_t pressure;            // 0.01 bar
+    int16_t flow;                // 0.01 ml/s
+    uint8_t targetCount;
+    BleProfileTarget targets[BLE_PROFILE_MAX_TARGETS];
+};
+
+// Only the first phaseCount phases are transferred, see bleProfileFrameSize
+struct __attribute__((packed)) BleProfileFrame {
+    BleFrameHeader header;
+    uint8_t phaseCount;
+    uint8_t reserved;
+    BleProfilePhase phases[BLE_PROFILE_MAX_PHASES];
+};
+
+enum BleProfileCommand : uint8_t {
+    BLE_PROFILE_START = 1,
+    BLE_PROFILE_STOP = 2,
+    BLE_PROFILE_ADVANCE = 3, // finishes the given phase, ignored if another phase is running
+};
+
+struct __attribute__((packed)) BleProfileControlFrame {
+    BleFrameHeader header;
+    uint8_t command;
+    uint8_t phase;
+};
+
+// Notified on every state or phase change. IDLE after RUNNING means the board stopped the profile, on a STOP command,
+// a direct output command or a safety shutdown.
+enum BleProfileState : uint8_t {
+    BLE_PROFILE_IDLE = 0,
+    BLE_PROFILE_RUNNING = 1,
+    BLE_PROFILE_FINISHED = 2,
+};
+
+struct __attribute__((packed)) BleProfileStatusFrame {
+    BleFrameHeader header;
+    uint8_t state;
+    uint8_t phase;
+};
+
+static_assert(sizeof(BleProfileTarget) == 5, "BleProfileTarget layout changed");
+static_assert(sizeof(BleProfilePhase) == 27, "BleProfilePhase layout changed");
+static_assert(sizeof(BleProfileControlFrame) == 12, "BleProfileControlFrame layout changed");
+static_assert(sizeof(BleProfileStatusFrame) == 12, "BleProfileStatusFrame layout changed");
+
+constexpr size_t bleProfileFrameSize(size_t phaseCount) {
+    return offsetof(BleProfileFrame, phases) + std::min(phaseCount, BLE_PROFILE_MAX_PHASES) * sizeof(BleProfilePhase);
+}
+
+static_assert(bleProfileFrameSize(BLE_PROFILE_MAX_PHASES) <= 512, "Profile frame exceeds the maximum attribute size");
+
+// Copies a profile frame of variable length, returns false if it is truncated or has too many phases
+inline bool readBleProfileFrame(const uint8_t *data, size_t length, BleProfileFrame &frame) {
+    constexpr size_t headerSize = offsetof(BleProfileFrame, phases);
+    if (length < headerSize || data[0] != BLE_FRAME_MAGIC) {
+        return false;
+    }
+    memcpy(&frame, data, headerSize);
+    if (frame.header.type != BLE_FRAME_PROFILE || frame.phaseCount == 0 || frame.phaseCount > BLE_PROFILE_MAX_PHASES ||
+        length < bleProfileFrameSize(frame.phaseCount)) {
+        return false;
+    }
+    memcpy(frame.phases, data + headerSize, frame.phaseCount * sizeof(BleProfilePhase));
+    return true;
+}
+
+#endif // BLEPROFILE_H
@@ -0,0 +1,217 @@
+#ifndef BLEPROTOCOL_H
+#define BLEPROTOCOL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Packed binary frames for the high rate characteristics. All fields are little-endian.
+//
+// The controller announces the highest frame version it understands as "bin" in the INFO capabilities. A display that
+// supports it writes binary output control frames, and the controller answers with binary sensor frames from the
+// first valid one on. Both sides tell frames from the legacy CSV strings by the magic byte, which is never a valid
+// first character of a CSV value, so either side can fall back to CSV at any time.
+//
+// From version 2 on, the controller samples its sensors every SENSOR_SAMPLE_INTERVAL_MS, a few steps of the pump
+// control loop, and sends the samples in batches that fill the negotiated MTU instead of one sensor frame per update
+// interval.
+//
+// This header has no Arduino dependencies so it can be used by host tools.
+
+constexpr uint8_t BLE_FRAME_MAGIC = 0xA7;
+constexpr uint8_t BLE_PROTOCOL_VERSION = 2;
+constexpr uint8_t BLE_PROTOCOL_BATCH_VERSION = 2; // first version with BLE_FRAME_SENSOR_BATCH
+
+enum BleFrameType : uint8_t {
+    BLE_FRAME_SENSOR = 1,
+    BLE_FRAME_OUTPUT_CONTROL = 2,
+    BLE_FRAME_SENSOR_BATCH = 3,
+    BLE_FRAME_PROFILE = 4,
+    BLE_FRAME_PROFILE_CONTROL = 5,
+    BLE_FRAME_PROFILE_STATUS = 6,
+    BLE_FRAME_CONTROL_TRACE = 7,
+};
+
+// Output control modes. While the controller runs a profile (see BleProfile.h) the display only sends the boiler
+// setpoint, the pump and valve fields of a profile mode frame are ignored.
+enum BleOutputMode : uint8_t {
+    BLE_OUTPUT_MODE_SIMPLE = 0,
+    BLE_OUTPUT_MODE_ADVANCED = 1,
+    BLE_OUTPUT_MODE_PROFILE = 2,
+};
+
+constexpr uint8_t BLE_OUTPUT_FLAG_VALVE = 1 << 0;
+constexpr uint8_t BLE_OUTPUT_FLAG_PRESSURE_TARGET = 1 << 1;
+
+// Fixed point scales, values are stored as round(value * scale)
+constexpr float BLE_SCALE_TEMPERATURE = 100.0f; // 0.01 °C
+constexpr float BLE_SCALE_PRESSURE = 1000.0f;   // 0.001 bar
+constexpr float BLE_SCALE_FLOW = 1000.0f;       // 0.001 ml/s
+constexpr float BLE_SCALE_RESISTANCE = 1000.0f;
+constexpr float BLE_SCALE_SETPOINT = 10.0f; // 0.1 % pump power, 0.1 °C boiler
+constexpr float BLE_SCALE_TARGET = 100.0f;  // 0.01 bar, 0.01 ml/s
+
+struct __attribute__((packed)) BleFrameHeader {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint8_t flags;
+    uint16_t sequence;  // incremented per frame of a type or per sample of a batch, wraps around
+    uint32_t timestamp; // sender millis()
+};
+
+struct __attribute__((packed)) BleSensorFrame {
+    BleFrameHeader header;
+    int16_t temperature;
+    int16_t pressure;
+    int16_t puckFlow;
+    int16_t pumpFlow;
+    int32_t puckResistance;
+};
+
+// A batch header is followed by count samples. The header sequence and timestamp belong to the first sample, each
+// further sample increments the sequence by one and carries its own offset to the header timestamp.
+struct __attribute__((packed)) BleSensorBatchHeader {
+    BleFrameHeader header;
+    uint8_t count;
+    uint8_t reserved;
+};
+
+struct __attribute__((packed)) BleSensorSample {
+    uint16_t offset; // ms since the header timestamp
+    int16_t temperature;
+    int16_t pressure;
+    int16_t puckFlow;
+    int16_t pumpFlow;
+    int32_t puckResistance;
+};
+
+constexpr size_t BLE_SENSOR_BATCH_MAX_SAMPLES = 16;
+constexpr uint16_t BLE_SENSOR_BATCH_MAX_LATENCY_MS = 250;
+constexpr uint16_t BLE_DEFAULT_MTU = 23;
+constexpr uint16_t BLE_PREFERRED_MTU = 247; // fits a full sensor batch into one notification
+constexpr size_t BLE_ATT_HEADER_SIZE = 3; // opcode and handle of a notification
+
+// Number of samples that fit into a single notification at the given ATT MTU
+constexpr size_t bleSensorBatchCapacity(uint16_t mtu) {
+    return mtu < BLE_ATT_HEADER_SIZE + sizeof(BleSensorBatchHeader)
+               ? 0
+               : std::min(BLE_SENSOR_BATCH_MAX_SAMPLES,
+                          (mtu - BLE_ATT_HEADER_SIZE - sizeof(BleSensorBatchHeader)) / sizeof(BleSensorSample));
+}
+
+// Output control mode simple uses pumpSetpoint, mode advanced uses pressure and flow
+struct __attribute__((packed)) BleOutputControlFrame {
+    BleFrameHeader header;
+    uint8_t mode;
+    uint8_t reserved;
+    int16_t pumpSetpoint;
+    int16_t boilerSetpoint;
+    int16_t pressure;
+    int16_t flow;
+};
+
+// Value of the control trace characteristic, read on demand: the pump control loop ticks recorded since the previous
+// read, see ControlTrace in NayrodPID. first is the tick of the first sample and the samples follow one tick apart, a
+// gap to the end of the previous read means the trace wrapped. count is 0 when there is nothing new or the controller
+// was built without the trace.
+struct __attribute__((packed)) BleControlTraceHeader {
+    BleFrameHeader header;
+    uint32_t first;
+    uint8_t count;
+    uint8_t reserved;
+};
+
+// IEEE 754 floats, the resistance and covariance span too many decades for fixed point
+struct __attribute__((packed)) BleControlTraceSample {
+    float setpoint;
+    float pressure;
+    float pressureDerivative;
+    float resistance;
+    float puckFlow;
+    float covariance;
+    float pumpFlow;
+    float duty;
+};
+
+constexpr size_t BLE_ATT_MAX_VALUE_SIZE = 512;
+constexpr size_t BLE_CONTROL_TRACE_MAX_SAMPLES =
+    (BLE_ATT_MAX_VALUE_SIZE - sizeof(BleControlTraceHeader)) / sizeof(BleControlTraceSample);
+
+static_assert(sizeof(BleFrameHeader) == 10, "BleFrameHeader layout changed");
+static_assert(sizeof(BleSensorFrame) == 22, "BleSensorFrame layout changed");
+static_assert(sizeof(BleOutputControlFrame) == 20, "BleOutputControlFrame layout changed");
+static_assert(sizeof(BleSensorBatchHeader) == 12, "BleSensorBatchHeader layout changed");
+static_assert(sizeof(BleSensorSample) == 14, "BleSensorSample layout changed");
+static_assert(sizeof(BleControlTraceHeader) == 16, "BleControlTraceHeader layout changed");
+static_assert(sizeof(BleControlTraceSample) == 32, "BleControlTraceSample layout changed");
+static_assert(bleSensorBatchCapacity(BLE_PREFERRED_MTU) == BLE_SENSOR_BATCH_MAX_SAMPLES, "Preferred MTU can't fit a full batch");
+
+inline int16_t bleFixed16(float value, float scale) {
+    if (std::isnan(value)) {
+        return 0;
+    }
+    return static_cast<int16_t>(std::clamp(std::round(value * scale), -32768.0f, 32767.0f));
+}
+
+inline int32_t bleFixed32(float value, float scale) {
+    if (std::isnan(value)) {
+        return 0;
+    }
+    return static_cast<int32_t>(std::clamp(static_cast<double>(std::round(value * scale)), -2147483648.0, 2147483647.0));
+}
+
+inline float bleFloat(int32_t value, float scale) { return static_cast<float>(value) / scale; }
+
+inline void initBleFrameHeader(BleFrameHeader &header, BleFrameType type, uint16_t sequence, uint32_t timestamp) {
+    header.magic = BLE_FRAME_MAGIC;
+    header.version = BLE_PROTOCOL_VERSION;
+    header.type = type;
+    header.flags = 0;
+    header.sequence = sequence;
+    header.timestamp = timestamp;
+}
+
+// Copies the frame out of the notification buffer if it is a binary frame of the expected type and size
+template <typename T> bool readBleFrame(const uint8_t *data, size_t length, BleFrameType type, T &frame) {
+    if (length < sizeof(T) || data[0] != BLE_FRAME_MAGIC) {
+        return false;
+    }
+    memcpy(&frame, data, sizeof(T));
+    // Later versions may only append fields
+    return frame.header.version >= 1 && frame.header.type == type;
+}
+
+// Tracks the sequence numbers of received frames to detect lost and reordered notifications
+struct BleSequenceTracker {
+    uint32_t frames = 0;
+    uint32_t dropped = 0;
+    uint32_t outOfOrder = 0;
+    uint16_t last = 0;
+
+    // Returns false for a frame that is older than the last one and should be ignored. A batch of count samples
+    // starting at sequence counts as count frames.
+    bool accept(uint16_t sequence, uint16_t count = 1) {
+        const auto end = static_cast<uint16_t>(sequence + count - 1);
+        if (frames == 0) {
+            frames = count;
+            last = end;
+            return true;
+        }
+        const auto delta = static_cast<int16_t>(sequence - last);
+        if (delta <= 0) {
+            outOfOrder++;
+            return false;
+        }
+        frames += count;
+        dropped += delta - 1;
+        last = end;
+        return true;
+    }
+
+    void reset() { *this = BleSequenceTracker{}; }
+};
+
+#endif // BLEPROTOCOL_H
@@ -1,29 +1,104 @@
 #include "NimBLEClientController.h"
 
-constexpr size_t MAX_CONNECT_RETRIES = 3;
 constexpr size_t BLE_SCAN_DURATION_SECONDS = 10;
+constexpr uint32_t BLE_CONNECT_TIMEOUT_SECONDS = 5;
 
 NimBLEClientController::NimBLEClientController() : client(nullptr) {}
 
 void NimBLEClientController::initClient() {
     NimBLEDevice::init("GPBLC");
     NimBLEDevice::setPower(ESP_PWR_LVL_P9); // Set to maximum power
-    NimBLEDevice::setMTU(128);
+    NimBLEDevice::setMTU(BLE_PREFERRED_MTU);
     client = NimBLEDevice::createClient();
     client->setClientCallbacks(this);
     if (client == nullptr)
         ESP_LOGE(LOG_TAG, "Failed to create BLE client");
-
-    // Scan for BLE Server
-    scan();
+    // Connect with the idle parameters, the link manager adjusts them to the link mode afterwards
+    client->setConnectionParams(BLE_CONN_PARAMS_IDLE.minInterval, BLE_CONN_PARAMS_IDLE.maxInterval,
+                                BLE_CONN_PARAMS_IDLE.latency, BLE_CONN_PARAMS_IDLE.timeout);
+    client->setConnectTimeout(BLE_CONNECT_TIMEOUT_SECONDS);
+
+    // Scanning and connecting block, they run in their own task instead of the caller's loop
+    xTaskCreatePinnedToCore(connectionTask, "NimBLEClient::connect", configMINIMAL_STACK_SIZE * 6, this, 1,
+                            &connectionTaskHandle, 0);
 }
 
+// Blocks until the scan times out or the server was found
 void NimBLEClientController::scan() {
     NimBLEScan *pBLEScan = NimBLEDevice::getScan();
     pBLEScan->clearDuplicateCache();
     pBLEScan->setAdvertisedDeviceCallbacks(this); // Use this class as the callback handler
     pBLEScan->setActiveScan(true);
-    pBLEScan->start(BLE_SCAN_DURATION_SECONDS, nullptr, false);
+    pBLEScan->start(BLE_SCAN_DURATION_SECONDS, false);
+    pBLEScan->clearResults();
+}
+
+void NimBLEClientController::connectionTask(void *arg) {
+    auto *controller = static_cast<NimBLEClientController *>(arg);
+    while (true) {
+        controller->updateConnection();
+    }
+}
+
+// Runs one step of the connection state machine on the connection task
+void NimBLEClientController::updateConnection() {
+    switch (connectionState) {
+    case BleConnectionState::SCANNING:
+        scan();
+        if (serverFound) {
+            connectAttempts = 0;
+            connectionState = BleConnectionState::CONNECTING;
+        } else {
+            enterBackoff();
+        }
+        break;
+    case BleConnectionState::CONNECTING:
+        if (connectToServer()) {
+            const unsigned long now = millis();
+            if (disconnectedAt != 0) {
+                lastReconnectTime = now - disconnectedAt;
+                maxReconnectTime = std::max(maxReconnectTime, lastReconnectTime);
+                disconnectedAt = 0;
+            }
+            connects++;
+            connectAttempts = 0;
+            backoff = BLE_RECONNECT_BACKOFF_MIN_MS;
+            connectionState = BleConnectionState::CONNECTED;
+            connected = true;
+        } else {
+            failedConnects++;
+            // The cached address may be stale, e.g. after the controller board was replaced
+            if (++connectAttempts >= BLE_DIRECT_CONNECT_ATTEMPTS) {
+                serverFound = false;
+            }
+            enterBackoff();
+        }
+        break;
+    case BleConnectionState::CONNECTED:
+        // Woken by onDisconnect, the timeout only guards against a missed notification
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+        if (!client->isConnected()) {
+            ESP_LOGI(LOG_TAG, "Disconnected from server, reconnecting to %s", serverAddress.toString().c_str());
+            disconnectedAt = millis();
+            connectAttempts = 0;
+            connectionState = BleConnectionState::CONNECTING;
+        }
+        break;
+    case BleConnectionState::BACKOFF:
+        vTaskDelay(pdMS_TO_TICKS(backoff));
+        backoff = std::min(backoff * 2, BLE_RECONNECT_BACKOFF_MAX_MS);
+        connectionState = serverFound ? BleConnectionState::CONNECTING : BleConnectionState::SCANNING;
+        break;
+    }
+}
+
+void NimBLEClientController::enterBackoff() {
+    ESP_LOGI(LOG_TAG, "Retrying BLE connection in %lu ms", backoff);
+    connectionState = BleConnectionState::BACKOFF;
+}
+
+BleConnectionStats NimBLEClientController::getConnectionStats() const {
+    return BleConnectionStats{connectionState, connects, failedConnects, lastReconnectTime, maxReconnectTime};
 }
 
 void NimBLEClientController::tare() {
@@ -50,33 +125,30 @@ void NimBLEClientController::registerVolumetricMeasurementCallback(const float_c
 
 void NimBLEClientController::registerTofMeasurementCallback(const int_callback_t &callback) { tofMeasurementCallback = callback; }
 
-std::string NimBLEClientController::readInfo() const {
-    if (infoChar != nullptr && infoChar->canRead()) {
-        return infoChar->readValue();
-    }
-    return "";
+void NimBLEClientController::registerProfileStatusCallback(const profile_status_callback_t &callback) {
+    profileStatusCallback = callback;
 }
 
-bool NimBLEClientController::connectToServer() {
-    ESP_LOGI(LOG_TAG, "Connecting to advertised device");
-
-    unsigned int tries = 0;
-    while (!client->isConnected()) {
-        if (!client->connect(NimBLEAddress(serverDevice->getAddress()))) {
-            ESP_LOGE(LOG_TAG, "Failed connecting to BLE server. Retrying...");
-        }
+void NimBLEClientController::setBinaryProtocol(uint8_t version) {
+    binaryProtocol = std::min(version, BLE_PROTOCOL_VERSION);
+    ESP_LOGI(LOG_TAG, "Using %s sensor and control protocol", binaryProtocol > 0 ? "binary" : "CSV");
+}
 
-        tries++;
+void NimBLEClientController::loop() { linkManager.loop(); }
 
-        if (tries >= MAX_CONNECT_RETRIES) {
-            ESP_LOGE(LOG_TAG, "Connection timeout! Unable to connect to BLE server.");
-            scan();
-            return false; // Exit the connection attempt if timed out
-        }
+bool NimBLEClientController::takeConnected() { return connected.exchange(false); }
 
-        delay(500); // Add a small delay to avoid busy-waiting
+bool NimBLEClientController::connectToServer() {
+    ESP_LOGI(LOG_TAG, "Connecting to %s", serverAddress.toString().c_str());
+    if (!client->connect(serverAddress)) {
+        ESP_LOGE(LOG_TAG, "Failed connecting to BLE server");
+        return false;
     }
-    client->updateConnParams(6, 8, 0, 400);
+    linkManager.onConnect(client);
+    // The controller restarts its sequence numbers for every connection, binary frames are negotiated again
+    sensorSequence.reset();
+    binaryProtocol = 0;
+    resetControlState();
 
     ESP_LOGI(LOG_TAG, "Successfully connected to BLE server");
 
@@ -84,6 +156,7 @@ bool NimBLEClientController::connectToServer() {
     NimBLERemoteService *pRemoteService = client->getService(NimBLEUUID(SERVICE_UUID));
     if (pRemoteService == nullptr) {
         ESP_LOGE(LOG_TAG, "Error getting remote service");
+        client->disconnect();
         return false;
     }
 
@@ -99,75 +172,122 @@ bool NimBLEClientController::connectToServer() {
     volumetricTareChar = pRemoteService->getCharacteristic(NimBLEUUID(VOLUMETRIC_TARE_UUID));
     ledControlChar = pRemoteService->getCharacteristic(NimBLEUUID(LED_CONTROL_UUID));
 
-    // Obtain the remote notify characteristic and subscribe to it
+    // Obtain the remote notify characteristics and subscribe to them
+    notifyDecoders.reset(pRemoteService->getStartHandle());
+    errorChar = subscribe(pRemoteService, ERROR_CHAR_UUID, &NimBLEClientController::decodeError);
+    brewBtnChar = subscribe(pRemoteService, BREW_BTN_UUID, &NimBLEClientController::decodeBrewButton);
+    steamBtnChar = subscribe(pRemoteService, STEAM_BTN_UUID, &NimBLEClientController::decodeSteamButton);
+    autotuneResultChar = subscribe(pRemoteService, AUTOTUNE_RESULT_UUID, &NimBLEClientController::decodeAutotuneResult);
+    sensorChar = subscribe(pRemoteService, SENSOR_DATA_UUID, &NimBLEClientController::decodeSensorData);
+    volumetricMeasurementChar =
+        subscribe(pRemoteService, VOLUMETRIC_MEASUREMENT_UUID, &NimBLEClientController::decodeVolumetricMeasurement);
+    tofMeasurementChar = subscribe(pRemoteService, TOF_MEASUREMENT_UUID, &NimBLEClientController::decodeTofMeasurement);
+    profileChar = subscribe(pRemoteService, PROFILE_UUID, &NimBLEClientController::decodeProfileStatus);
+
+    serverInfo = infoChar != nullptr && infoChar->canRead() ? infoChar->readValue() : "";
+    return true;
+}
 
-    errorChar = pRemoteService->getCharacteristic(NimBLEUUID(ERROR_CHAR_UUID));
-    if (errorChar->canNotify()) {
-        errorChar->subscribe(true, std::bind(&NimBLEClientController::notifyCallback, this, std::placeholders::_1,
-                                             std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+void NimBLEClientController::sendAdvancedOutputControl(bool valve, float boilerSetpoint, bool pressureTarget, float pressure,
+                                                       float flow) {
+    if (binaryProtocol > 0) {
+        sendOutputControlFrame(BLE_OUTPUT_MODE_ADVANCED, valve, 100.0f, boilerSetpoint, pressureTarget, pressure, flow);
+        return;
     }
-
-    brewBtnChar = pRemoteService->getCharacteristic(NimBLEUUID(BREW_BTN_UUID));
-    if (brewBtnChar != nullptr && brewBtnChar->canNotify()) {
-        brewBtnChar->subscribe(true, std::bind(&NimBLEClientController::notifyCallback, this, std::placeholders::_1,
-                                               std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+    if (client->isConnected() && outputControlChar != nullptr) {
+        char str[30];
+        snprintf(str, sizeof(str), "%d,%d,%.1f,%.1f,%d,%.2f,%.2f", 1, valve ? 1 : 0, 100.0f, boilerSetpoint,
+                 pressureTarget ? 1 : 0, pressure, flow);
+        sendOutputControlString(str);
     }
+}
 
-    steamBtnChar = pRemoteService->getCharacteristic(NimBLEUUID(STEAM_BTN_UUID));
-    if (steamBtnChar != nullptr && steamBtnChar->canNotify()) {
-        steamBtnChar->subscribe(true, std::bind(&NimBLEClientController::notifyCallback, this, std::placeholders::_1,
-                                                std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+void NimBLEClientController::sendOutputControl(bool valve, float pumpSetpoint, float boilerSetpoint) {
+    if (binaryProtocol > 0) {
+        sendOutputControlFrame(BLE_OUTPUT_MODE_SIMPLE, valve, pumpSetpoint, boilerSetpoint, false, 0.0f, 0.0f);
+        return;
     }
-
-    autotuneResultChar = pRemoteService->getCharacteristic(NimBLEUUID(AUTOTUNE_RESULT_UUID));
-    if (autotuneResultChar != nullptr && autotuneResultChar->canNotify()) {
-        autotuneResultChar->subscribe(true, std::bind(&NimBLEClientController::notifyCallback, this, std::placeholders::_1,
-                                                      std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+    if (client->isConnected() && outputControlChar != nullptr) {
+        char str[30];
+        snprintf(str, sizeof(str), "%d,%d,%.1f,%.1f", 0, valve ? 1 : 0, pumpSetpoint, boilerSetpoint);
+        sendOutputControlString(str);
     }
+}
 
-    sensorChar = pRemoteService->getCharacteristic(NimBLEUUID(SENSOR_DATA_UUID));
-    if (sensorChar != nullptr && sensorChar->canNotify()) {
-        sensorChar->subscribe(true, std::bind(&NimBLEClientController::notifyCallback, this, std::placeholders::_1,
-                                              std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
-    }
+// Only the boiler setpoint is used while the controller runs a profile
+void NimBLEClientController::sendProfileOutputControl(float boilerSetpoint) {
+    sendOutputControlFrame(BLE_OUTPUT_MODE_PROFILE, false, 0.0f, boilerSetpoint, false, 0.0f, 0.0f);
+}
 
-    volumetricMeasurementChar = pRemoteService->getCharacteristic(NimBLEUUID(VOLUMETRIC_MEASUREMENT_UUID));
-    if (volumetricMeasurementChar != nullptr && volumetricMeasurementChar->canNotify()) {
-        volumetricMeasurementChar->subscribe(true,
-                                             std::bind(&NimBLEClientController::notifyCallback, this, std::placeholders::_1,
-                                                       std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+bool NimBLEClientController::sendProfile(const BleProfileFrame &profile) {
+    if (!client->isConnected() || profileChar == nullptr) {
+        return false;
     }
+    BleProfileFrame frame = profile;
+    initBleFrameHeader(frame.header, BLE_FRAME_PROFILE, profileSequence++, millis());
+    // Larger than the MTU, sent as a long write
+    return profileChar->writeValue(reinterpret_cast<const uint8_t *>(&frame), bleProfileFrameSize(frame.phaseCount), true);
+}
 
-    tofMeasurementChar = pRemoteService->getCharacteristic(NimBLEUUID(TOF_MEASUREMENT_UUID));
-    if (tofMeasurementChar != nullptr && tofMeasurementChar->canNotify()) {
-        tofMeasurementChar->subscribe(true, std::bind(&NimBLEClientController::notifyCallback, this, std::placeholders::_1,
-                                                      std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+bool NimBLEClientController::sendProfileControl(uint8_t command, uint8_t phase) {
+    if (!client->isConnected() || profileChar == nullptr) {
+        return false;
     }
-
-    delay(500);
-
-    readyForConnection = false;
-    return true;
+    BleProfileControlFrame frame{};
+    initBleFrameHeader(frame.header, BLE_FRAME_PROFILE_CONTROL, profileSequence++, millis());
+    frame.command = command;
+    frame.phase = phase;
+    return profileChar->writeValue(reinterpret_cast<const uint8_t *>(&frame), sizeof(frame), true);
 }
 
-void NimBLEClientController::sendAdvancedOutputControl(bool valve, float boilerSetpoint, bool pressureTarget, float pressure,
-                                                       float flow) {
+void NimBLEClientController::sendOutputControlFrame(uint8_t mode, bool valve, float pumpSetpoint, float boilerSetpoint,
+                                                    bool pressureTarget, float pressure, float flow) {
     if (client->isConnected() && outputControlChar != nullptr) {
-        char str[30];
-        snprintf(str, sizeof(str), "%d,%d,%.1f,%.1f,%d,%.2f,%.2f", 1, valve ? 1 : 0, 100.0f, boilerSetpoint,
-                 pressureTarget ? 1 : 0, pressure, flow);
-        _lastOutputControl = String(str);
-        outputControlChar->writeValue(_lastOutputControl, false);
+        // Sequence and timestamp are filled in after the comparison with the last command
+        BleOutputControlFrame frame{};
+        initBleFrameHeader(frame.header, BLE_FRAME_OUTPUT_CONTROL, 0, 0);
+        frame.header.flags = (valve ? BLE_OUTPUT_FLAG_VALVE : 0) | (pressureTarget ? BLE_OUTPUT_FLAG_PRESSURE_TARGET : 0);
+        frame.mode = mode;
+        frame.pumpSetpoint = bleFixed16(pumpSetpoint, BLE_SCALE_SETPOINT);
+        frame.boilerSetpoint = bleFixed16(boilerSetpoint, BLE_SCALE_SETPOINT);
+        frame.pressure = bleFixed16(pressure, BLE_SCALE_TARGET);
+        frame.flow = bleFixed16(flow, BLE_SCALE_TARGET);
+        const bool changed = memcmp(&frame, &_lastOutputControlFrame, sizeof(frame)) != 0;
+        if (!isControlWriteDue(changed, lastOutputControlWrite)) {
+            return;
+        }
+        _lastOutputControlFrame = frame;
+        frame.header.sequence = outputSequence++;
+        frame.header.timestamp = millis();
+        linkManager.onWrite(outputControlChar->writeValue(reinterpret_cast<const uint8_t *>(&frame), sizeof(frame), false));
     }
 }
 
-void NimBLEClientController::sendOutputControl(bool valve, float pumpSetpoint, float boilerSetpoint) {
-    if (client->isConnected() && outputControlChar != nullptr) {
-        char str[30];
-        snprintf(str, sizeof(str), "%d,%d,%.1f,%.1f", 0, valve ? 1 : 0, pumpSetpoint, boilerSetpoint);
-        _lastOutputControl = String(str);
-        outputControlChar->writeValue(_lastOutputControl, false);
+void NimBLEClientController::sendOutputControlString(const char *control) {
+    if (!isControlWriteDue(_lastOutputControl != control, lastOutputControlWrite)) {
+        return;
+    }
+    _lastOutputControl = control;
+    linkManager.onWrite(outputControlChar->writeValue(_lastOutputControl, false));
+}
+
+// Changes are written immediately, an unchanged command is repeated once per keepalive interval in case a write
+// without response got lost
+bool NimBLEClientController::isControlWriteDue(bool changed, unsigned long &lastWrite) {
+    const unsigned long now = millis();
+    if (!changed && now - lastWrite < OUTPUT_CONTROL_KEEPALIVE_MS) {
+        suppressedControlWrites++;
+        return false;
     }
+    lastWrite = now;
+    controlWrites++;
+    return true;
+}
+
+void NimBLEClientController::resetControlState() {
+    _lastOutputControl = "";
+    _lastOutputControlFrame = BleOutputControlFrame{};
+    lastAltControl = -1;
 }
 
 void NimBLEClientController::sendPidSettings(const String &pid) {
@@ -196,7 +316,11 @@ void NimBLEClientController::sendLedControl(uint8_t channel, uint8_t brightness)
 
 void NimBLEClientController::sendAltControl(bool pinState) {
     if (altControlChar != nullptr && client->isConnected()) {
-        altControlChar->writeValue(pinState ? "1" : "0");
+        if (!isControlWriteDue(lastAltControl != pinState, lastAltControlWrite)) {
+            return;
+        }
+        lastAltControl = pinState;
+        linkManager.onWrite(altControlChar->writeValue(pinState ? "1" : "0"));
     }
 }
 
@@ -214,8 +338,6 @@ void NimBLEClientController::sendAutotune(int testTime, int samples) {
     }
 }
 
-bool NimBLEClientController::isReadyForConnection() const { return readyForConnection; }
-
 bool NimBLEClientController::isConnected() { return client->isConnected(); }
 
 // BLEAdvertisedDeviceCallbacks override
@@ -227,79 +349,162 @@ void NimBLEClientController::onResult(NimBLEAdvertisedDevice *advertisedDevice)
         ESP_LOGI(LOG_TAG, "Found BLE service. Checking for ID...");
         if (advertisedDevice->isAdvertisingService(NimBLEUUID(SERVICE_UUID))) {
             ESP_LOGI(LOG_TAG, "Found target BLE device. Connecting...");
+            // Kept for direct reconnects without scanning
+            serverAddress = advertisedDevice->getAddress();
+            serverFound = true;
             NimBLEDevice::getScan()->stop(); // Stop scanning once we find the correct device
-            serverDevice = advertisedDevice;
-            readyForConnection = true;
         }
     }
 }
 
 void NimBLEClientController::onDisconnect(NimBLEClient *pServer) {
-    ESP_LOGI(LOG_TAG, "Disconnected from server, trying to reconnect...");
-    scan();
+    if (connectionTaskHandle != nullptr) {
+        xTaskNotifyGive(connectionTaskHandle);
+    }
+}
+
+NimBLERemoteCharacteristic *NimBLEClientController::subscribe(NimBLERemoteService *service, const char *uuid,
+                                                              NotifyDecoder decoder) {
+    NimBLERemoteCharacteristic *characteristic = service->getCharacteristic(NimBLEUUID(uuid));
+    if (characteristic == nullptr || !characteristic->canNotify()) {
+        return characteristic;
+    }
+    if (!notifyDecoders.add(characteristic->getHandle(), decoder)) {
+        ESP_LOGE(LOG_TAG, "No dispatch slot for characteristic %s (handle %d)", uuid, characteristic->getHandle());
+        return characteristic;
+    }
+    characteristic->subscribe(true, std::bind(&NimBLEClientController::notifyCallback, this, std::placeholders::_1,
+                                              std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+    return characteristic;
 }
 
 // Notification callback
-void NimBLEClientController::notifyCallback(NimBLERemoteCharacteristic *pRemoteCharacteristic, uint8_t *pData, size_t,
-                                            bool) const {
-    if (pRemoteCharacteristic->getUUID().equals(NimBLEUUID(ERROR_CHAR_UUID))) {
-        int errorCode = atoi((char *)pData);
-        ESP_LOGV(LOG_TAG, "Error read: %d", errorCode);
-        if (remoteErrorCallback != nullptr) {
-            remoteErrorCallback(errorCode);
-        }
+void NimBLEClientController::notifyCallback(NimBLERemoteCharacteristic *pRemoteCharacteristic, uint8_t *pData, size_t length,
+                                            bool) {
+    linkManager.onNotification();
+    if (const NotifyDecoder *decoder = notifyDecoders.find(pRemoteCharacteristic->getHandle())) {
+        (this->*(*decoder))(pData, length);
     }
-    if (pRemoteCharacteristic->getUUID().equals(NimBLEUUID(BREW_BTN_UUID))) {
-        int brewButtonStatus = atoi((char *)pData);
-        ESP_LOGV(LOG_TAG, "brew button: %d", brewButtonStatus);
-        if (brewBtnCallback != nullptr) {
-            brewBtnCallback(brewButtonStatus);
-        }
+}
+
+void NimBLEClientController::decodeError(const uint8_t *data, size_t) {
+    int errorCode = atoi((const char *)data);
+    ESP_LOGV(LOG_TAG, "Error read: %d", errorCode);
+    if (remoteErrorCallback != nullptr) {
+        remoteErrorCallback(errorCode);
     }
-    if (pRemoteCharacteristic->getUUID().equals(NimBLEUUID(STEAM_BTN_UUID))) {
-        int steamButtonStatus = atoi((char *)pData);
-        ESP_LOGV(LOG_TAG, "steam button: %d", steamButtonStatus);
-        if (steamBtnCallback != nullptr) {
-            steamBtnCallback(steamButtonStatus);
-        }
+}
+
+void NimBLEClientController::decodeBrewButton(const uint8_t *data, size_t) {
+    int brewButtonStatus = atoi((const char *)data);
+    ESP_LOGV(LOG_TAG, "brew button: %d", brewButtonStatus);
+    if (brewBtnCallback != nullptr) {
+        brewBtnCallback(brewButtonStatus);
     }
-    if (pRemoteCharacteristic->getUUID().equals(NimBLEUUID(SENSOR_DATA_UUID))) {
-        String data = String((char *)pData);
-        float temperature = get_token(data, 0, ',').toFloat();
-        float pressure = get_token(data, 1, ',').toFloat();
-        float puckFlow = get_token(data, 2, ',').toFloat();
-        float pumpFlow = get_token(data, 3, ',').toFloat();
-        float puckResistance = get_token(data, 4, ',').toFloat();
-
-        ESP_LOGV(LOG_TAG,
-                 "Received sensor data: temperature=%.1f, pressure=%.1f, puck_flow=%.1f, pump_flow=%.1f, puck_resistance=%.1f",
-                 temperature, pressure, puckFlow, pumpFlow, puckResistance);
+}
+
+void NimBLEClientController::decodeSteamButton(const uint8_t *data, size_t) {
+    int steamButtonStatus = atoi((const char *)data);
+    ESP_LOGV(LOG_TAG, "steam button: %d", steamButtonStatus);
+    if (steamBtnCallback != nullptr) {
+        steamBtnCallback(steamButtonStatus);
+    }
+}
+
+void NimBLEClientController::decodeSensorData(const uint8_t *data, size_t length) {
+    BleSensorBatchHeader batch{};
+    if (readBleFrame(data, length, BLE_FRAME_SENSOR_BATCH, batch)) {
+        decodeSensorBatch(batch, data, length);
+        return;
+    }
+    BleSensorFrame frame{};
+    if (readBleFrame(data, length, BLE_FRAME_SENSOR, frame)) {
+        if (!sensorSequence.accept(frame.header.sequence)) {
+            ESP_LOGV(LOG_TAG, "Ignoring out of order sensor frame %u", frame.header.sequence);
+            return;
+        }
         if (sensorCallback != nullptr) {
-            sensorCallback(temperature, pressure, puckFlow, pumpFlow, puckResistance);
+            sensorCallback(bleFloat(frame.temperature, BLE_SCALE_TEMPERATURE), bleFloat(frame.pressure, BLE_SCALE_PRESSURE),
+                           bleFloat(frame.puckFlow, BLE_SCALE_FLOW), bleFloat(frame.pumpFlow, BLE_SCALE_FLOW),
+                           bleFloat(frame.puckResistance, BLE_SCALE_RESISTANCE), millis());
         }
+        return;
     }
-    if (pRemoteCharacteristic->getUUID().equals(NimBLEUUID(AUTOTUNE_RESULT_UUID))) {
-        String settings = String((char *)pData);
-        ESP_LOGV(LOG_TAG, "autotune result: %s", settings.c_str());
-        if (autotuneResultCallback != nullptr) {
-            float Kp = get_token(settings, 0, ',').toFloat();
-            float Ki = get_token(settings, 1, ',').toFloat();
-            float Kd = get_token(settings, 2, ',').toFloat();
-            autotuneResultCallback(Kp, Ki, Kd);
-        }
+    String sensorData = String((const char *)data);
+    float temperature = get_token(sensorData, 0, ',').toFloat();
+    float pressure = get_token(sensorData, 1, ',').toFloat();
+    float puckFlow = get_token(sensorData, 2, ',').toFloat();
+    float pumpFlow = get_token(sensorData, 3, ',').toFloat();
+    float puckResistance = get_token(sensorData, 4, ',').toFloat();
+
+    ESP_LOGV(LOG_TAG,
+             "Received sensor data: temperature=%.1f, pressure=%.1f, puck_flow=%.1f, pump_flow=%.1f, puck_resistance=%.1f",
+             temperature, pressure, puckFlow, pumpFlow, puckResistance);
+    if (sensorCallback != nullptr) {
+        sensorCallback(temperature, pressure, puckFlow, pumpFlow, puckResistance, millis());
     }
-    if (pRemoteCharacteristic->getUUID().equals(NimBLEUUID(VOLUMETRIC_MEASUREMENT_UUID))) {
-        float value = atof((char *)pData);
-        ESP_LOGV(LOG_TAG, "Volumetric measurement: %.2f", value);
-        if (volumetricMeasurementCallback != nullptr) {
-            volumetricMeasurementCallback(value);
-        }
+}
+
+void NimBLEClientController::decodeSensorBatch(const BleSensorBatchHeader &batch, const uint8_t *data, size_t length) {
+    const uint8_t *samples = data + sizeof(BleSensorBatchHeader);
+    if (batch.count == 0 || length < sizeof(BleSensorBatchHeader) + batch.count * sizeof(BleSensorSample)) {
+        ESP_LOGW(LOG_TAG, "Ignoring truncated sensor batch of %d samples (%u bytes)", batch.count, static_cast<unsigned>(length));
+        return;
     }
-    if (pRemoteCharacteristic->getUUID().equals(NimBLEUUID(TOF_MEASUREMENT_UUID))) {
-        int value = atoi((char *)pData);
-        ESP_LOGV(LOG_TAG, "ToF measurement: %.2f", value);
-        if (tofMeasurementCallback != nullptr) {
-            tofMeasurementCallback(value);
-        }
+    if (!sensorSequence.accept(batch.header.sequence, batch.count)) {
+        ESP_LOGV(LOG_TAG, "Ignoring out of order sensor batch %u", batch.header.sequence);
+        return;
+    }
+    if (sensorCallback == nullptr) {
+        return;
+    }
+    // Samples are placed on the local clock relative to the newest one, which is taken as received now
+    BleSensorSample sample{};
+    memcpy(&sample, samples + (batch.count - 1) * sizeof(BleSensorSample), sizeof(sample));
+    const unsigned long received = millis();
+    const uint16_t newest = sample.offset;
+    for (uint8_t i = 0; i < batch.count; i++) {
+        memcpy(&sample, samples + i * sizeof(BleSensorSample), sizeof(sample));
+        sensorCallback(bleFloat(sample.temperature, BLE_SCALE_TEMPERATURE), bleFloat(sample.pressure, BLE_SCALE_PRESSURE),
+                       bleFloat(sample.puckFlow, BLE_SCALE_FLOW), bleFloat(sample.pumpFlow, BLE_SCALE_FLOW),
+                       bleFloat(sample.puckResistance, BLE_SCALE_RESISTANCE), received - (newest - sample.offset));
+    }
+}
+
+void NimBLEClientController::decodeAutotuneResult(const uint8_t *data, size_t) {
+    String settings = String((const char *)data);
+    ESP_LOGV(LOG_TAG, "autotune result: %s", settings.c_str());
+    if (autotuneResultCallback != nullptr) {
+        float Kp = get_token(settings, 0, ',').toFloat();
+        float Ki = get_token(settings, 1, ',').toFloat();
+        float Kd = get_token(settings, 2, ',').toFloat();
+        autotuneResultCallback(Kp, Ki, Kd);
+    }
+}
+
+void NimBLEClientController::decodeVolumetricMeasurement(const uint8_t *data, size_t) {
+    float value = atof((const char *)data);
+    ESP_LOGV(LOG_TAG, "Volumetric measurement: %.2f", value);
+    if (volumetricMeasurementCallback != nullptr) {
+        volumetricMeasurementCallback(value);
+    }
+}
+
+void NimBLEClientController::decodeTofMeasurement(const uint8_t *data, size_t) {
+    int value = atoi((const char *)data);
+    ESP_LOGV(LOG_TAG, "ToF measurement: %d", value);
+    if (tofMeasurementCallback != nullptr) {
+        tofMeasurementCallback(value);
+    }
+}
+
+void NimBLEClientController::decodeProfileStatus(const uint8_t *data, size_t length) {
+    BleProfileStatusFrame frame{};
+    if (!readBleFrame(data, length, BLE_FRAME_PROFILE_STATUS, frame)) {
+        return;
+    }
+    ESP_LOGV(LOG_TAG, "Profile status: state=%d, phase=%d", frame.state, frame.phase);
+    if (profileStatusCallback != nullptr) {
+        profileStatusCallback(frame.state, frame.phase);
     }
 }
@@ -1,18 +1,55 @@
 #ifndef NIMBLECLIENTCONTROLLER_H
 #define NIMBLECLIENTCONTROLLER_H
 
+#include "BleHandleTable.h"
+#include "BleLinkManager.h"
 #include "NimBLEComm.h"
 #include "cstring"
+#include <atomic>
+
+constexpr size_t BLE_NOTIFY_CHARACTERISTICS = 8;
+// Unchanged output and alt control commands are repeated at this interval only
+constexpr unsigned long OUTPUT_CONTROL_KEEPALIVE_MS = 1000;
+
+// Delay before the next connection attempt, doubled after every failed one
+constexpr unsigned long BLE_RECONNECT_BACKOFF_MIN_MS = 250;
+constexpr unsigned long BLE_RECONNECT_BACKOFF_MAX_MS = 8000;
+// Failed connections to the cached server address before scanning for it again
+constexpr uint8_t BLE_DIRECT_CONNECT_ATTEMPTS = 3;
+
+enum class BleConnectionState : uint8_t { SCANNING, CONNECTING, CONNECTED, BACKOFF };
+
+struct BleConnectionStats {
+    BleConnectionState state;
+    uint32_t connects;
+    uint32_t failedConnects;
+    uint32_t lastReconnectTime; // ms from losing the connection to being subscribed again
+    uint32_t maxReconnectTime;  // ms
+};
+
+// Output and alt control writes since boot
+struct ControlWriteStats {
+    uint32_t written;
+    uint32_t suppressed;
+};
 
 class NimBLEClientController : public NimBLEAdvertisedDeviceCallbacks, NimBLEClientCallbacks {
   public:
     NimBLEClientController();
     void initClient();
-    bool connectToServer();
+    void loop();
+    // True once after every established connection, the server info is up to date by then
+    bool takeConnected();
+    const std::string &getServerInfo() const { return serverInfo; }
+    BleConnectionStats getConnectionStats() const;
 
     void sendAdvancedOutputControl(bool valve, float boilerSetpoint, bool pressureTarget, float pressure, float flow);
 
     void sendOutputControl(bool valve, float pumpSetpoint, float boilerSetpoint);
+    void sendProfileOutputControl(float boilerSetpoint);
+    // Blocking writes with response, must not be called from a BLE callback
+    bool sendProfile(const BleProfileFrame &profile);
+    bool sendProfileControl(uint8_t command, uint8_t phase);
     void sendAltControl(bool pinState);
     void sendPing();
     void sendAutotune(int testTime, int samples);
@@ -20,9 +57,7 @@ class NimBLEClientController : public NimBLEAdvertisedDeviceCallbacks, NimBLECli
     void sendPumpModelCoeffs(const String &pumpModelCoeffs);
     void setPressureScale(float scale);
     void sendLedControl(uint8_t channel, uint8_t brightness);
-    bool isReadyForConnection() const;
     bool isConnected();
-    void scan();
     void tare();
     void registerRemoteErrorCallback(const remote_err_callback_t &callback);
     void registerBrewBtnCallback(const brew_callback_t &callback);
@@ -31,7 +66,13 @@ class NimBLEClientController : public NimBLEAdvertisedDeviceCallbacks, NimBLECli
     void registerAutotuneResultCallback(const pid_control_callback_t &callback);
     void registerVolumetricMeasurementCallback(const float_callback_t &callback);
     void registerTofMeasurementCallback(const int_callback_t &callback);
-    std::string readInfo() const;
+    void registerProfileStatusCallback(const profile_status_callback_t &callback);
+    void setBinaryProtocol(uint8_t version);
+    uint8_t getBinaryProtocol() const { return binaryProtocol; }
+    const BleSequenceTracker &getSensorStats() const { return sensorSequence; }
+    void setLinkMode(BleLinkMode mode) { linkManager.setMode(mode); }
+    BleLinkStats getLinkStats() const { return linkManager.getStats(); }
+    ControlWriteStats getControlWriteStats() const { return ControlWriteStats{controlWrites, suppressedControlWrites}; }
     NimBLEClient *getClient() const { return client; };
 
   private:
@@ -58,8 +99,22 @@ class NimBLEClientController : public NimBLEAdvertisedDeviceCallbacks, NimBLECli
     NimBLERemoteCharacteristic *volumetricTareChar = nullptr;
     NimBLERemoteCharacteristic *ledControlChar = nullptr;
     NimBLERemoteCharacteristic *tofMeasurementChar = nullptr;
-    NimBLEAdvertisedDevice *serverDevice = nullptr;
-    bool readyForConnection = false;
+    NimBLERemoteCharacteristic *profileChar = nullptr;
+
+    // Connection state machine, owned by the connection task
+    xTaskHandle connectionTaskHandle = nullptr;
+    BleConnectionState connectionState = BleConnectionState::SCANNING;
+    NimBLEAddress serverAddress;
+    bool serverFound = false;
+    uint8_t connectAttempts = 0;
+    unsigned long backoff = BLE_RECONNECT_BACKOFF_MIN_MS;
+    unsigned long disconnectedAt = 0;
+    std::string serverInfo;
+    std::atomic<bool> connected{false};
+    uint32_t connects = 0;
+    uint32_t failedConnects = 0;
+    uint32_t lastReconnectTime = 0;
+    uint32_t maxReconnectTime = 0;
 
     remote_err_callback_t remoteErrorCallback = nullptr;
     brew_callback_t brewBtnCallback = nullptr;
@@ -68,8 +123,26 @@ class NimBLEClientController : public NimBLEAdvertisedDeviceCallbacks, NimBLECli
     sensor_read_callback_t sensorCallback = nullptr;
     float_callback_t volumetricMeasurementCallback = nullptr;
     int_callback_t tofMeasurementCallback = nullptr;
+    profile_status_callback_t profileStatusCallback = nullptr;
 
     String _lastOutputControl = "";
+    BleOutputControlFrame _lastOutputControlFrame{};
+    unsigned long lastOutputControlWrite = 0;
+    int lastAltControl = -1;
+    unsigned long lastAltControlWrite = 0;
+    uint32_t controlWrites = 0;
+    uint32_t suppressedControlWrites = 0;
+    uint8_t binaryProtocol = 0;
+    uint16_t outputSequence = 0;
+    uint16_t profileSequence = 0;
+    BleSequenceTracker sensorSequence;
+    BleLinkManager linkManager;
+
+    static void connectionTask(void *arg);
+    void updateConnection();
+    void enterBackoff();
+    void scan();
+    bool connectToServer();
 
     // BLEAdvertisedDeviceCallbacks override
     void onResult(NimBLEAdvertisedDevice *advertisedDevice) override;
@@ -77,8 +150,26 @@ class NimBLEClientController : public NimBLEAdvertisedDeviceCallbacks, NimBLECli
     // NimBLEClientCallbacks override
     void onDisconnect(NimBLEClient *pServer) override;
 
-    // Notification callback
-    void notifyCallback(NimBLERemoteCharacteristic *pRemoteCharacteristic, uint8_t *pData, size_t length, bool isNotify) const;
+    // Notification callback, dispatches to the decoder registered for the characteristic handle
+    using NotifyDecoder = void (NimBLEClientController::*)(const uint8_t *data, size_t length);
+    BleHandleTable<NotifyDecoder, BLE_NOTIFY_CHARACTERISTICS> notifyDecoders;
+
+    NimBLERemoteCharacteristic *subscribe(NimBLERemoteService *service, const char *uuid, NotifyDecoder decoder);
+    void notifyCallback(NimBLERemoteCharacteristic *pRemoteCharacteristic, uint8_t *pData, size_t length, bool isNotify);
+    void decodeError(const uint8_t *data, size_t length);
+    void decodeBrewButton(const uint8_t *data, size_t length);
+    void decodeSteamButton(const uint8_t *data, size_t length);
+    void decodeSensorData(const uint8_t *data, size_t length);
+    void decodeSensorBatch(const BleSensorBatchHeader &batch, const uint8_t *data, size_t length);
+    void decodeAutotuneResult(const uint8_t *data, size_t length);
+    void decodeVolumetricMeasurement(const uint8_t *data, size_t length);
+    void decodeTofMeasurement(const uint8_t *data, size_t length);
+    void decodeProfileStatus(const uint8_t *data, size_t length);
+    void sendOutputControlFrame(uint8_t mode, bool valve, float pumpSetpoint, float boilerSetpoint, bool pressureTarget,
+                                float pressure, float flow);
+    void sendOutputControlString(const char *control);
+    bool isControlWriteDue(bool changed, unsigned long &lastWrite);
+    void resetControlState();
 
     const char *LOG_TAG = "NimBLEClientController";
 };
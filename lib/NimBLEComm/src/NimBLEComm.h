@@ -1,6 +1,7 @@
 #ifndef NIMBLECOMM_H
 #define NIMBLECOMM_H
 
+#include "BleProfile.h"
 #include <Arduino.h>
 #include <NimBLEDevice.h>
 
@@ -24,6 +25,8 @@
 #define VOLUMETRIC_TARE_UUID "a8bd52e0-77c3-412c-847c-4e802c3982f9"
 #define TOF_MEASUREMENT_UUID "7282c525-21a0-416a-880d-21fe98602533"
 #define LED_CONTROL_UUID "37804a2b-49ab-4500-8582-db4279fc8573"
+#define PROFILE_UUID "0c5ae2b6-6f8e-4bc8-9d4f-3f1f5a0e7c21"
+#define CONTROL_TRACE_UUID "24a117ef-33b1-4464-b95e-11083eb085e4"
 
 constexpr size_t ERROR_CODE_COMM_SEND = 1;
 constexpr size_t ERROR_CODE_COMM_RCV = 2;
@@ -47,15 +50,23 @@ using int_callback_t = std::function<void(int val)>;
 using simple_output_callback_t = std::function<void(bool valve, float pumpSetpoint, float boilerSetpoint)>;
 using advanced_output_callback_t =
     std::function<void(bool valve, float boilerSetpoint, bool pressureTarget, float pumpPressure, float pumpFlow)>;
-using sensor_read_callback_t =
-    std::function<void(float temperature, float pressure, float puckFlow, float pumpFlow, float puckResistance)>;
+// timestamp is the local millis() at which the sample was taken
+using sensor_read_callback_t = std::function<void(float temperature, float pressure, float puckFlow, float pumpFlow,
+                                                  float puckResistance, unsigned long timestamp)>;
 using led_control_callback_t = std::function<void(uint8_t channel, uint8_t brightness)>;
+using profile_callback_t = std::function<void(const BleProfileFrame &profile)>;
+using profile_control_callback_t = std::function<void(uint8_t command, uint8_t phase)>;
+using profile_status_callback_t = std::function<void(uint8_t state, uint8_t phase)>;
+// Fills up to capacity samples recorded since the previous read, sets first to the tick of the first one
+using control_trace_callback_t = std::function<size_t(uint32_t &first, BleControlTraceSample *samples, size_t capacity)>;
 
 struct SystemCapabilities {
     bool dimming;
     bool pressure;
     bool ledControl;
     bool tof;
+    uint8_t binaryProtocol; // highest BLE frame version of the controller, 0 for CSV only
+    uint8_t profileVersion; // profile version the controller can execute, 0 if it can't
 };
 
 struct SystemInfo {
@@ -6,7 +6,7 @@ void NimBLEServerController::initServer(const String infoString) {
     this->infoString = infoString;
     NimBLEDevice::init("GPBLS");
     NimBLEDevice::setPower(ESP_PWR_LVL_P9); // Set to maximum power
-    NimBLEDevice::setMTU(128);
+    NimBLEDevice::setMTU(BLE_PREFERRED_MTU);
 
     // Create BLE Server
     NimBLEServer *pServer = NimBLEDevice::createServer();
@@ -67,6 +67,14 @@ void NimBLEServerController::initServer(const String infoString) {
     ledControlChar = pService->createCharacteristic(LED_CONTROL_UUID, NIMBLE_PROPERTY::WRITE);
     ledControlChar->setCallbacks(this);
 
+    // Profile Characteristic (Client writes profiles and commands, Server notifies phase changes)
+    profileChar = pService->createCharacteristic(PROFILE_UUID, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::NOTIFY);
+    profileChar->setCallbacks(this);
+
+    // Control trace Characteristic (Client reads the pump control loop trace, see BleControlTraceHeader)
+    controlTraceChar = pService->createCharacteristic(CONTROL_TRACE_UUID, NIMBLE_PROPERTY::READ);
+    controlTraceChar->setCallbacks(this);
+
     pService->start();
 
     ota_dfu_ble.configure_OTA(pServer);
@@ -81,7 +89,17 @@ void NimBLEServerController::initServer(const String infoString) {
 
 void NimBLEServerController::sendSensorData(float temperature, float pressure, float puckFlow, float pumpFlow,
                                             float puckResistance) {
-    if (deviceConnected && sensorChar != nullptr) {
+    if (deviceConnected && sensorChar != nullptr && clientProtocol > 0) {
+        BleSensorFrame frame{};
+        initBleFrameHeader(frame.header, BLE_FRAME_SENSOR, sensorSequence++, millis());
+        frame.temperature = bleFixed16(temperature, BLE_SCALE_TEMPERATURE);
+        frame.pressure = bleFixed16(pressure, BLE_SCALE_PRESSURE);
+        frame.puckFlow = bleFixed16(puckFlow, BLE_SCALE_FLOW);
+        frame.pumpFlow = bleFixed16(pumpFlow, BLE_SCALE_FLOW);
+        frame.puckResistance = bleFixed32(puckResistance, BLE_SCALE_RESISTANCE);
+        sensorChar->setValue(reinterpret_cast<const uint8_t *>(&frame), sizeof(frame));
+        sensorChar->notify();
+    } else if (deviceConnected && sensorChar != nullptr) {
         char str[30];
         snprintf(str, sizeof(str), "%.3f,%.3f,%.3f,%.3f,%.3f", temperature, pressure, puckFlow, pumpFlow, puckResistance);
         sensorChar->setValue(str);
@@ -89,6 +107,47 @@ void NimBLEServerController::sendSensorData(float temperature, float pressure, f
     }
 }
 
+bool NimBLEServerController::isBatchingSensorData() const {
+    return deviceConnected && clientProtocol >= BLE_PROTOCOL_BATCH_VERSION && bleSensorBatchCapacity(mtu) > 1;
+}
+
+void NimBLEServerController::addSensorSample(unsigned long timestamp, float temperature, float pressure, float puckFlow,
+                                             float pumpFlow, float puckResistance) {
+    if (!deviceConnected || sensorChar == nullptr) {
+        batchCount = 0;
+        return;
+    }
+    auto *batch = reinterpret_cast<BleSensorBatchHeader *>(batchBuffer);
+    if (batchCount == 0) {
+        initBleFrameHeader(batch->header, BLE_FRAME_SENSOR_BATCH, sensorSequence, timestamp);
+    }
+    BleSensorSample sample{};
+    sample.offset = static_cast<uint16_t>(std::min<unsigned long>(timestamp - batch->header.timestamp, UINT16_MAX));
+    sample.temperature = bleFixed16(temperature, BLE_SCALE_TEMPERATURE);
+    sample.pressure = bleFixed16(pressure, BLE_SCALE_PRESSURE);
+    sample.puckFlow = bleFixed16(puckFlow, BLE_SCALE_FLOW);
+    sample.pumpFlow = bleFixed16(pumpFlow, BLE_SCALE_FLOW);
+    sample.puckResistance = bleFixed32(puckResistance, BLE_SCALE_RESISTANCE);
+    memcpy(batchBuffer + sizeof(BleSensorBatchHeader) + batchCount * sizeof(BleSensorSample), &sample, sizeof(sample));
+    batchCount++;
+    sensorSequence++;
+    // Flush when the notification is full or the oldest sample would be delayed more than a single update used to be
+    if (batchCount >= bleSensorBatchCapacity(mtu) || sample.offset >= BLE_SENSOR_BATCH_MAX_LATENCY_MS) {
+        flushSensorSamples();
+    }
+}
+
+void NimBLEServerController::flushSensorSamples() {
+    if (batchCount == 0) {
+        return;
+    }
+    auto *batch = reinterpret_cast<BleSensorBatchHeader *>(batchBuffer);
+    batch->count = batchCount;
+    sensorChar->setValue(batchBuffer, sizeof(BleSensorBatchHeader) + batchCount * sizeof(BleSensorSample));
+    sensorChar->notify();
+    batchCount = 0;
+}
+
 void NimBLEServerController::sendError(int errorCode) {
     if (deviceConnected) {
         // Send temperature notification to the client
@@ -146,6 +205,17 @@ void NimBLEServerController::sendTofMeasurement(int value) {
     }
 }
 
+void NimBLEServerController::sendProfileStatus(uint8_t state, uint8_t phase) {
+    if (deviceConnected && profileChar != nullptr) {
+        BleProfileStatusFrame frame{};
+        initBleFrameHeader(frame.header, BLE_FRAME_PROFILE_STATUS, profileSequence++, millis());
+        frame.state = state;
+        frame.phase = phase;
+        profileChar->setValue(reinterpret_cast<const uint8_t *>(&frame), sizeof(frame));
+        profileChar->notify();
+    }
+}
+
 void NimBLEServerController::registerOutputControlCallback(const simple_output_callback_t &callback) {
     outputControlCallback = callback;
 }
@@ -163,6 +233,18 @@ void NimBLEServerController::registerTareCallback(const void_callback_t &callbac
 
 void NimBLEServerController::registerLedControlCallback(const led_control_callback_t &callback) { ledControlCallback = callback; }
 
+void NimBLEServerController::registerProfileCallback(const profile_callback_t &callback) { profileCallback = callback; }
+
+void NimBLEServerController::registerProfileControlCallback(const profile_control_callback_t &callback) {
+    profileControlCallback = callback;
+}
+
+void NimBLEServerController::registerProfileOutputCallback(const float_callback_t &callback) { profileOutputCallback = callback; }
+
+void NimBLEServerController::registerControlTraceCallback(const control_trace_callback_t &callback) {
+    controlTraceCallback = callback;
+}
+
 void NimBLEServerController::setInfo(const String infoString) {
     this->infoString = infoString;
     infoChar->setValue(infoString);
@@ -178,19 +260,36 @@ void NimBLEServerController::registerPumpModelCoeffsCallback(const pump_model_co
 void NimBLEServerController::onConnect(NimBLEServer *pServer) {
     ESP_LOGI(LOG_TAG, "Client connected.");
     deviceConnected = true;
+    clientProtocol = 0;
+    sensorSequence = 0;
+    profileSequence = 0;
+    mtu = BLE_DEFAULT_MTU;
     pServer->stopAdvertising();
 }
 
 void NimBLEServerController::onDisconnect(NimBLEServer *pServer) {
     ESP_LOGI(LOG_TAG, "Client disconnected.");
     deviceConnected = false;
+    clientProtocol = 0;
     pServer->startAdvertising(); // Restart advertising so clients can reconnect
 }
 
+void NimBLEServerController::onMTUChange(uint16_t MTU, ble_gap_conn_desc *) {
+    ESP_LOGI(LOG_TAG, "MTU changed to %d, %u sensor samples per notification", MTU,
+             static_cast<unsigned>(bleSensorBatchCapacity(MTU)));
+    mtu = MTU;
+}
+
 void NimBLEServerController::onWrite(NimBLECharacteristic *pCharacteristic) {
     ESP_LOGV(LOG_TAG, "Write received!");
 
     if (pCharacteristic->getUUID().equals(NimBLEUUID(OUTPUT_CONTROL_UUID))) {
+        const NimBLEAttValue &value = pCharacteristic->getValue();
+        BleOutputControlFrame frame{};
+        if (readBleFrame(value.data(), value.length(), BLE_FRAME_OUTPUT_CONTROL, frame)) {
+            handleOutputControlFrame(frame);
+            return;
+        }
         auto control = String(pCharacteristic->getValue().c_str());
         uint8_t type = get_token(control, 0, ',').toInt();
         uint8_t valve = get_token(control, 1, ',').toInt();
@@ -271,5 +370,76 @@ void NimBLEServerController::onWrite(NimBLECharacteristic *pCharacteristic) {
             ledControlCallback(channel, brightness);
             ESP_LOGV(LOG_TAG, "Received led control, %d: %d", channel, brightness);
         }
+    } else if (pCharacteristic->getUUID().equals(NimBLEUUID(PROFILE_UUID))) {
+        handleProfileWrite(pCharacteristic->getValue());
+    }
+}
+
+void NimBLEServerController::onRead(NimBLECharacteristic *pCharacteristic) {
+    if (pCharacteristic != controlTraceChar) {
+        return;
+    }
+    auto *trace = reinterpret_cast<BleControlTraceHeader *>(traceBuffer);
+    initBleFrameHeader(trace->header, BLE_FRAME_CONTROL_TRACE, traceSequence++, millis());
+    uint32_t first = 0;
+    size_t count = 0;
+    if (controlTraceCallback != nullptr) {
+        // The callback fills the sample area of the frame directly
+        auto *samples = reinterpret_cast<BleControlTraceSample *>(traceBuffer + sizeof(BleControlTraceHeader));
+        count = controlTraceCallback(first, samples, BLE_CONTROL_TRACE_MAX_SAMPLES);
+    }
+    trace->first = first;
+    trace->count = count;
+    pCharacteristic->setValue(traceBuffer, sizeof(BleControlTraceHeader) + count * sizeof(BleControlTraceSample));
+}
+
+void NimBLEServerController::handleOutputControlFrame(const BleOutputControlFrame &frame) {
+    if (clientProtocol != frame.header.version) {
+        ESP_LOGI(LOG_TAG, "Client uses binary protocol version %d", frame.header.version);
+        clientProtocol = frame.header.version;
+    }
+    const bool valve = frame.header.flags & BLE_OUTPUT_FLAG_VALVE;
+    const float boilerSetpoint = bleFloat(frame.boilerSetpoint, BLE_SCALE_SETPOINT);
+    if (frame.mode == BLE_OUTPUT_MODE_SIMPLE) {
+        const float pumpSetpoint = bleFloat(frame.pumpSetpoint, BLE_SCALE_SETPOINT);
+        ESP_LOGV(LOG_TAG, "Received output control frame: valve=%d, pump=%.1f, boiler=%.1f", valve, pumpSetpoint,
+                 boilerSetpoint);
+        if (outputControlCallback != nullptr) {
+            outputControlCallback(valve, pumpSetpoint, boilerSetpoint);
+        }
+    } else if (frame.mode == BLE_OUTPUT_MODE_ADVANCED) {
+        const bool pressureTarget = frame.header.flags & BLE_OUTPUT_FLAG_PRESSURE_TARGET;
+        const float pressure = bleFloat(frame.pressure, BLE_SCALE_TARGET);
+        const float flow = bleFloat(frame.flow, BLE_SCALE_TARGET);
+        ESP_LOGV(LOG_TAG, "Received advanced output control frame: valve=%d, pressure_target=%d, pressure=%.2f, flow=%.2f",
+                 valve, pressureTarget, pressure, flow);
+        if (advancedControlCallback != nullptr) {
+            advancedControlCallback(valve, boilerSetpoint, pressureTarget, pressure, flow);
+        }
+    } else if (frame.mode == BLE_OUTPUT_MODE_PROFILE) {
+        ESP_LOGV(LOG_TAG, "Received profile output control frame: boiler=%.1f", boilerSetpoint);
+        if (profileOutputCallback != nullptr) {
+            profileOutputCallback(boilerSetpoint);
+        }
+    }
+}
+
+void NimBLEServerController::handleProfileWrite(const NimBLEAttValue &value) {
+    BleProfileControlFrame control{};
+    if (readBleFrame(value.data(), value.length(), BLE_FRAME_PROFILE_CONTROL, control)) {
+        ESP_LOGV(LOG_TAG, "Received profile command %d for phase %d", control.command, control.phase);
+        if (profileControlCallback != nullptr) {
+            profileControlCallback(control.command, control.phase);
+        }
+        return;
+    }
+    BleProfileFrame profile{};
+    if (readBleProfileFrame(value.data(), value.length(), profile)) {
+        ESP_LOGI(LOG_TAG, "Received profile with %d phases", profile.phaseCount);
+        if (profileCallback != nullptr) {
+            profileCallback(profile);
+        }
+        return;
     }
+    ESP_LOGW(LOG_TAG, "Invalid profile write of %d bytes", value.length());
 }
@@ -10,12 +10,16 @@ class NimBLEServerController : public NimBLEServerCallbacks, public NimBLECharac
     NimBLEServerController();
     void initServer(String infoString);
     void sendSensorData(float temperature, float pressure, float puckFlow, float pumpFlow, float puckResistance);
+    void addSensorSample(unsigned long timestamp, float temperature, float pressure, float puckFlow, float pumpFlow,
+                         float puckResistance);
+    bool isBatchingSensorData() const;
     void sendError(int errorCode);
     void sendBrewBtnState(bool brewButtonStatus);
     void sendSteamBtnState(bool steamButtonStatus);
     void sendAutotuneResult(float Kp, float Ki, float Kd);
     void sendVolumetricMeasurement(float value);
     void sendTofMeasurement(int value);
+    void sendProfileStatus(uint8_t state, uint8_t phase);
     void registerOutputControlCallback(const simple_output_callback_t &callback);
     void registerAdvancedOutputControlCallback(const advanced_output_callback_t &callback);
     void registerAltControlCallback(const pin_control_callback_t &callback);
@@ -26,10 +30,26 @@ class NimBLEServerController : public NimBLEServerCallbacks, public NimBLECharac
     void registerPressureScaleCallback(const float_callback_t &callback);
     void registerTareCallback(const void_callback_t &callback);
     void registerLedControlCallback(const led_control_callback_t &callback);
+    void registerProfileCallback(const profile_callback_t &callback);
+    void registerProfileControlCallback(const profile_control_callback_t &callback);
+    void registerProfileOutputCallback(const float_callback_t &callback);
+    void registerControlTraceCallback(const control_trace_callback_t &callback);
     void setInfo(String infoString);
 
   private:
     bool deviceConnected = false;
+    uint8_t clientProtocol = 0; // frame version of the client, set once it writes a binary output control frame
+    uint16_t sensorSequence = 0;
+    uint16_t profileSequence = 0;
+    uint16_t traceSequence = 0;
+    uint16_t mtu = BLE_DEFAULT_MTU;
+
+    // Samples waiting for the next batch notification
+    uint8_t batchBuffer[sizeof(BleSensorBatchHeader) + BLE_SENSOR_BATCH_MAX_SAMPLES * sizeof(BleSensorSample)] = {};
+    uint8_t batchCount = 0;
+    // Control trace read response, kept off the BLE host task stack. Aligned so the samples can be filled in place.
+    alignas(4) uint8_t
+        traceBuffer[sizeof(BleControlTraceHeader) + BLE_CONTROL_TRACE_MAX_SAMPLES * sizeof(BleControlTraceSample)] = {};
     String infoString = "";
     NimBLECharacteristic *outputControlChar = nullptr;
     NimBLECharacteristic *pressureScaleChar = nullptr;
@@ -48,6 +68,8 @@ class NimBLEServerController : public NimBLEServerCallbacks, public NimBLECharac
     NimBLECharacteristic *volumetricTareChar = nullptr;
     NimBLECharacteristic *tofMeasurementChar = nullptr;
     NimBLECharacteristic *ledControlChar = nullptr;
+    NimBLECharacteristic *profileChar = nullptr;
+    NimBLECharacteristic *controlTraceChar = nullptr;
 
     simple_output_callback_t outputControlCallback = nullptr;
     advanced_output_callback_t advancedControlCallback = nullptr;
@@ -59,13 +81,23 @@ class NimBLEServerController : public NimBLEServerCallbacks, public NimBLECharac
     float_callback_t pressureScaleCallback = nullptr;
     void_callback_t tareCallback = nullptr;
     led_control_callback_t ledControlCallback = nullptr;
+    profile_callback_t profileCallback = nullptr;
+    profile_control_callback_t profileControlCallback = nullptr;
+    float_callback_t profileOutputCallback = nullptr;
+    control_trace_callback_t controlTraceCallback = nullptr;
 
     // BLEServerCallbacks overrides
     void onConnect(NimBLEServer *pServer) override;
     void onDisconnect(NimBLEServer *pServer) override;
+    void onMTUChange(uint16_t MTU, ble_gap_conn_desc *desc) override;
 
     // BLECharacteristicCallbacks overrides
     void onWrite(NimBLECharacteristic *pCharacteristic) override;
+    void onRead(NimBLECharacteristic *pCharacteristic) override;
+
+    void handleOutputControlFrame(const BleOutputControlFrame &frame);
+    void handleProfileWrite(const NimBLEAttValue &value);
+    void flushSensorSamples();
 
     BLE_OTA_DFU ota_dfu_ble;
 
@@ -0,0 +1,111 @@
+// Compares the cost of routing a notification to its decoder through the previous UUID comparison chain and through
+// the handle table used by NimBLEClientController.
+//
+// Build and run on the host:
+//   g++ -std=c++17 -O2 -Ilib/NimBLEComm/src scripts/bench/ble_dispatch_bench.cpp -o ble_dispatch_bench
+//   ./ble_dispatch_bench [iterations]
+//
+// Uuid below mirrors what NimBLEUUID does for every comparison in the chain: parse the 128 bit string form of the
+// literal and compare it to a copy of the characteristic UUID. The UUIDs are copied from NimBLEComm.h, which can not
+// be included on the host.
+
+#include <BleHandleTable.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+// Notify characteristics in the order of the previous chain, the sensor stream is the fourth
+const char *NOTIFY_UUIDS[] = {
+    "d6676ec7-820c-41de-820d-95620749003b", // error
+    "a29eb137-b33e-45a4-b1fc-15eb04e8ab39", // brew button
+    "53750675-4839-421e-971e-cc6823507d8e", // steam button
+    "62b69e72-ac19-4d4b-bd53-2edd65330c93", // sensor data
+    "7f61607a-2817-4354-9b94-d49c057fc879", // autotune result
+    "b0080557-3865-4a9c-be37-492d77ee5951", // volumetric measurement
+    "7282c525-21a0-416a-880d-21fe98602533", // tof measurement
+};
+constexpr size_t NOTIFY_COUNT = sizeof(NOTIFY_UUIDS) / sizeof(NOTIFY_UUIDS[0]);
+constexpr size_t SENSOR_INDEX = 3;
+
+struct Uuid {
+    uint8_t value[16] = {};
+
+    explicit Uuid(const std::string &text) {
+        size_t byte = 0;
+        for (size_t i = 0; i + 1 < text.size() && byte < sizeof(value); i++) {
+            if (text[i] == '-') {
+                continue;
+            }
+            value[sizeof(value) - 1 - byte++] = static_cast<uint8_t>(strtoul(text.substr(i++, 2).c_str(), nullptr, 16));
+        }
+    }
+
+    bool equals(const Uuid &other) const { return memcmp(value, other.value, sizeof(value)) == 0; }
+};
+
+struct Characteristic {
+    Uuid uuid;
+    uint16_t handle;
+
+    Uuid getUUID() const { return uuid; }
+    uint16_t getHandle() const { return handle; }
+};
+
+volatile size_t sink = 0;
+
+void decode(size_t index) { sink = sink + index; }
+
+void dispatchChain(const Characteristic &characteristic) {
+    // Every branch is tested, like the previous implementation
+    for (size_t i = 0; i < NOTIFY_COUNT; i++) {
+        if (characteristic.getUUID().equals(Uuid(NOTIFY_UUIDS[i]))) {
+            decode(i);
+        }
+    }
+}
+
+template <typename F> void measure(const char *name, size_t iterations, F dispatch) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        dispatch(i);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%-14s %10.1f ns/notification\n", name, elapsed.count() * 1e9 / static_cast<double>(iterations));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+
+    // Notify characteristics take three handles each (declaration, value, CCCD), the service starts at 40
+    constexpr uint16_t startHandle = 40;
+    Characteristic characteristics[NOTIFY_COUNT] = {
+        {Uuid(NOTIFY_UUIDS[0]), 43}, {Uuid(NOTIFY_UUIDS[1]), 46}, {Uuid(NOTIFY_UUIDS[2]), 49}, {Uuid(NOTIFY_UUIDS[3]), 52},
+        {Uuid(NOTIFY_UUIDS[4]), 55}, {Uuid(NOTIFY_UUIDS[5]), 58}, {Uuid(NOTIFY_UUIDS[6]), 61},
+    };
+
+    using Decoder = void (*)(size_t);
+    BleHandleTable<Decoder, NOTIFY_COUNT> table;
+    table.reset(startHandle);
+    for (const auto &characteristic : characteristics) {
+        table.add(characteristic.getHandle(), &decode);
+    }
+    auto dispatchTable = [&](const Characteristic &characteristic, size_t index) {
+        if (const Decoder *decoder = table.find(characteristic.getHandle())) {
+            (*decoder)(index);
+        }
+    };
+
+    measure("chain sensor", iterations, [&](size_t) { dispatchChain(characteristics[SENSOR_INDEX]); });
+    measure("table sensor", iterations, [&](size_t) { dispatchTable(characteristics[SENSOR_INDEX], SENSOR_INDEX); });
+    measure("chain mixed", iterations, [&](size_t i) { dispatchChain(characteristics[i % NOTIFY_COUNT]); });
+    measure("table mixed", iterations,
+            [&](size_t i) { dispatchTable(characteristics[i % NOTIFY_COUNT], i % NOTIFY_COUNT); });
+    return 0;
+}
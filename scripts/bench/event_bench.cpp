@@ -0,0 +1,190 @@
+// Measures PluginManager::trigger throughput and heap allocations per trigger.
+//
+// Build and run on the host:
+//   g++ -std=c++17 -O2 -Isrc -Iscripts/bench/host scripts/bench/event_bench.cpp src/display/core/PluginManager.cpp -o event_bench
+//   ./event_bench [iterations]
+//
+// The legacy dispatcher below mirrors the previous implementation (std::map keyed by std::string, payload in a
+// std::vector with string keys) with std::string standing in for Arduino String, as a baseline.
+
+#include <display/core/PluginManager.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+std::atomic<size_t> allocations{0};
+}
+
+void *operator new(size_t size) {
+    allocations++;
+    if (void *ptr = malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+namespace {
+
+// Registered by the display firmware at startup, roughly
+const char *EVENT_NAMES[] = {
+    "controller:startup", "controller:ready", "controller:error", "controller:mode:change", "controller:brew:start",
+    "controller:brew:end", "controller:brew:prestart", "controller:brew:clear", "controller:grind:start",
+    "controller:grind:end", "controller:process:start", "controller:process:end", "controller:wifi:connect",
+    "controller:wifi:disconnect", "controller:bluetooth:init", "controller:bluetooth:connect",
+    "controller:targetDuration:change", "controller:targetVolume:change", "controller:grindDuration:change",
+    "controller:grindVolume:change", "controller:autotune:start", "controller:autotune:result", "controller:tof:change",
+    "boiler:targetTemperature:change", "profiles:profile:save", "profiles:profile:select", "ota:update:start",
+    "ota:update:end", "ota:update:status", "ota:update:phase", "ota:update:progress",
+};
+
+namespace legacy {
+struct EventDataEntry {
+    std::string key;
+    int type = 0;
+    int intValue = 0;
+    float floatValue = 0.0f;
+    std::string stringValue;
+};
+
+struct Event {
+    std::string id;
+    std::vector<EventDataEntry> data;
+    bool stopPropagation = false;
+
+    float getFloat(const std::string &key) const {
+        for (const auto &entry : data) {
+            if (entry.key == key && entry.type == 1) {
+                return entry.floatValue;
+            }
+        }
+        return 0.0f;
+    }
+};
+
+class Dispatcher {
+  public:
+    void on(const std::string &id, const std::function<void(Event &)> &callback) { listeners[id].push_back(callback); }
+
+    Event trigger(const std::string &id, const std::string &key, float value) {
+        Event event;
+        event.id = id;
+        EventDataEntry entry;
+        entry.key = key;
+        entry.type = 1;
+        entry.floatValue = value;
+        event.data.push_back(entry);
+        if (listeners.count(std::string(event.id.c_str()))) {
+            for (auto const &callback : listeners[std::string(event.id.c_str())]) {
+                callback(event);
+                if (event.stopPropagation) {
+                    break;
+                }
+            }
+        }
+        return event;
+    }
+
+  private:
+    std::map<std::string, std::vector<std::function<void(Event &)>>> listeners;
+};
+} // namespace legacy
+
+const char *SENSOR_EVENTS[] = {"boiler:pressure:change", "pump:puck-flow:change", "pump:flow:change",
+                               "pump:puck-resistance:change"};
+constexpr EventId SENSOR_EVENT_IDS[] = {EVENT_BOILER_PRESSURE_CHANGE, EVENT_PUMP_PUCK_FLOW_CHANGE, EVENT_PUMP_FLOW_CHANGE,
+                                        EVENT_PUMP_PUCK_RESISTANCE_CHANGE};
+
+volatile float sink = 0.0f;
+
+class BenchPlugin : public Plugin {
+  public:
+    void setup(Controller *, PluginManager *) override {}
+    void loop() override {}
+};
+
+template <typename F> void measure(const char *name, size_t iterations, F trigger) {
+    const size_t before = allocations;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        trigger(i);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double triggers = static_cast<double>(iterations) * 4;
+    printf("%-10s %12.0f triggers/s %8.2f allocations/trigger\n", name, triggers / elapsed.count(),
+           static_cast<double>(allocations - before) / triggers);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+
+    PluginManager manager;
+    legacy::Dispatcher dispatcher;
+    for (const char *name : EVENT_NAMES) {
+        manager.on(name, [](Event &) {});
+        dispatcher.on(name, [](legacy::Event &) {});
+    }
+    for (const char *name : SENSOR_EVENTS) {
+        manager.on(name, [](Event &event) { sink = sink + event.getFloat("value"); });
+        dispatcher.on(name, [](legacy::Event &event) { sink = sink + event.getFloat("value"); });
+    }
+
+    // One sensor notification triggers all four events
+    measure("legacy", iterations, [&](size_t i) {
+        for (const char *name : SENSOR_EVENTS) {
+            dispatcher.trigger(name, "value", static_cast<float>(i));
+        }
+    });
+    measure("string", iterations, [&](size_t i) {
+        for (const char *name : SENSOR_EVENTS) {
+            manager.trigger(name, "value", static_cast<float>(i));
+        }
+    });
+    measure("constexpr", iterations, [&](size_t i) {
+        for (const EventId &id : SENSOR_EVENT_IDS) {
+            manager.trigger(id, EVENT_KEY_VALUE, static_cast<float>(i));
+        }
+    });
+
+    // Same events with an additional plugin subscribed through its queue, drained once per notification
+    BenchPlugin plugin;
+    manager.registerPlugin(&plugin);
+    manager.setup(nullptr);
+    for (const EventId &id : SENSOR_EVENT_IDS) {
+        manager.on(&plugin, id, [](Event &event) { sink = sink + event.getFloat(EVENT_KEY_VALUE); }, EventDelivery::COALESCE);
+    }
+    manager.on(&plugin, EVENT_BOILER_PRESSURE_CHANGE, [](Event &event) { sink = sink + event.getFloat(EVENT_KEY_VALUE); });
+    measure("queued", iterations, [&](size_t i) {
+        for (const EventId &id : SENSOR_EVENT_IDS) {
+            manager.trigger(id, EVENT_KEY_VALUE, static_cast<float>(i));
+        }
+        manager.loop();
+    });
+    printf("dropped: %u\n", static_cast<unsigned>(manager.getDroppedEvents()));
+
+    // Raw events additionally forwarded to a coalesced stream with a 0.05 deadband
+    manager.coalesce("boiler:pressure:change", EVENT_BOILER_PRESSURE_COALESCED, 0, 0.05f);
+    manager.on(EVENT_BOILER_PRESSURE_COALESCED, [](Event &event) { sink = sink + event.getFloat(EVENT_KEY_VALUE); });
+    measure("coalesced", iterations, [&](size_t i) {
+        for (const EventId &id : SENSOR_EVENT_IDS) {
+            manager.trigger(id, EVENT_KEY_VALUE, static_cast<float>(i % 100) * 0.01f);
+        }
+        manager.loop();
+    });
+    for (const auto &stats : manager.getStreamStats()) {
+        printf("%s: %u raw, %u delivered\n", stats.name, static_cast<unsigned>(stats.raw),
+               static_cast<unsigned>(stats.delivered));
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+// Minimal stand-in for the Arduino core so display sources without hardware dependencies build on the host
+#ifndef BENCH_HOST_ARDUINO_H
+#define BENCH_HOST_ARDUINO_H
+
+#include <chrono>
+
+#define ESP_LOGE(tag, ...)
+#define ESP_LOGW(tag, ...)
+#define ESP_LOGI(tag, ...)
+#define ESP_LOGD(tag, ...)
+#define ESP_LOGV(tag, ...)
+
+inline unsigned long millis() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif // BENCH_HOST_ARDUINO_H
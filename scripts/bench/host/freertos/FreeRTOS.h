@@ -0,0 +1,22 @@
+// Single threaded stand-in for the FreeRTOS primitives used by display sources built on the host
+#ifndef BENCH_HOST_FREERTOS_H
+#define BENCH_HOST_FREERTOS_H
+
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+
+typedef struct {
+    int locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define taskENTER_CRITICAL(mux) ((mux)->locked++)
+#define taskEXIT_CRITICAL(mux) ((mux)->locked--)
+
+#endif // BENCH_HOST_FREERTOS_H
@@ -0,0 +1,43 @@
+#ifndef BENCH_HOST_QUEUE_H
+#define BENCH_HOST_QUEUE_H
+
+#include "FreeRTOS.h"
+
+#include <cstring>
+#include <vector>
+
+// Preallocated like the real queue so the benchmark sees no allocations per item
+struct HostQueue {
+    size_t length;
+    size_t itemSize;
+    std::vector<uint8_t> storage;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+typedef HostQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new HostQueue{length, itemSize, std::vector<uint8_t>(length * itemSize)};
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t) {
+    if (queue->count >= queue->length) {
+        return pdFALSE;
+    }
+    memcpy(&queue->storage[(queue->head + queue->count) % queue->length * queue->itemSize], item, queue->itemSize);
+    queue->count++;
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t) {
+    if (queue->count == 0) {
+        return pdFALSE;
+    }
+    memcpy(item, &queue->storage[queue->head * queue->itemSize], queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+#endif // BENCH_HOST_QUEUE_H
@@ -0,0 +1,212 @@
+// Checks VolumetricRateCalculator against a two pass least squares fit and compares its cost to the previous
+// implementation.
+//
+// Build and run on the host:
+//   g++ -std=c++17 -O2 -Isrc -Iscripts/bench/host scripts/bench/rate_bench.cpp -o rate_bench
+//   ./rate_bench [shots]
+//
+// The legacy calculator below mirrors the previous implementation (two growing vectors, window found by scanning
+// back from the newest sample, fit over the window on every call) as a baseline. Exits with 1 if the streaming fit
+// disagrees with the reference.
+
+#include <display/core/predictive.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace legacy {
+
+class VolumetricRateCalculator {
+  public:
+    explicit VolumetricRateCalculator(double window_duration) : windowDuration(window_duration) {}
+
+    void addMeasurement(double volume, double time) {
+        measurements.emplace_back(volume);
+        measurementTimes.emplace_back(time);
+    }
+
+    double getRate(double time) const {
+        if (measurements.size() < 2)
+            return 0.0;
+        size_t i = measurementTimes.size();
+        double cutoff = time - windowDuration;
+        while (i > 0 && measurementTimes[i - 1] > cutoff) { // the previous loop read before the first sample here
+            i--;
+        }
+        if (measurements.size() - i < 2)
+            return 0.0;
+        double v_mean = 0.0;
+        double t_mean = 0.0;
+        for (size_t j = i; j < measurements.size(); j++) {
+            v_mean += measurements[j];
+            t_mean += measurementTimes[j];
+        }
+        v_mean = v_mean / (measurements.size() - i);
+        t_mean = t_mean / (measurements.size() - i);
+        double tdev2 = 0.0;
+        double tdev_vdev = 0.0;
+        for (size_t j = i; j < measurements.size(); j++) {
+            tdev_vdev += (measurementTimes[i] - t_mean) * (measurements[i] - v_mean);
+            tdev2 += pow(measurementTimes[i] - t_mean, 2.0);
+        }
+        double volumePerMilliSecond = tdev_vdev / tdev2;
+        return volumePerMilliSecond > 0 ? volumePerMilliSecond : 0.0;
+    }
+
+  private:
+    std::vector<double> measurements;
+    std::vector<double> measurementTimes;
+    const double windowDuration;
+};
+
+} // namespace legacy
+
+namespace {
+
+constexpr double WINDOW = 4000.0; // PREDICTIVE_TIME
+
+struct Sample {
+    double time;
+    double volume;
+};
+
+// Scale readings of a shot: jittered intervals, flat until the first drops, then a slightly accelerating ramp with noise
+std::vector<Sample> makeShot(std::mt19937 &rng, double start, double interval, size_t count) {
+    std::uniform_real_distribution<double> jitter(-0.2 * interval, 0.2 * interval);
+    std::normal_distribution<double> noise(0.0, 0.05);
+    std::vector<Sample> samples;
+    double time = start;
+    for (size_t i = 0; i < count; i++) {
+        time += interval + jitter(rng);
+        const double elapsed = (time - start) / 1000.0;
+        const double volume = elapsed < 6.0 ? 0.0 : 1.8 * (elapsed - 6.0) + 0.02 * (elapsed - 6.0) * (elapsed - 6.0);
+        samples.push_back({time, volume + noise(rng)});
+    }
+    return samples;
+}
+
+// Slope of the newest samples up to sample end that are within the window ending at time, at most CAPACITY of them
+double referenceRate(const std::vector<Sample> &samples, size_t end, double time) {
+    const size_t newest = end + 1;
+    const size_t oldest = newest > VolumetricRateCalculator::CAPACITY ? newest - VolumetricRateCalculator::CAPACITY : 0;
+    long double tMean = 0.0L;
+    long double vMean = 0.0L;
+    size_t n = 0;
+    for (size_t i = oldest; i < newest; i++) {
+        if (samples[i].time > time - WINDOW && samples[i].time > samples[end].time - WINDOW) {
+            tMean += samples[i].time;
+            vMean += samples[i].volume;
+            n++;
+        }
+    }
+    if (n < 2) {
+        return 0.0;
+    }
+    tMean /= n;
+    vMean /= n;
+    long double tv = 0.0L;
+    long double tt = 0.0L;
+    for (size_t i = oldest; i < newest; i++) {
+        if (samples[i].time > time - WINDOW && samples[i].time > samples[end].time - WINDOW) {
+            tv += (samples[i].time - tMean) * (samples[i].volume - vMean);
+            tt += (samples[i].time - tMean) * (samples[i].time - tMean);
+        }
+    }
+    if (tt <= 0.0L) {
+        return 0.0;
+    }
+    const double slope = static_cast<double>(tv / tt);
+    return slope > 0 ? slope : 0.0;
+}
+
+bool check(std::mt19937 &rng) {
+    double worst = 0.0;
+    size_t compared = 0;
+    // Interval below WINDOW / CAPACITY exercises the capacity limit, the long run the accumulated rounding error
+    for (const double interval : {10.0, 50.0, 100.0, 250.0, 1500.0}) {
+        for (const double start : {0.0, 3.6e6, 8.64e7}) {
+            const size_t count = interval <= 10.0 ? 60000 : 2000;
+            const std::vector<Sample> samples = makeShot(rng, start, interval, count);
+            VolumetricRateCalculator calculator(WINDOW);
+            for (size_t i = 0; i < samples.size(); i++) {
+                calculator.addMeasurement(samples[i].volume, samples[i].time);
+                for (const double delay : {0.0, 0.5 * interval, 1.5 * interval}) {
+                    const double time = samples[i].time + delay;
+                    const double expected = referenceRate(samples, i, time);
+                    const double actual = calculator.getRate(time);
+                    const double error = std::fabs(actual - expected) / std::max(std::fabs(expected), 1e-4);
+                    worst = std::max(worst, error);
+                    compared++;
+                    if (error > 1e-6) {
+                        printf("FAIL interval %.0f ms start %.0f sample %zu: %.9g != %.9g\n", interval, start, i, actual,
+                               expected);
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    // A flat window must not turn into an infinite adjustment
+    VolumetricRateCalculator flat(WINDOW);
+    for (int i = 0; i < 50; i++) {
+        flat.addMeasurement(36.0, 1000.0 + i * 100.0);
+    }
+    const double adjust = flat.getOvershootAdjustMillis(36.0, 37.0);
+    if (adjust != 0.0) {
+        printf("FAIL overshoot adjustment on a flat window: %g\n", adjust);
+        return false;
+    }
+
+    printf("%zu rates match the reference fit, worst relative error %.3g\n", compared, worst);
+    return true;
+}
+
+template <typename Calculator> void measure(const char *name, const std::vector<std::vector<Sample>> &shots) {
+    volatile double sink = 0.0;
+    size_t calls = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const std::vector<Sample> &shot : shots) {
+        Calculator calculator(WINDOW);
+        for (const Sample &sample : shot) {
+            calculator.addMeasurement(sample.volume, sample.time);
+            // BrewProcess reads the rate on every progress update, several per scale reading
+            for (int i = 0; i < 4; i++) {
+                sink = sink + calculator.getRate(sample.time + i * 25.0);
+            }
+            calls += 4;
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%-10s %10.1f ns/rate\n", name, elapsed.count() * 1e9 / calls);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const size_t shots = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000;
+    std::mt19937 rng(42);
+
+    if (!check(rng)) {
+        return 1;
+    }
+
+    // 40 s shots and a 5 min grind session with readings at 10 Hz
+    std::vector<std::vector<Sample>> brews;
+    for (size_t i = 0; i < shots; i++) {
+        brews.push_back(makeShot(rng, 0.0, 100.0, 400));
+    }
+    const std::vector<std::vector<Sample>> grind = {makeShot(rng, 0.0, 100.0, 3000)};
+    printf("40 s shots:\n");
+    measure<legacy::VolumetricRateCalculator>("legacy", brews);
+    measure<VolumetricRateCalculator>("streaming", brews);
+    printf("5 min stream:\n");
+    measure<legacy::VolumetricRateCalculator>("legacy", grind);
+    measure<VolumetricRateCalculator>("streaming", grind);
+    return 0;
+}
@@ -0,0 +1,205 @@
+// Replays recorded shots through ShotLogEncoder and reports compression ratio and reconstruction error.
+//
+// Build and run on the host:
+//   g++ -std=c++17 -O2 -Isrc scripts/bench/shot_encoder_bench.cpp -o shot_encoder_bench
+//   ./shot_encoder_bench [--tolerance <percent>] [--synthetic] <shot.dat>...
+//
+// Accepts both the legacy CSV history files and binary shot logs copied from /h. Binary logs are
+// resampled at their nominal interval before encoding so already compressed files can be replayed too.
+
+#include <display/models/shot_log.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *CHANNEL_NAMES[SHOT_LOG_CHANNELS] = {"tt", "ct", "tp", "cp", "fl", "tf", "pf", "vf", "v", "ev", "pr"};
+
+struct Shot {
+    std::string name;
+    ShotLogHeader header{};
+    std::vector<ShotLogRecord> samples;
+    size_t csvBytes = 0;
+};
+
+// Quantized channel value at t on the line between the surrounding records, unrounded like the history chart draws it
+float interpolate(const std::vector<ShotLogRecord> &records, uint32_t t, size_t channel, size_t &cursor) {
+    while (cursor + 1 < records.size() && records[cursor + 1].t <= t) {
+        cursor++;
+    }
+    const ShotLogRecord &a = records[cursor];
+    if (cursor + 1 >= records.size() || t <= a.t) {
+        return a.values[channel];
+    }
+    const ShotLogRecord &b = records[cursor + 1];
+    const float f = static_cast<float>(t - a.t) / static_cast<float>(b.t - a.t);
+    return a.values[channel] + (b.values[channel] - a.values[channel]) * f;
+}
+
+bool loadCsv(const std::string &content, Shot &shot) {
+    std::istringstream input(content);
+    std::string line;
+    if (!std::getline(input, line)) {
+        return false;
+    }
+    initShotLogHeader(shot.header, "", 0, 250);
+    shot.csvBytes = content.size();
+    while (std::getline(input, line)) {
+        unsigned long t;
+        float values[SHOT_LOG_CHANNELS] = {};
+        if (sscanf(line.c_str(), "%lu,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f", &t, &values[0], &values[1], &values[2], &values[3],
+                   &values[4], &values[5], &values[6], &values[7], &values[8], &values[9], &values[10]) < 11) {
+            continue;
+        }
+        ShotLogRecord record{};
+        record.t = shotLogTicks(t, shot.header.timeUnit);
+        for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+            record.values[i] = shotLogQuantize(values[i], shot.header.scales[i]);
+        }
+        shot.samples.push_back(record);
+    }
+    return !shot.samples.empty();
+}
+
+bool loadBinary(const std::string &content, Shot &shot) {
+    std::vector<ShotLogRecord> records;
+    if (!readShotLog(reinterpret_cast<const uint8_t *>(content.data()), content.size(), shot.header, records)) {
+        return false;
+    }
+    const uint32_t step = std::max<uint32_t>(1, shot.header.sampleInterval / shot.header.timeUnit);
+    size_t cursor = 0;
+    for (uint32_t t = records.front().t; t <= records.back().t; t += step) {
+        ShotLogRecord record{};
+        record.t = static_cast<uint16_t>(t);
+        for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+            size_t channelCursor = cursor;
+            record.values[i] = static_cast<int16_t>(std::lround(interpolate(records, t, i, channelCursor)));
+            if (i + 1 == SHOT_LOG_CHANNELS) {
+                cursor = channelCursor;
+            }
+        }
+        shot.samples.push_back(record);
+    }
+    return true;
+}
+
+void synthesize(Shot &shot) {
+    // 4 Hz, 5 s ramp to 3 bar, 10 s bloom, 25 s at 9 bar with sensor noise and a linear weight increase
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    shot.name = "synthetic";
+    initShotLogHeader(shot.header, "synthetic", 0, 250);
+    for (unsigned long t = 0; t <= 40000; t += 250) {
+        const float seconds = t / 1000.0f;
+        float tp = seconds < 5 ? 3.0f : seconds < 15 ? 0.0f : 9.0f;
+        float cp = seconds < 5 ? seconds * 0.6f : seconds < 15 ? 3.0f - (seconds - 5) * 0.2f : std::min(9.0f, (seconds - 15) * 3.0f);
+        cp += noise(rng) * 0.02f;
+        const float weight = seconds < 18 ? 0.0f : (seconds - 18) * 1.7f;
+        const float values[SHOT_LOG_CHANNELS] = {93.0f, 92.6f + noise(rng) * 0.05f, tp, cp, seconds < 15 && seconds > 5 ? 0.0f : 2.0f,
+                                                 0.0f,  weight > 0 ? 1.6f : 0.0f,     0.0f, weight,         weight * 0.95f, 0.0f};
+        ShotLogRecord record{};
+        record.t = shotLogTicks(t, shot.header.timeUnit);
+        for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+            record.values[i] = shotLogQuantize(values[i], shot.header.scales[i]);
+        }
+        shot.samples.push_back(record);
+    }
+}
+
+size_t fileSize(size_t records) {
+    const size_t blocks = (records + SHOT_LOG_BLOCK_RECORDS - 1) / SHOT_LOG_BLOCK_RECORDS;
+    return sizeof(ShotLogHeader) + blocks * sizeof(ShotLogBlockHeader) + records * sizeof(ShotLogRecord);
+}
+
+void run(const Shot &shot, int tolerancePercent) {
+    uint16_t tolerances[SHOT_LOG_CHANNELS];
+    for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+        tolerances[i] = SHOT_LOG_DEFAULT_TOLERANCES[i] * tolerancePercent / 100;
+    }
+    ShotLogEncoder encoder;
+    encoder.reset(tolerances);
+    std::vector<ShotLogRecord> encoded;
+    ShotLogRecord out{};
+    for (const auto &sample : shot.samples) {
+        if (encoder.push(sample, out)) {
+            encoded.push_back(out);
+        }
+    }
+    if (encoder.finish(out)) {
+        encoded.push_back(out);
+    }
+
+    float maxError[SHOT_LOG_CHANNELS] = {};
+    size_t cursor = 0;
+    for (const auto &sample : shot.samples) {
+        for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+            size_t channelCursor = cursor;
+            const float error = std::abs(interpolate(encoded, sample.t, i, channelCursor) - sample.values[i]) /
+                                static_cast<float>(shot.header.scales[i]);
+            maxError[i] = std::max(maxError[i], error);
+            if (i + 1 == SHOT_LOG_CHANNELS) {
+                cursor = channelCursor;
+            }
+        }
+    }
+
+    const size_t raw = fileSize(shot.samples.size());
+    const size_t compressed = fileSize(encoded.size());
+    printf("%s: %zu samples -> %zu records, %zu -> %zu bytes (%.1fx)", shot.name.c_str(), shot.samples.size(), encoded.size(),
+           raw, compressed, static_cast<double>(raw) / compressed);
+    if (shot.csvBytes > 0) {
+        printf(", CSV %zu bytes (%.1fx)", shot.csvBytes, static_cast<double>(shot.csvBytes) / compressed);
+    }
+    printf("\n  max error:");
+    for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+        printf(" %s=%.3f", CHANNEL_NAMES[i], maxError[i]);
+    }
+    printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int tolerancePercent = 100;
+    std::vector<Shot> shots;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--tolerance" && i + 1 < argc) {
+            tolerancePercent = atoi(argv[++i]);
+            continue;
+        }
+        Shot shot;
+        if (arg == "--synthetic") {
+            synthesize(shot);
+            shots.push_back(shot);
+            continue;
+        }
+        std::ifstream file(arg, std::ios::binary);
+        const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        shot.name = arg;
+        uint32_t magic = 0;
+        if (content.size() >= sizeof(magic)) {
+            memcpy(&magic, content.data(), sizeof(magic));
+        }
+        if (magic == SHOT_LOG_MAGIC ? loadBinary(content, shot) : loadCsv(content, shot)) {
+            shots.push_back(shot);
+        } else {
+            fprintf(stderr, "%s: no samples\n", arg.c_str());
+        }
+    }
+    if (shots.empty()) {
+        fprintf(stderr, "usage: %s [--tolerance <percent>] [--synthetic] <shot.dat>...\n", argv[0]);
+        return 1;
+    }
+    for (const auto &shot : shots) {
+        run(shot, tolerancePercent);
+    }
+    return 0;
+}
@@ -0,0 +1,244 @@
+// Round-trips shot logs through the binary block format and compares them to the legacy CSV history files.
+//
+// Build and run on the host:
+//   g++ -std=c++17 -O2 -Isrc scripts/bench/shot_log_bench.cpp -o shot_log_bench
+//   ./shot_log_bench [shots]
+//
+// Every shot is written the way ShotHistoryPlugin does (header, then blocks of up to SHOT_LOG_BLOCK_RECORDS records
+// with their CRC) and read back with readShotLog, which has to return every field unchanged. Truncated files and
+// corrupted blocks have to stop reading at the last intact block. Exits with 1 on the first mismatch.
+
+#include <display/models/shot_log.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Shot {
+    ShotLogHeader header{};
+    std::vector<ShotLogRecord> records;
+};
+
+// 40 s at 4 Hz with noise on every channel, values spread over the whole quantized range of each channel
+Shot synthesize(std::mt19937 &rng, uint32_t index) {
+    std::uniform_int_distribution<int> noise(-40, 40);
+    std::uniform_int_distribution<int> duration(120, 200);
+    Shot shot;
+    initShotLogHeader(shot.header, index % 2 ? "Turbo Shot" : "Classic 9 bar", 1700000000 + index * 600, 250);
+    const int samples = duration(rng);
+    for (int i = 0; i < samples; i++) {
+        ShotLogRecord record{};
+        record.t = shotLogTicks(static_cast<unsigned long>(i) * 250, shot.header.timeUnit);
+        const float seconds = i * 0.25f;
+        const float values[SHOT_LOG_CHANNELS] = {93.0f, 92.0f + seconds * 0.02f, 9.0f, std::min(9.0f, seconds * 0.8f), 2.1f,
+                                                 2.0f,  1.8f,                    1.7f, seconds * 1.1f, seconds * 1.05f, 3.2f};
+        for (size_t c = 0; c < SHOT_LOG_CHANNELS; c++) {
+            record.values[c] = static_cast<int16_t>(shotLogQuantize(values[c], shot.header.scales[c]) + noise(rng));
+        }
+        shot.records.push_back(record);
+    }
+    return shot;
+}
+
+// Same layout as ShotHistoryPlugin::writeBlock
+std::vector<uint8_t> writeShotLog(const Shot &shot) {
+    std::vector<uint8_t> out(sizeof(ShotLogHeader));
+    memcpy(out.data(), &shot.header, sizeof(ShotLogHeader));
+    for (size_t start = 0; start < shot.records.size(); start += SHOT_LOG_BLOCK_RECORDS) {
+        const size_t count = std::min(SHOT_LOG_BLOCK_RECORDS, shot.records.size() - start);
+        const size_t recordBytes = count * sizeof(ShotLogRecord);
+        ShotLogBlockHeader block{};
+        block.count = static_cast<uint16_t>(count);
+        block.crc = shotLogCrc16(reinterpret_cast<const uint8_t *>(&shot.records[start]), recordBytes);
+        const size_t offset = out.size();
+        out.resize(offset + sizeof(block) + recordBytes);
+        memcpy(out.data() + offset, &block, sizeof(block));
+        memcpy(out.data() + offset + sizeof(block), &shot.records[start], recordBytes);
+    }
+    return out;
+}
+
+// Same format as the CSV files written before the binary log
+std::string writeCsv(const Shot &shot) {
+    std::string out;
+    char line[192];
+    snprintf(line, sizeof(line), "1,%s,%u\n", shot.header.profileName, shot.header.timestamp);
+    out += line;
+    for (const auto &record : shot.records) {
+        float v[SHOT_LOG_CHANNELS];
+        for (size_t c = 0; c < SHOT_LOG_CHANNELS; c++) {
+            v[c] = shotLogDequantize(record.values[c], shot.header.scales[c]);
+        }
+        snprintf(line, sizeof(line), "%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                 static_cast<unsigned>(record.t) * shot.header.timeUnit, v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8],
+                 v[9], v[10]);
+        out += line;
+    }
+    return out;
+}
+
+size_t readCsv(const std::string &csv, std::vector<float> &values) {
+    size_t rows = 0;
+    const char *cursor = strchr(csv.c_str(), '\n');
+    while (cursor != nullptr && *++cursor != '\0') {
+        char *end = nullptr;
+        for (size_t c = 0; c <= SHOT_LOG_CHANNELS; c++) {
+            values.push_back(strtof(cursor, &end));
+            cursor = end + 1;
+        }
+        cursor = end;
+        rows++;
+    }
+    return rows;
+}
+
+bool sameRecord(const ShotLogRecord &a, const ShotLogRecord &b) {
+    if (a.t != b.t) {
+        return false;
+    }
+    for (size_t c = 0; c < SHOT_LOG_CHANNELS; c++) {
+        if (a.values[c] != b.values[c]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads data and expects exactly the first expected records of the shot
+bool expectRecords(const char *label, const Shot &shot, const uint8_t *data, size_t length, size_t expected) {
+    ShotLogHeader header{};
+    std::vector<ShotLogRecord> records;
+    const bool ok = readShotLog(data, length, header, records);
+    if (ok != (expected > 0) || records.size() != expected) {
+        printf("FAIL %s at %zu bytes: %zu records, expected %zu\n", label, length, records.size(), expected);
+        return false;
+    }
+    for (size_t i = 0; i < expected; i++) {
+        if (!sameRecord(records[i], shot.records[i])) {
+            printf("FAIL %s at %zu bytes: record %zu differs\n", label, length, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool roundTrip(const Shot &shot, const std::vector<uint8_t> &file) {
+    ShotLogHeader header{};
+    std::vector<ShotLogRecord> records;
+    if (!readShotLog(file.data(), file.size(), header, records)) {
+        printf("FAIL shot %u was not read back\n", shot.header.timestamp);
+        return false;
+    }
+    if (memcmp(&header, &shot.header, sizeof(header)) != 0) {
+        printf("FAIL header of shot %u differs\n", shot.header.timestamp);
+        return false;
+    }
+    return expectRecords("round trip", shot, file.data(), file.size(), shot.records.size());
+}
+
+bool corruption(const Shot &shot, const std::vector<uint8_t> &file) {
+    // A torn write keeps every block that was complete before it
+    for (size_t length = 0; length < file.size(); length++) {
+        const size_t blocks = length < sizeof(ShotLogHeader) ? 0 : (length - sizeof(ShotLogHeader)) / SHOT_LOG_BLOCK_SIZE;
+        if (!expectRecords("truncated", shot, file.data(), length, blocks * SHOT_LOG_BLOCK_RECORDS)) {
+            return false;
+        }
+    }
+    // A flipped bit in a record or a block header stops reading at that block
+    for (size_t offset = sizeof(ShotLogHeader); offset < file.size(); offset++) {
+        std::vector<uint8_t> corrupt = file;
+        corrupt[offset] ^= 0x10;
+        const size_t block = (offset - sizeof(ShotLogHeader)) / SHOT_LOG_BLOCK_SIZE;
+        if (!expectRecords("corrupt", shot, corrupt.data(), corrupt.size(), block * SHOT_LOG_BLOCK_RECORDS)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename F> double measure(F &&run, size_t repeat) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < repeat; i++) {
+        run();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / repeat;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 50;
+    std::mt19937 rng(7);
+    std::vector<Shot> shots;
+    std::vector<std::vector<uint8_t>> files;
+    std::vector<std::string> csvs;
+    size_t records = 0;
+    for (size_t i = 0; i < count; i++) {
+        shots.push_back(synthesize(rng, static_cast<uint32_t>(i)));
+        files.push_back(writeShotLog(shots.back()));
+        csvs.push_back(writeCsv(shots.back()));
+        records += shots.back().records.size();
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!roundTrip(shots[i], files[i]) || (i < 5 && !corruption(shots[i], files[i]))) {
+            return 1;
+        }
+    }
+    printf("%zu shots with %zu records read back unchanged, truncated and corrupt blocks stop at the CRC\n", count, records);
+
+    size_t binaryBytes = 0;
+    size_t csvBytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        binaryBytes += files[i].size();
+        csvBytes += csvs[i].size();
+    }
+    printf("size: binary %zu bytes (%.1f per record), CSV %zu bytes (%.1f per record), %.1fx\n", binaryBytes,
+           static_cast<double>(binaryBytes) / records, csvBytes, static_cast<double>(csvBytes) / records,
+           static_cast<double>(csvBytes) / binaryBytes);
+
+    const size_t repeat = 20;
+    size_t sink = 0;
+    const double binaryWrite = measure(
+        [&] {
+            for (const auto &shot : shots) {
+                sink += writeShotLog(shot).size();
+            }
+        },
+        repeat);
+    const double csvWrite = measure(
+        [&] {
+            for (const auto &shot : shots) {
+                sink += writeCsv(shot).size();
+            }
+        },
+        repeat);
+    const double binaryRead = measure(
+        [&] {
+            for (const auto &file : files) {
+                ShotLogHeader header{};
+                std::vector<ShotLogRecord> decoded;
+                readShotLog(file.data(), file.size(), header, decoded);
+                sink += decoded.size();
+            }
+        },
+        repeat);
+    const double csvRead = measure(
+        [&] {
+            for (const auto &csv : csvs) {
+                std::vector<float> values;
+                sink += readCsv(csv, values);
+            }
+        },
+        repeat);
+    printf("%-7s %10s %10s\n", "", "write", "read");
+    printf("%-7s %6.1f MR/s %6.1f MR/s\n", "binary", records / binaryWrite / 1e6, records / binaryRead / 1e6);
+    printf("%-7s %6.1f MR/s %6.1f MR/s\n", "CSV", records / csvWrite / 1e6, records / csvRead / 1e6);
+    return sink == 0 ? 1 : 0;
+}
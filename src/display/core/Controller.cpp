@@ -1,6 +1,7 @@
 #include "Controller.h"
 #include "ArduinoJson.h"
 #include <SPIFFS.h>
+#include <algorithm>
 #include <ctime>
 #include <display/config.h>
 #include <display/core/constants.h>
@@ -30,6 +31,15 @@ void Controller::setup() {
     }
 
     pluginManager = new PluginManager();
+    // Sensor events arrive with every notification, most listeners only need them when the value actually moved
+    pluginManager->coalesce("boiler:pressure:change", EVENT_BOILER_PRESSURE_COALESCED, SENSOR_EVENT_MIN_INTERVAL_MS, 0.05f,
+                            SENSOR_EVENT_MAX_INTERVAL_MS);
+    pluginManager->coalesce("pump:puck-flow:change", EVENT_PUMP_PUCK_FLOW_COALESCED, SENSOR_EVENT_MIN_INTERVAL_MS, 0.05f,
+                            SENSOR_EVENT_MAX_INTERVAL_MS);
+    pluginManager->coalesce("pump:flow:change", EVENT_PUMP_FLOW_COALESCED, SENSOR_EVENT_MIN_INTERVAL_MS, 0.05f,
+                            SENSOR_EVENT_MAX_INTERVAL_MS);
+    pluginManager->coalesce("pump:puck-resistance:change", EVENT_PUMP_PUCK_RESISTANCE_COALESCED, SENSOR_EVENT_MIN_INTERVAL_MS,
+                            0.05f, SENSOR_EVENT_MAX_INTERVAL_MS);
     profileManager = new ProfileManager(SPIFFS, "/p", settings, pluginManager);
     profileManager->setup();
 #ifndef GAGGIMATE_HEADLESS
@@ -94,15 +104,18 @@ void Controller::connect() {
 void Controller::setupBluetooth() {
     clientController.initClient();
     clientController.registerSensorCallback(
-        [this](const float temp, const float pressure, const float puckFlow, const float pumpFlow, const float puckResistance) {
+        [this](const float temp, const float pressure, const float puckFlow, const float pumpFlow, const float puckResistance,
+               const unsigned long timestamp) {
             onTempRead(temp);
             this->pressure = pressure;
             this->currentPuckFlow = puckFlow;
             this->currentPumpFlow = pumpFlow;
-            pluginManager->trigger("boiler:pressure:change", "value", pressure);
-            pluginManager->trigger("pump:puck-flow:change", "value", puckFlow);
-            pluginManager->trigger("pump:flow:change", "value", pumpFlow);
-            pluginManager->trigger("pump:puck-resistance:change", "value", puckResistance);
+            // Dropped while nobody consumes the samples
+            sensorSamples.push(SensorSample{timestamp, currentTemp, pressure, puckFlow, pumpFlow, puckResistance});
+            pluginManager->trigger(EVENT_BOILER_PRESSURE_CHANGE, EVENT_KEY_VALUE, pressure);
+            pluginManager->trigger(EVENT_PUMP_PUCK_FLOW_CHANGE, EVENT_KEY_VALUE, puckFlow);
+            pluginManager->trigger(EVENT_PUMP_FLOW_CHANGE, EVENT_KEY_VALUE, pumpFlow);
+            pluginManager->trigger(EVENT_PUMP_PUCK_RESISTANCE_CHANGE, EVENT_KEY_VALUE, puckResistance);
         });
     clientController.registerBrewBtnCallback([this](const int brewButtonStatus) { handleBrewButton(brewButtonStatus); });
     clientController.registerSteamBtnCallback([this](const int steamButtonStatus) { handleSteamButton(steamButtonStatus); });
@@ -130,11 +143,13 @@ void Controller::setupBluetooth() {
         ESP_LOGV(LOG_TAG, "Received new TOF distance: %d", value);
         pluginManager->trigger("controller:tof:change", "value", value);
     });
+    clientController.registerProfileStatusCallback(
+        [this](const uint8_t state, const uint8_t phase) { profileStatus.push(ProfileStatus{state, phase}); });
     pluginManager->trigger("controller:bluetooth:init");
 }
 
 void Controller::setupInfos() {
-    const std::string info = clientController.readInfo();
+    const std::string &info = clientController.getServerInfo();
     printf("System info: %s\n", info.c_str());
     JsonDocument doc;
     DeserializationError err = deserializeJson(doc, info);
@@ -150,8 +165,11 @@ void Controller::setupInfos() {
                                     .pressure = doc["cp"]["ps"].as<bool>(),
                                     .ledControl = doc["cp"]["led"].as<bool>(),
                                     .tof = doc["cp"]["tof"].as<bool>(),
+                                    .binaryProtocol = doc["cp"]["bin"] | static_cast<uint8_t>(0),
+                                    .profileVersion = doc["cp"]["prof"] | static_cast<uint8_t>(0),
                                 }};
     }
+    clientController.setBinaryProtocol(systemInfo.capabilities.binaryProtocol);
 }
 
 void Controller::setupWifi() {
@@ -201,14 +219,32 @@ void Controller::setupWifi() {
 }
 
 void Controller::loop() {
+    // Time since the previous iteration started, only once the startup in connect() is done
+    const uint32_t loopStarted = micros();
+    if (lastLoopStarted != 0) {
+        lastLoopStall = loopStarted - lastLoopStarted;
+        maxLoopStall = std::max(maxLoopStall, lastLoopStall);
+    }
+    lastLoopStarted = initialized ? loopStarted : 0;
+
     pluginManager->loop();
 
     if (screenReady) {
         connect();
     }
 
-    if (clientController.isReadyForConnection()) {
-        clientController.connectToServer();
+    // Connections are established by the BLE client task
+    if (clientController.takeConnected()) {
+        // Status notifications sent while the link was down are lost, and the board stopped the profile on the ping
+        // timeout. A remote brew carries on locally from the phase the display knows.
+        if (currentProcess != nullptr && currentProcess->getType() == MODE_BREW) {
+            auto *brewProcess = static_cast<BrewProcess *>(currentProcess);
+            if (brewProcess->remote) {
+                ESP_LOGW(LOG_TAG, "Reconnected during a remote brew, running the rest of it locally");
+                brewProcess->remote = false;
+                requestControlUpdate(true);
+            }
+        }
         setupInfos();
         pluginManager->trigger("controller:bluetooth:connect");
         if (!loaded) {
@@ -225,6 +261,14 @@ void Controller::loop() {
         }
     }
 
+    // Shortest connection interval for the telemetry of a running shot, long intervals while idle
+    if (currentProcess != nullptr && currentProcess->getType() == MODE_BREW) {
+        clientController.setLinkMode(BleLinkMode::BREWING);
+    } else {
+        clientController.setLinkMode(mode == MODE_STANDBY ? BleLinkMode::STANDBY : BleLinkMode::IDLE);
+    }
+    clientController.loop();
+
     unsigned long now = millis();
     if (now - lastPing > PING_INTERVAL) {
         lastPing = now;
@@ -235,6 +279,8 @@ void Controller::loop() {
         return;
     }
 
+    applyProfileStatus();
+
     if (now - lastProgress > PROGRESS_INTERVAL) {
         // Check if steam is ready
         if (mode == MODE_STEAM && !steamReady && currentTemp + 5.f > getTargetTemp()) {
@@ -248,12 +294,23 @@ void Controller::loop() {
                 auto brewProcess = static_cast<BrewProcess *>(currentProcess);
                 brewProcess->updatePressure(pressure);
                 brewProcess->updateFlow(currentPumpFlow);
+                const unsigned int phaseIndex = brewProcess->phaseIndex;
+                const int requestedAdvance = brewProcess->requestedAdvance;
+                brewProcess->progress();
+                if (brewProcess->phaseIndex != phaseIndex || !brewProcess->isActive() ||
+                    brewProcess->requestedAdvance != requestedAdvance) {
+                    requestControlUpdate(true);
+                } else if (brewProcess->isInTransition()) {
+                    requestControlUpdate();
+                }
+            } else {
+                currentProcess->progress();
             }
-            currentProcess->progress();
             if (!isActive()) {
                 deactivate();
             }
         }
+        updatePumpModelCalibration();
 
         // Handle last process - Calculate auto delay
         if (lastProcess != nullptr && !lastProcess->isComplete()) {
@@ -284,10 +341,64 @@ void Controller::loop() {
 
 void Controller::loopControl() {
     if (initialized) {
+        // Taken before the update so a request arriving meanwhile wakes the task again
+        const uint32_t requestedAt = controlRequestedAt.exchange(0);
         updateControl();
+        controlUpdates++;
+        if (requestedAt != 0) {
+            lastControlLatency = micros() - requestedAt;
+            maxControlLatency = std::max(maxControlLatency, lastControlLatency);
+            totalControlLatency += lastControlLatency;
+            triggeredUpdates++;
+        }
+    }
+}
+
+void Controller::requestControlUpdate(bool measureLatency) {
+    if (measureLatency) {
+        uint32_t expected = 0;
+        controlRequestedAt.compare_exchange_strong(expected, micros() | 1);
+    }
+    if (taskHandle != nullptr) {
+        xTaskNotifyGive(taskHandle);
     }
 }
 
+// Phase changes of a profile run by the controller board, older ones are discarded when no such brew is active
+void Controller::applyProfileStatus() {
+    ProfileStatus status{};
+    while (profileStatus.pop(status)) {
+        if (currentProcess == nullptr || currentProcess->getType() != MODE_BREW) {
+            continue;
+        }
+        auto *brewProcess = static_cast<BrewProcess *>(currentProcess);
+        if (!brewProcess->remote) {
+            continue;
+        }
+        if (status.state == BLE_PROFILE_IDLE) {
+            // Statuses arrive in order, so an idle board after this brew ran means it was stopped there. An idle
+            // status from before the start is left alone.
+            if (brewProcess->remoteRunning && brewProcess->isActive()) {
+                ESP_LOGW(LOG_TAG, "Controller board stopped the profile, ending the brew");
+                brewProcess->abortRemote();
+                requestControlUpdate(true);
+            }
+            continue;
+        }
+        const unsigned int phaseIndex = brewProcess->phaseIndex;
+        brewProcess->applyRemoteStatus(status.phase, status.state == BLE_PROFILE_FINISHED);
+        if (brewProcess->phaseIndex != phaseIndex || !brewProcess->isActive()) {
+            requestControlUpdate(true);
+        }
+    }
+}
+
+ControlLatencyStats Controller::getControlLatencyStats() const {
+    return ControlLatencyStats{controlUpdates, triggeredUpdates, lastControlLatency, maxControlLatency, totalControlLatency};
+}
+
+LoopStallStats Controller::getLoopStallStats() const { return LoopStallStats{lastLoopStall, maxLoopStall}; }
+
 bool Controller::isUpdating() const { return updating; }
 
 bool Controller::isAutotuning() const { return autotuning; }
@@ -319,6 +430,7 @@ void Controller::startProcess(Process *process) {
         return;
     processCompleted = false;
     this->currentProcess = process;
+    requestControlUpdate(true);
     pluginManager->trigger("controller:process:start");
     updateLastAction();
 }
@@ -356,6 +468,7 @@ void Controller::setTargetTemp(float temperature) {
         break;
     default:;
     }
+    requestControlUpdate();
     updateLastAction();
 }
 
@@ -371,6 +484,36 @@ void Controller::setPumpModelCoeffs(void) {
     }
 }
 
+// Runs on the loop task with the brew process progress, so the calibrator needs no lock
+void Controller::updatePumpModelCalibration() {
+    if (settings.getPumpModelCoeffs() != calibratedPumpModel) {
+        // Entered in the settings, learn on from there
+        calibratedPumpModel = settings.getPumpModelCoeffs();
+        pumpModelCalibrator.reset(calibratedPumpModel.c_str());
+    }
+    if (!isActive() || currentProcess->getType() != MODE_BREW) {
+        if (pumpModelCalibrator.isRunning() && pumpModelCalibrator.finishShot()) {
+            char coefficients[64];
+            pumpModelCalibrator.format(coefficients, sizeof(coefficients));
+            ESP_LOGI(LOG_TAG, "Pump model calibrated from %zu steady blocks: %s", pumpModelCalibrator.getBlocks(), coefficients);
+            calibratedPumpModel = coefficients;
+            settings.setPumpModelCoeffs(calibratedPumpModel);
+            setPumpModelCoeffs();
+        }
+        return;
+    }
+    // Only a Bluetooth scale weighs what the pump delivered, the estimated volume comes from the pump model itself
+    if (!settings.isPumpModelAdjust() || !volumetricOverride || !systemInfo.capabilities.dimming ||
+        !systemInfo.capabilities.pressure) {
+        return;
+    }
+    if (!pumpModelCalibrator.isRunning()) {
+        pumpModelCalibrator.startShot();
+    }
+    const auto *brewProcess = static_cast<BrewProcess *>(currentProcess);
+    pumpModelCalibrator.addSample(millis(), pressure, currentPumpFlow, static_cast<float>(brewProcess->currentVolume));
+}
+
 int Controller::getTargetDuration() const { return settings.getTargetDuration(); }
 
 void Controller::setTargetDuration(int duration) {
@@ -481,6 +624,15 @@ void Controller::updateControl() {
         targetTemp = targetTemp + static_cast<float>(settings.getTemperatureOffset());
     }
     clientController.sendAltControl(isActive() && currentProcess->isAltRelayActive());
+    if (remoteProfileRunning) {
+        const auto *brewProcess = isActive() && currentProcess->getType() == MODE_BREW
+                                      ? static_cast<const BrewProcess *>(currentProcess)
+                                      : nullptr;
+        if (brewProcess == nullptr || !brewProcess->remoteStarted) {
+            clientController.sendProfileControl(BLE_PROFILE_STOP, 0);
+            remoteProfileRunning = false;
+        }
+    }
     if (isActive() && systemInfo.capabilities.pressure) {
         if (currentProcess->getType() == MODE_STEAM) {
             targetPressure = settings.getSteamPumpCutoff();
@@ -490,6 +642,11 @@ void Controller::updateControl() {
         }
         if (currentProcess->getType() == MODE_BREW) {
             auto *brewProcess = static_cast<BrewProcess *>(currentProcess);
+            if (brewProcess->remote && updateRemoteProfile(*brewProcess, targetTemp)) {
+                targetPressure = brewProcess->getPumpPressure();
+                targetFlow = brewProcess->getPumpFlow();
+                return;
+            }
             if (brewProcess->isAdvancedPump()) {
                 clientController.sendAdvancedOutputControl(brewProcess->isRelayActive(), targetTemp,
                                                            brewProcess->getPumpTarget() == PumpTarget::PUMP_TARGET_PRESSURE,
@@ -506,6 +663,83 @@ void Controller::updateControl() {
                                        isActive() ? currentProcess->getPumpValue() : 0, targetTemp);
 }
 
+static uint16_t encodePhaseTime(float seconds) {
+    return static_cast<uint16_t>(std::clamp(std::round(seconds * 10.0f), 0.0f, 65535.0f));
+}
+
+// Volumetric targets stay on the display, returns false if the profile doesn't fit into a frame
+static bool encodeProfile(const BrewProcess &process, BleProfileFrame &frame) {
+    const Profile &profile = process.profile;
+    const bool volumetric = process.target == ProcessTarget::VOLUMETRIC;
+    if (profile.phases.empty() || profile.phases.size() > BLE_PROFILE_MAX_PHASES) {
+        return false;
+    }
+    frame.phaseCount = profile.phases.size();
+    for (size_t i = 0; i < profile.phases.size(); i++) {
+        const Phase &phase = profile.phases[i];
+        BleProfilePhase &encoded = frame.phases[i];
+        encoded.flags = (phase.valve ? BLE_PHASE_FLAG_VALVE : 0) | (phase.pumpIsSimple ? BLE_PHASE_FLAG_SIMPLE_PUMP : 0) |
+                        (phase.pumpAdvanced.target == PumpTarget::PUMP_TARGET_PRESSURE ? BLE_PHASE_FLAG_PRESSURE_TARGET : 0) |
+                        (phase.transition.adaptive ? BLE_PHASE_FLAG_ADAPTIVE : 0);
+        encoded.transition = static_cast<uint8_t>(phase.transition.type); // same order as BleTransitionType
+        encoded.duration = encodePhaseTime(phase.duration);
+        encoded.transitionDuration = encodePhaseTime(phase.transition.duration);
+        encoded.pumpSimple = static_cast<uint8_t>(std::clamp(phase.pumpSimple, 0, 100));
+        encoded.pressure = bleFixed16(phase.pumpAdvanced.pressure, BLE_SCALE_TARGET);
+        encoded.flow = bleFixed16(phase.pumpAdvanced.flow, BLE_SCALE_TARGET);
+        for (const auto &target : phase.targets) {
+            uint8_t type = 0;
+            switch (target.type) {
+            case TargetType::TARGET_TYPE_VOLUMETRIC:
+                // Standard profiles only end volumetric phases by weight, like Phase::isFinished
+                if (volumetric && profile.type == "standard") {
+                    encoded.flags |= BLE_PHASE_FLAG_NO_DURATION;
+                }
+                continue;
+            case TargetType::TARGET_TYPE_PRESSURE:
+                type = BLE_TARGET_PRESSURE;
+                break;
+            case TargetType::TARGET_TYPE_FLOW:
+                type = BLE_TARGET_FLOW;
+                break;
+            case TargetType::TARGET_TYPE_PUMPED:
+                type = BLE_TARGET_PUMPED;
+                break;
+            }
+            if (encoded.targetCount >= BLE_PROFILE_MAX_TARGETS) {
+                return false;
+            }
+            encoded.targets[encoded.targetCount++] = BleProfileTarget{
+                static_cast<uint8_t>(type | (target.operator_ == TargetOperator::GTE ? BLE_TARGET_FLAG_GTE : 0)), target.value};
+        }
+    }
+    return true;
+}
+
+// Uploads and starts the profile on the controller board with the first update of a remote brew, afterwards only the
+// boiler setpoint and phases finished by local targets are sent. Returns false if the brew has to run locally.
+bool Controller::updateRemoteProfile(BrewProcess &process, float boilerSetpoint) {
+    if (!process.remoteStarted) {
+        BleProfileFrame frame{};
+        if (!encodeProfile(process, frame) || !clientController.sendProfile(frame) ||
+            !clientController.sendProfileControl(BLE_PROFILE_START, 0)) {
+            ESP_LOGW(LOG_TAG, "Could not start the profile on the controller board, running it locally");
+            process.remote = false;
+            return false;
+        }
+        process.remoteStarted = true;
+        remoteProfileRunning = true;
+        lastAdvanceRequest = -1;
+    }
+    const int requestedAdvance = process.requestedAdvance;
+    if (requestedAdvance >= 0 && requestedAdvance != lastAdvanceRequest) {
+        lastAdvanceRequest = requestedAdvance;
+        clientController.sendProfileControl(BLE_PROFILE_ADVANCE, static_cast<uint8_t>(requestedAdvance));
+    }
+    clientController.sendProfileOutputControl(boilerSetpoint);
+    return true;
+}
+
 void Controller::activate() {
     if (isActive())
         return;
@@ -515,12 +749,15 @@ void Controller::activate() {
         pluginManager->trigger("controller:brew:prestart");
     delay(100);
     switch (mode) {
-    case MODE_BREW:
-        startProcess(new BrewProcess(profileManager->getSelectedProfile(),
-                                     settings.isVolumetricTarget() && isVolumetricAvailable() ? ProcessTarget::VOLUMETRIC
-                                                                                              : ProcessTarget::TIME,
-                                     settings.getBrewDelay()));
+    case MODE_BREW: {
+        auto *brewProcess = new BrewProcess(profileManager->getSelectedProfile(),
+                                            settings.isVolumetricTarget() && isVolumetricAvailable() ? ProcessTarget::VOLUMETRIC
+                                                                                                     : ProcessTarget::TIME,
+                                            settings.getBrewDelay());
+        brewProcess->remote = canExecuteProfiles();
+        startProcess(brewProcess);
         break;
+    }
     case MODE_STEAM:
         startProcess(new SteamProcess(STEAM_SAFETY_DURATION_MS, settings.getSteamPumpPercentage()));
         break;
@@ -541,6 +778,7 @@ void Controller::deactivate() {
     delete lastProcess;
     lastProcess = currentProcess;
     currentProcess = nullptr;
+    requestControlUpdate(true);
     if (lastProcess->getType() == MODE_BREW) {
         pluginManager->trigger("controller:brew:end");
     } else if (lastProcess->getType() == MODE_GRIND) {
@@ -604,8 +842,8 @@ void Controller::setMode(int newMode) {
 
 void Controller::onTempRead(float temperature) {
     float temp = temperature - static_cast<float>(settings.getTemperatureOffset());
-    Event event = pluginManager->trigger("boiler:currentTemperature:change", "value", temp);
-    currentTemp = event.getFloat("value");
+    Event event = pluginManager->trigger(EVENT_BOILER_CURRENT_TEMPERATURE_CHANGE, EVENT_KEY_VALUE, temp);
+    currentTemp = event.getFloat(EVENT_KEY_VALUE);
 }
 
 void Controller::updateLastAction() { lastAction = millis(); }
@@ -616,10 +854,9 @@ void Controller::onOTAUpdate() {
 }
 
 void Controller::onVolumetricMeasurement(double measurement, VolumetricMeasurementSource source) {
-    pluginManager->trigger(source == VolumetricMeasurementSource::FLOW_ESTIMATION
-                               ? F("controller:volumetric-measurement:estimation:change")
-                               : F("controller:volumetric-measurement:bluetooth:change"),
-                           "value", static_cast<float>(measurement));
+    pluginManager->trigger(source == VolumetricMeasurementSource::FLOW_ESTIMATION ? EVENT_VOLUMETRIC_ESTIMATION_CHANGE
+                                                                                  : EVENT_VOLUMETRIC_BLUETOOTH_CHANGE,
+                           EVENT_KEY_VALUE, static_cast<float>(measurement));
     // Bluetooth volume override is active, ignore volume estimation
     if (source == VolumetricMeasurementSource::FLOW_ESTIMATION && volumetricOverride) {
         return;
@@ -702,12 +939,16 @@ void Controller::handleSteamButton(int steamButtonStatus) {
 
 void Controller::handleProfileUpdate() {
     pluginManager->trigger("boiler:targetTemperature:change", "value", profileManager->getSelectedProfile().temperature);
+    requestControlUpdate();
 }
 
 void Controller::loopTask(void *arg) {
     auto *controller = static_cast<Controller *>(arg);
     while (true) {
+        // Woken by requestControlUpdate, otherwise the setpoints are refreshed at the configured interval
+        const int interval =
+            std::clamp(controller->settings.getControlInterval(), MIN_CONTROL_INTERVAL_MS, MAX_CONTROL_INTERVAL_MS);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(interval));
         controller->loopControl();
-        vTaskDelay(100 / portTICK_PERIOD_MS);
     }
 }
@@ -7,6 +7,9 @@
 #include "Settings.h"
 #include <WiFi.h>
 #include <display/core/ProfileManager.h>
+#include <display/core/PumpModelCalibrator.h>
+#include <atomic>
+#include <display/core/RingBuffer.h>
 #include <display/core/process/Process.h>
 #ifndef GAGGIMATE_HEADLESS
 #include <display/ui/default/DefaultUI.h>
@@ -17,6 +20,39 @@ const IPAddress WIFI_SUBNET_MASK(255, 255, 255, 0); // no need to change: https:
 
 enum class VolumetricMeasurementSource { FLOW_ESTIMATION, BLUETOOTH };
 
+// Time from a setpoint changing event (process start and end, phase change) to the resulting output control write
+struct ControlLatencyStats {
+    uint32_t updates;   // control updates
+    uint32_t triggered; // updates caused by a measured event
+    uint32_t last;      // µs
+    uint32_t max;       // µs
+    uint64_t total;     // µs, sum over all triggered updates
+};
+
+// Time between two iterations of the main loop, longer than the loop delay while a call blocks it
+struct LoopStallStats {
+    uint32_t last; // µs
+    uint32_t max;  // µs
+};
+
+// A sensor reading of the controller board, timestamp is the local millis() at which it was taken
+struct SensorSample {
+    unsigned long timestamp;
+    float temperature;
+    float pressure;
+    float puckFlow;
+    float pumpFlow;
+    float puckResistance;
+};
+
+// Phase change of a profile run by the controller board, see BleProfileStatusFrame
+struct ProfileStatus {
+    uint8_t state;
+    uint8_t phase;
+};
+
+class BrewProcess;
+
 class Controller {
   public:
     Controller() = default;
@@ -98,6 +134,21 @@ class Controller {
 
     NimBLEClientController *getClientController() { return &clientController; }
 
+    // True if the controller board sends batched sensor samples instead of periodic snapshots
+    bool hasSensorSampleStream() const { return clientController.getBinaryProtocol() >= BLE_PROTOCOL_BATCH_VERSION; }
+    // True if brew profiles can be run by the controller board instead of step by step from the display
+    bool canExecuteProfiles() const {
+        return systemInfo.capabilities.profileVersion >= BLE_PROFILE_VERSION && clientController.getBinaryProtocol() > 0;
+    }
+    // Wakes the control task to send the current setpoints now instead of at the next interval. With measureLatency
+    // the time until the setpoints were written is recorded.
+    void requestControlUpdate(bool measureLatency = false);
+    ControlLatencyStats getControlLatencyStats() const;
+    LoopStallStats getLoopStallStats() const;
+
+    // Received sensor samples in order, for a single consumer (the shot recorder)
+    bool popSensorSample(SensorSample &sample) { return sensorSamples.pop(sample); }
+
   private:
     // Initialization methods
     void setupPanel();
@@ -107,6 +158,9 @@ class Controller {
 
     // Functional methods
     void updateControl();
+    bool updateRemoteProfile(BrewProcess &process, float boilerSetpoint);
+    void applyProfileStatus();
+    void updatePumpModelCalibration();
 
     // Event handlers
     void onTempRead(float temperature);
@@ -136,6 +190,12 @@ class Controller {
     float currentPumpFlow = 0.0f;
     float targetFlow = 0.0f;
     int tofDistance = 0;
+    RingBuffer<SensorSample, SENSOR_SAMPLE_QUEUE_SIZE> sensorSamples;
+    RingBuffer<ProfileStatus, PROFILE_STATUS_QUEUE_SIZE> profileStatus;
+    bool remoteProfileRunning = false; // control task only
+    int lastAdvanceRequest = -1;       // control task only
+    PumpModelCalibrator pumpModelCalibrator;
+    String calibratedPumpModel; // pumpModelCoeffs the calibrator started from or learned
 
     SystemInfo systemInfo{};
 
@@ -157,7 +217,18 @@ class Controller {
     bool steamReady = false;
     int error = 0;
 
-    xTaskHandle taskHandle;
+    std::atomic<uint32_t> controlRequestedAt{0}; // micros() of the oldest measured request, 0 if none is pending
+    uint32_t controlUpdates = 0;
+    uint32_t triggeredUpdates = 0;
+    uint32_t lastControlLatency = 0;
+    uint32_t maxControlLatency = 0;
+    uint64_t totalControlLatency = 0;
+
+    uint32_t lastLoopStarted = 0; // micros(), 0 before the first measured iteration
+    uint32_t lastLoopStall = 0;
+    uint32_t maxLoopStall = 0;
+
+    xTaskHandle taskHandle = nullptr;
 
     static void loopTask(void *arg);
 };
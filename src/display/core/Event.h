@@ -1,66 +1,144 @@
 #ifndef EVENT_H
 #define EVENT_H
 
-#include <Arduino.h>
-#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Events and their payload keys are identified by a 32 bit FNV-1a hash of their name. The constexpr ids at the end
+// of this file are hashed at compile time. Names passed as strings are hashed on use so existing callers keep
+// working, they only cost the hash instead of a heap allocation.
+//
+// The payload is stored inline, an Event never allocates and can be copied freely, e.g. into a queue.
+// This header has no Arduino dependencies so it can be used by host tools, see scripts/bench.
+
+class __FlashStringHelper;
+
+constexpr size_t EVENT_MAX_ENTRIES = 4;
+constexpr size_t EVENT_STRING_LENGTH = 48;
+
+constexpr uint32_t eventHash(const char *name) {
+    uint32_t hash = 2166136261u;
+    while (*name != '\0') {
+        hash = (hash ^ static_cast<uint8_t>(*name++)) * 16777619u;
+    }
+    return hash;
+}
+
+struct EventId {
+    uint32_t hash = 0;
+
+    constexpr EventId() = default;
+    constexpr EventId(const char *name) : hash(eventHash(name)) {}
+    EventId(const __FlashStringHelper *name) : hash(eventHash(reinterpret_cast<const char *>(name))) {}
+    // Arduino String and std::string
+    template <typename S, typename = decltype(static_cast<const char *>(static_cast<const S *>(nullptr)->c_str()))>
+    EventId(const S &name) : hash(eventHash(name.c_str())) {}
+
+    constexpr bool operator==(const EventId &other) const { return hash == other.hash; }
+    constexpr bool operator!=(const EventId &other) const { return hash != other.hash; }
+    constexpr bool operator<(const EventId &other) const { return hash < other.hash; }
+};
 
-enum class EventDataType { EVENT_TYPE_INT, EVENT_TYPE_FLOAT, EVENT_TYPE_STRING, EVENT_TYPE_NONE };
+enum class EventDataType : uint8_t { EVENT_TYPE_INT, EVENT_TYPE_FLOAT, EVENT_TYPE_STRING, EVENT_TYPE_NONE };
 
 struct EventDataEntry {
-    String key;
+    EventId key;
     EventDataType type = EventDataType::EVENT_TYPE_NONE;
     int intValue = 0;
     float floatValue = 0.0f;
-    String stringValue = "";
-
-    EventDataEntry() = default;
-
-    EventDataEntry(const String &k, int value) : key(k), type(EventDataType::EVENT_TYPE_INT), intValue(value) {}
-
-    EventDataEntry(const String &k, float value) : key(k), type(EventDataType::EVENT_TYPE_FLOAT), floatValue(value) {}
-
-    EventDataEntry(const String &k, const String &value) : key(k), type(EventDataType::EVENT_TYPE_STRING), stringValue(value) {}
+    char stringValue[EVENT_STRING_LENGTH] = {}; // truncated to EVENT_STRING_LENGTH - 1 characters
 };
 
-using EventData = std::vector<EventDataEntry>;
-
 struct Event {
-    String id;
-    EventData data;
+    EventId id;
+    EventDataEntry data[EVENT_MAX_ENTRIES];
+    uint8_t dataCount = 0;
     bool stopPropagation = false;
 
-    void setInt(const String &key, int value) { data.emplace_back(key, value); }
+    Event() = default;
+    explicit Event(EventId eventId) : id(eventId) {}
 
-    void setFloat(const String &key, float value) { data.emplace_back(key, value); }
+    void setInt(EventId key, int value) {
+        if (EventDataEntry *entry = set(key, EventDataType::EVENT_TYPE_INT)) {
+            entry->intValue = value;
+        }
+    }
 
-    void setString(const String &key, const String &value) { data.emplace_back(key, value); }
+    void setFloat(EventId key, float value) {
+        if (EventDataEntry *entry = set(key, EventDataType::EVENT_TYPE_FLOAT)) {
+            entry->floatValue = value;
+        }
+    }
 
-    int getInt(const String &key) const {
-        for (const auto &entry : data) {
-            if (entry.key == key && entry.type == EventDataType::EVENT_TYPE_INT) {
-                return entry.intValue;
-            }
+    void setString(EventId key, const char *value) {
+        if (EventDataEntry *entry = set(key, EventDataType::EVENT_TYPE_STRING)) {
+            strncpy(entry->stringValue, value, EVENT_STRING_LENGTH - 1);
+            entry->stringValue[EVENT_STRING_LENGTH - 1] = '\0';
         }
-        return 0;
     }
 
-    float getFloat(const String &key) const {
-        for (const auto &entry : data) {
-            if (entry.key == key && entry.type == EventDataType::EVENT_TYPE_FLOAT) {
-                return entry.floatValue;
+    int getInt(EventId key) const {
+        const EventDataEntry *entry = get(key, EventDataType::EVENT_TYPE_INT);
+        return entry != nullptr ? entry->intValue : 0;
+    }
+
+    float getFloat(EventId key) const {
+        const EventDataEntry *entry = get(key, EventDataType::EVENT_TYPE_FLOAT);
+        return entry != nullptr ? entry->floatValue : 0.0f;
+    }
+
+    const char *getString(EventId key) const {
+        const EventDataEntry *entry = get(key, EventDataType::EVENT_TYPE_STRING);
+        return entry != nullptr ? entry->stringValue : "";
+    }
+
+  private:
+    EventDataEntry *set(EventId key, EventDataType type) {
+        // Setting a key again replaces its value
+        EventDataEntry *entry = nullptr;
+        for (uint8_t i = 0; i < dataCount; i++) {
+            if (data[i].key == key) {
+                entry = &data[i];
             }
         }
-        return 0.0f;
+        if (entry == nullptr) {
+            if (dataCount >= EVENT_MAX_ENTRIES) {
+                return nullptr;
+            }
+            entry = &data[dataCount++];
+        }
+        *entry = EventDataEntry{};
+        entry->key = key;
+        entry->type = type;
+        return entry;
     }
 
-    String getString(const String &key) const {
-        for (const auto &entry : data) {
-            if (entry.key == key && entry.type == EventDataType::EVENT_TYPE_STRING) {
-                return entry.stringValue;
+    const EventDataEntry *get(EventId key, EventDataType type) const {
+        for (uint8_t i = 0; i < dataCount; i++) {
+            if (data[i].key == key && data[i].type == type) {
+                return &data[i];
             }
         }
-        return "";
+        return nullptr;
     }
 };
 
+// Events triggered for every sensor update
+constexpr EventId EVENT_BOILER_PRESSURE_CHANGE = "boiler:pressure:change";
+constexpr EventId EVENT_BOILER_CURRENT_TEMPERATURE_CHANGE = "boiler:currentTemperature:change";
+constexpr EventId EVENT_PUMP_PUCK_FLOW_CHANGE = "pump:puck-flow:change";
+constexpr EventId EVENT_PUMP_FLOW_CHANGE = "pump:flow:change";
+constexpr EventId EVENT_PUMP_PUCK_RESISTANCE_CHANGE = "pump:puck-resistance:change";
+constexpr EventId EVENT_VOLUMETRIC_ESTIMATION_CHANGE = "controller:volumetric-measurement:estimation:change";
+constexpr EventId EVENT_VOLUMETRIC_BLUETOOTH_CHANGE = "controller:volumetric-measurement:bluetooth:change";
+
+// Rate limited copies of the sensor events, see PluginManager::coalesce
+constexpr EventId EVENT_BOILER_PRESSURE_COALESCED = "boiler:pressure:change:coalesced";
+constexpr EventId EVENT_PUMP_PUCK_FLOW_COALESCED = "pump:puck-flow:change:coalesced";
+constexpr EventId EVENT_PUMP_FLOW_COALESCED = "pump:flow:change:coalesced";
+constexpr EventId EVENT_PUMP_PUCK_RESISTANCE_COALESCED = "pump:puck-resistance:change:coalesced";
+
+constexpr EventId EVENT_KEY_VALUE = "value";
+
 #endif // EVENT_H
@@ -1,12 +1,13 @@
 #include "PluginManager.h"
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cmath>
 
 void PluginManager::registerPlugin(Plugin *plugin) { plugins.push_back(plugin); }
 
 void PluginManager::setup(Controller *controller) {
     ESP_LOGV("PluginManager", "Setting up PluginManager");
-    on("system:dummy", [](const Event &) {
-        // Register a dummy event so the event map is initialized properly
-    });
     for (const auto &plugin : plugins) {
         plugin->setup(controller, this);
     }
@@ -17,54 +18,198 @@ void PluginManager::loop() {
     if (!initialized)
         return;
     for (auto &plugin : plugins) {
+        auto it = subscribers.find(plugin);
+        if (it != subscribers.end()) {
+            dispatch(it->second);
+        }
         plugin->loop();
     }
 }
 
-void PluginManager::on(const String &eventId, const EventCallback &callback) {
-    ESP_LOGV("PluginManager", "Registering listener: %s", eventId.c_str());
-    listeners[std::string(eventId.c_str())].push_back(callback);
+void PluginManager::on(EventId eventId, const EventCallback &callback) {
+    ESP_LOGV("PluginManager", "Registering listener: %08x", eventId.hash);
+    insert(listeners, Listener{eventId, callback});
 }
 
-Event PluginManager::trigger(const String &eventId) {
-    Event event;
-    event.id = eventId;
+void PluginManager::on(Plugin *plugin, EventId eventId, const EventCallback &callback, EventDelivery delivery) {
+    if (delivery == EventDelivery::SYNC) {
+        on(eventId, callback);
+        return;
+    }
+    ESP_LOGV("PluginManager", "Registering queued listener: %08x", eventId.hash);
+    EventSubscriber &subscriber = subscribers[plugin];
+    if (subscriber.queue == nullptr) {
+        subscriber.queue = xQueueCreate(EVENT_QUEUE_LENGTH, sizeof(Event));
+    }
+    insert(subscriber.listeners, Listener{eventId, callback});
+
+    // Route the event to the subscriber once, no matter how many of its callbacks listen to it
+    const bool routed = std::any_of(listeners.begin(), listeners.end(), [&](const Listener &listener) {
+        return listener.eventId == eventId && listener.subscriber == &subscriber;
+    });
+    if (routed) {
+        return;
+    }
+    if (delivery == EventDelivery::COALESCE) {
+        subscriber.coalesced.emplace_back();
+        subscriber.coalesced.back().event.id = eventId;
+    }
+    insert(listeners, Listener{eventId, nullptr, &subscriber, delivery});
+}
+
+Event PluginManager::trigger(EventId eventId) {
+    Event event(eventId);
     trigger(event);
     return event;
 }
 
-Event PluginManager::trigger(const String &eventId, const String &key, const String &value) {
-    Event event;
-    event.id = eventId;
+Event PluginManager::trigger(EventId eventId, EventId key, const char *value) {
+    Event event(eventId);
     event.setString(key, value);
     trigger(event);
     return event;
 }
 
-Event PluginManager::trigger(const String &eventId, const String &key, const int value) {
-    Event event;
-    event.id = eventId;
+Event PluginManager::trigger(EventId eventId, EventId key, const int value) {
+    Event event(eventId);
     event.setInt(key, value);
     trigger(event);
     return event;
 }
 
-Event PluginManager::trigger(const String &eventId, const String &key, const float value) {
-    Event event;
-    event.id = eventId;
+Event PluginManager::trigger(EventId eventId, EventId key, const float value) {
+    Event event(eventId);
     event.setFloat(key, value);
     trigger(event);
     return event;
 }
 
 void PluginManager::trigger(Event &event) {
-    ESP_LOGV("PluginManager", "Triggering event: %s", event.id.c_str());
-    if (listeners.count(std::string(event.id.c_str()))) {
-        for (auto const &callback : listeners[std::string(event.id.c_str())]) {
-            callback(event);
-            if (event.stopPropagation) {
-                break;
+    ESP_LOGV("PluginManager", "Triggering event: %08x", event.id.hash);
+    auto it = std::lower_bound(listeners.begin(), listeners.end(), event.id,
+                               [](const Listener &listener, EventId id) { return listener.eventId < id; });
+    for (; it != listeners.end() && it->eventId == event.id; ++it) {
+        if (it->subscriber != nullptr) {
+            enqueue(*it->subscriber, it->delivery, event);
+            continue;
+        }
+        it->callback(event);
+        if (event.stopPropagation) {
+            break;
+        }
+    }
+    for (auto &rule : rules) {
+        if (rule.eventId == event.id) {
+            forward(rule, event);
+        }
+    }
+}
+
+void PluginManager::coalesce(const char *eventName, EventId coalescedId, unsigned long minInterval, float deadband,
+                             unsigned long maxInterval, EventId key) {
+    CoalesceRule rule{eventName, eventName, coalescedId, key, minInterval, maxInterval, deadband};
+    rules.push_back(rule);
+}
+
+std::vector<EventStreamStats> PluginManager::getStreamStats() const {
+    std::vector<EventStreamStats> stats;
+    stats.reserve(rules.size());
+    for (const auto &rule : rules) {
+        stats.push_back(EventStreamStats{rule.name, rule.raw, rule.delivered});
+    }
+    return stats;
+}
+
+uint32_t PluginManager::getDroppedEvents() const {
+    uint32_t dropped = 0;
+    for (const auto &subscriber : subscribers) {
+        dropped += subscriber.second.dropped;
+    }
+    return dropped;
+}
+
+void PluginManager::insert(std::vector<Listener> &table, Listener listener) {
+    auto it = std::upper_bound(table.begin(), table.end(), listener.eventId,
+                               [](EventId id, const Listener &entry) { return id < entry.eventId; });
+    table.insert(it, std::move(listener));
+}
+
+void PluginManager::forward(CoalesceRule &rule, const Event &event) {
+    rule.raw++;
+    const unsigned long now = millis();
+    const unsigned long elapsed = now - rule.lastDelivery;
+    const float value = event.getFloat(rule.key);
+    if (rule.hasValue && (elapsed < rule.minInterval ||
+                          (std::abs(value - rule.lastValue) < rule.deadband && elapsed < rule.maxInterval))) {
+        return;
+    }
+    rule.hasValue = true;
+    rule.lastValue = value;
+    rule.lastDelivery = now;
+    rule.delivered++;
+    Event coalesced = event;
+    coalesced.id = rule.coalescedId;
+    coalesced.stopPropagation = false;
+    trigger(coalesced);
+}
+
+void PluginManager::enqueue(EventSubscriber &subscriber, EventDelivery delivery, const Event &event) {
+    if (delivery == EventDelivery::COALESCE) {
+        for (auto &slot : subscriber.coalesced) {
+            if (slot.event.id == event.id) {
+                taskENTER_CRITICAL(&subscriber.lock);
+                if (slot.pending) {
+                    subscriber.dropped++;
+                }
+                slot.event = event;
+                slot.pending = true;
+                taskEXIT_CRITICAL(&subscriber.lock);
+                return;
             }
         }
+        return;
+    }
+    if (xQueueSend(subscriber.queue, &event, 0) == pdTRUE) {
+        return;
+    }
+    if (delivery == EventDelivery::DROP_OLDEST) {
+        Event discarded;
+        xQueueReceive(subscriber.queue, &discarded, 0);
+        if (xQueueSend(subscriber.queue, &event, 0) == pdTRUE) {
+            subscriber.dropped++;
+            return;
+        }
+    }
+    subscriber.dropped++;
+}
+
+void PluginManager::dispatch(EventSubscriber &subscriber) {
+    Event event;
+    while (xQueueReceive(subscriber.queue, &event, 0) == pdTRUE) {
+        deliver(subscriber, event);
+    }
+    for (auto &slot : subscriber.coalesced) {
+        taskENTER_CRITICAL(&subscriber.lock);
+        const bool pending = slot.pending;
+        if (pending) {
+            event = slot.event;
+            slot.pending = false;
+        }
+        taskEXIT_CRITICAL(&subscriber.lock);
+        if (pending) {
+            deliver(subscriber, event);
+        }
+    }
+}
+
+void PluginManager::deliver(EventSubscriber &subscriber, Event &event) {
+    event.stopPropagation = false;
+    auto it = std::lower_bound(subscriber.listeners.begin(), subscriber.listeners.end(), event.id,
+                               [](const Listener &listener, EventId id) { return listener.eventId < id; });
+    for (; it != subscriber.listeners.end() && it->eventId == event.id; ++it) {
+        it->callback(event);
+        if (event.stopPropagation) {
+            break;
+        }
     }
 }
@@ -3,13 +3,30 @@
 #include "Event.h"
 #include "Plugin.h"
 
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 #include <functional>
 #include <map>
-#include <string>
 #include <vector>
 
+constexpr size_t EVENT_QUEUE_LENGTH = 8;
+
 using EventCallback = std::function<void(Event &)>;
 
+enum class EventDelivery : uint8_t {
+    SYNC,        // listener runs on the triggering task and can modify the event or stop propagation
+    QUEUED,      // copied into the plugin's queue, the newest event is dropped when it is full
+    DROP_OLDEST, // copied into the plugin's queue, the oldest event is dropped when it is full
+    COALESCE,    // only the latest event is kept until the plugin drains its queue, for high rate topics
+};
+
+struct EventStreamStats {
+    const char *name;
+    uint32_t raw;       // events triggered
+    uint32_t delivered; // events forwarded to the coalesced stream
+};
+
 class Controller;
 class PluginManager {
   public:
@@ -18,18 +35,77 @@ class PluginManager {
     void setup(Controller *controller);
     void loop();
 
-    void on(const String &eventId, const EventCallback &callback);
+    // Event ids also accept event names as strings, see Event.h
+    void on(EventId eventId, const EventCallback &callback);
+    // Delivers the event on the loop task right before plugin->loop(), so slow listeners don't stall the task that
+    // triggered it. Queued listeners see a copy, events whose result is read back by the trigger stay synchronous.
+    void on(Plugin *plugin, EventId eventId, const EventCallback &callback, EventDelivery delivery = EventDelivery::QUEUED);
 
-    Event trigger(const String &eventId);
-    Event trigger(const String &eventId, const String &key, const String &value);
-    Event trigger(const String &eventId, const String &key, int value);
-    Event trigger(const String &eventId, const String &key, float value);
+    Event trigger(EventId eventId);
+    Event trigger(EventId eventId, EventId key, const char *value);
+    Event trigger(EventId eventId, EventId key, int value);
+    Event trigger(EventId eventId, EventId key, float value);
     void trigger(Event &event);
 
+    // Derives a coalesced stream from a raw event. The raw event is forwarded as coalescedId when its value moved by at
+    // least deadband and minInterval ms have passed, or unchanged after maxInterval ms. Listeners subscribe to either id.
+    void coalesce(const char *eventName, EventId coalescedId, unsigned long minInterval, float deadband,
+                  unsigned long maxInterval = 1000, EventId key = EVENT_KEY_VALUE);
+
+    uint32_t getDroppedEvents() const;
+    std::vector<EventStreamStats> getStreamStats() const;
+
   private:
+    struct EventSubscriber;
+
+    struct Listener {
+        EventId eventId;
+        EventCallback callback;
+        EventSubscriber *subscriber = nullptr; // set for queued deliveries, callback is unused then
+        EventDelivery delivery = EventDelivery::SYNC;
+    };
+
+    struct CoalescedEvent {
+        bool pending = false;
+        Event event;
+    };
+
+    struct EventSubscriber {
+        QueueHandle_t queue = nullptr;
+        std::vector<Listener> listeners;
+        std::vector<CoalescedEvent> coalesced; // one slot per coalesced event id, guarded by lock
+        portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+        std::atomic<uint32_t> dropped{0};
+    };
+
+    // Each raw event is expected to be triggered from a single task, so the state needs no lock
+    struct CoalesceRule {
+        EventId eventId;
+        const char *name;
+        EventId coalescedId;
+        EventId key;
+        unsigned long minInterval;
+        unsigned long maxInterval;
+        float deadband;
+        unsigned long lastDelivery = 0;
+        float lastValue = 0.0f;
+        bool hasValue = false;
+        uint32_t raw = 0;
+        uint32_t delivered = 0;
+    };
+
+    static void insert(std::vector<Listener> &table, Listener listener);
+    void forward(CoalesceRule &rule, const Event &event);
+    void enqueue(EventSubscriber &subscriber, EventDelivery delivery, const Event &event);
+    void dispatch(EventSubscriber &subscriber);
+    static void deliver(EventSubscriber &subscriber, Event &event);
+
     bool initialized = false;
     std::vector<Plugin *> plugins;
-    std::map<std::string, std::vector<EventCallback>> listeners = {};
+    // Sorted by event id and in registration order per id. Only changes during setup, triggering never allocates.
+    std::vector<Listener> listeners;
+    std::map<Plugin *, EventSubscriber> subscribers;
+    std::vector<CoalesceRule> rules;
 };
 
 #endif // PLUGINMANAGER_H
@@ -171,7 +171,7 @@ bool ProfileManager::saveProfile(Profile &profile) {
         loadSelectedProfile(selectedProfile);
     }
     selectProfile(_settings.getSelectedProfile());
-    _plugin_manager->trigger("profiles:profile:save", "id", profile.id);
+    _plugin_manager->trigger("profiles:profile:save", "id", profile.id.c_str());
     if (isNew) {
         _settings.addFavoritedProfile(profile.id);
     }
@@ -190,7 +190,7 @@ void ProfileManager::selectProfile(const String &uuid) {
     _settings.setSelectedProfile(uuid);
     selectedProfile = Profile{};
     loadSelectedProfile(selectedProfile);
-    _plugin_manager->trigger("profiles:profile:select", "id", uuid);
+    _plugin_manager->trigger("profiles:profile:select", "id", uuid.c_str());
 }
 
 Profile ProfileManager::getSelectedProfile() const { return selectedProfile; }
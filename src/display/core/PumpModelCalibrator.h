@@ -0,0 +1,291 @@
+#ifndef PUMPMODELCALIBRATOR_H
+#define PUMPMODELCALIBRATOR_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <display/core/constants.h>
+
+// Learns the pump flow polynomial Q(P) = a·P³ + b·P² + c·P + d (ml/s at full power) from shots weighed by a Bluetooth
+// scale, see Controller::updatePumpModelCalibration. The coefficients have the format of the pumpModelCoeffs setting.
+//
+// The controller board reports its modelled pump flow u·Q(P), so the pump power u is recovered by dividing by the
+// polynomial the board currently runs with. Once the shot drips steadily, the samples are cut into blocks of
+// BLOCK_SAMPLES. While the pressure holds, nothing is stored in the headspace and the puck, and the weight slope over a
+// block equals the pump flow: the block means of u·P^i are the regressors of one recursive least squares update.
+//
+// The updates of a shot are kept apart until finishShot, which needs MIN_BLOCKS steady blocks and moves the curve by at
+// most MAX_CHANGE. A shot held at a single pressure only measures the flow at that pressure, the prior carries the
+// correction over to the rest of the curve. The low pressure end is only learned from profiles that drip there.
+class PumpModelCalibrator {
+  public:
+    static constexpr size_t BLOCK_SAMPLES = 20;           // 2 s at PROGRESS_INTERVAL
+    static constexpr unsigned long MAX_SAMPLE_GAP = 300;  // ms, a longer gap starts a new block
+    static constexpr float MIN_WEIGHT = 3.0f;             // g in the cup before blocks count, the puck is saturated by then
+    static constexpr float MAX_PRESSURE_SPREAD = 0.3f;    // bar within a block
+    static constexpr float MIN_POWER = 0.2f;              // mean pump power of a block
+    static constexpr float MIN_MODEL_FLOW = 1.0f;         // ml/s, below that the pump power can't be recovered
+    static constexpr size_t MIN_BLOCKS = 3;               // per shot to update the coefficients
+    static constexpr float MAX_CHANGE = 0.25f;            // of the modelled flow per shot
+    static constexpr float MEASUREMENT_NOISE = 0.04f;     // (ml/s)², of the weight slope of a block
+    static constexpr float OUTLIER_THRESHOLD = 9.0f;      // squared normalized innovation, channeling or a bumped scale
+    static constexpr float DRIFT = 0.05f;                 // of the prior deviation per shot, lets the pump age
+    static constexpr float PRESSURE_NORMALIZATION = 9.0f; // bar, keeps P³ in the range of the other regressors
+    static constexpr float MAX_PRESSURE = 12.0f;          // bar, highest pressure checked by finishShot
+
+    PumpModelCalibrator() { reset(DEFAULT_PUMP_MODEL_COEFFS); }
+
+    // Starts over from coefficients in the format of the pumpModelCoeffs setting: two values are the flow at 1 and 9 bar,
+    // four values the polynomial. Returns false and keeps the current model if they don't parse.
+    bool reset(const char *coefficients) {
+        std::array<float, 4> parsed{};
+        if (!parse(coefficients, parsed)) {
+            return false;
+        }
+        active = parsed;
+        theta = normalize(parsed);
+        for (size_t i = 0; i < 4; i++) {
+            for (size_t j = 0; j < 4; j++) {
+                covariance[i][j] = SCALE_DEVIATION * SCALE_DEVIATION * theta[i] * theta[j];
+            }
+            covariance[i][i] += PRIOR_DEVIATION[i] * PRIOR_DEVIATION[i];
+            priorVariance[i] = covariance[i][i];
+        }
+        running = false;
+        return true;
+    }
+
+    void startShot() {
+        shotTheta = theta;
+        shotCovariance = covariance;
+        for (size_t i = 0; i < 4; i++) {
+            const float drifted = std::min(priorVariance[i], shotCovariance[i][i] + DRIFT * DRIFT * priorVariance[i]);
+            shotCovariance[i][i] = std::max(shotCovariance[i][i], drifted);
+        }
+        block = Block{};
+        blocks = 0;
+        hasOrigin = false;
+        running = true;
+    }
+
+    // time in ms, pressure in bar, pumpFlow the modelled pump flow reported by the controller board in ml/s, weight in g
+    void addSample(unsigned long time, float pressure, float pumpFlow, float weight) {
+        if (!running) {
+            return;
+        }
+        if (!hasOrigin) {
+            originWeight = weight;
+            hasOrigin = true;
+        }
+        const float modelFlow = evaluate(active, pressure);
+        if (block.count > 0 && time - block.lastTime > MAX_SAMPLE_GAP) {
+            block = Block{};
+        }
+        if (weight - originWeight < MIN_WEIGHT || modelFlow < MIN_MODEL_FLOW || pumpFlow <= 0.0f) {
+            block = Block{};
+            return;
+        }
+        if (block.count == 0) {
+            block.startTime = time;
+            block.startWeight = weight;
+            block.minPressure = pressure;
+            block.maxPressure = pressure;
+        }
+        // Relative to the start of the block to keep the sums of squares well conditioned
+        const float t = static_cast<float>(time - block.startTime) / 1000.0f;
+        const float w = weight - block.startWeight;
+        const float x = pressure / PRESSURE_NORMALIZATION;
+        const float power = pumpFlow / modelFlow;
+        block.count++;
+        block.lastTime = time;
+        block.t += t;
+        block.tt += t * t;
+        block.w += w;
+        block.tw += t * w;
+        block.minPressure = std::min(block.minPressure, pressure);
+        block.maxPressure = std::max(block.maxPressure, pressure);
+        block.power += power;
+        block.regressors[0] += power * x * x * x;
+        block.regressors[1] += power * x * x;
+        block.regressors[2] += power * x;
+        block.regressors[3] += power;
+        if (block.count == BLOCK_SAMPLES) {
+            update(block);
+            block = Block{};
+        }
+    }
+
+    // Takes the updates of the shot into the model, true if the coefficients changed. The modelled flow moves by at most
+    // MAX_CHANGE at any pressure up to MAX_PRESSURE.
+    bool finishShot() {
+        if (!running) {
+            return false;
+        }
+        running = false;
+        if (blocks < MIN_BLOCKS) {
+            return false;
+        }
+        // A shot that would move the curve further is only taken in part, its certainty is not
+        const std::array<float, 4> candidate = denormalize(shotTheta);
+        float change = 0.0f;
+        for (float pressure = 0.0f; pressure <= MAX_PRESSURE; pressure += 1.0f) {
+            const float current = evaluate(active, pressure);
+            const float flow = evaluate(candidate, pressure);
+            if (!std::isfinite(flow) || flow <= 0.0f || current <= 0.0f) {
+                return false;
+            }
+            change = std::max(change, std::fabs(flow - current) / current);
+        }
+        const float step = change > MAX_CHANGE ? MAX_CHANGE / change : 1.0f;
+        for (size_t i = 0; i < 4; i++) {
+            theta[i] += step * (shotTheta[i] - theta[i]);
+        }
+        if (step == 1.0f) {
+            covariance = shotCovariance;
+        }
+        active = denormalize(theta);
+        return true;
+    }
+
+    bool isRunning() const { return running; }
+
+    // Steady blocks of the current or last shot
+    size_t getBlocks() const { return blocks; }
+
+    const std::array<float, 4> &getCoefficients() const { return active; }
+
+    // Coefficients in the format of the pumpModelCoeffs setting
+    int format(char *out, size_t size) const {
+        return snprintf(out, size, "%.6g,%.6g,%.6g,%.6g", active[0], active[1], active[2], active[3]);
+    }
+
+  private:
+    using Matrix = std::array<std::array<float, 4>, 4>;
+
+    struct Block {
+        size_t count = 0;
+        unsigned long startTime = 0;
+        unsigned long lastTime = 0;
+        float startWeight = 0.0f;
+        float t = 0.0f;
+        float tt = 0.0f;
+        float w = 0.0f;
+        float tw = 0.0f;
+        float minPressure = 0.0f;
+        float maxPressure = 0.0f;
+        float power = 0.0f;
+        std::array<float, 4> regressors{};
+    };
+
+    // The prior mostly expects the whole curve to be off by a factor, a weaker pump loses flow at all pressures.
+    // Changes of the shape are in the normalized coefficients in ml/s, higher orders are trusted more so they stay smooth.
+    static constexpr float SCALE_DEVIATION = 0.2f;
+    static constexpr std::array<float, 4> PRIOR_DEVIATION = {0.1f, 0.2f, 0.5f, 0.5f};
+
+    void update(const Block &steady) {
+        const auto n = static_cast<float>(steady.count);
+        if (steady.maxPressure - steady.minPressure > MAX_PRESSURE_SPREAD || steady.power / n < MIN_POWER) {
+            return;
+        }
+        const float denominator = n * steady.tt - steady.t * steady.t;
+        if (denominator <= 0.0f) {
+            return;
+        }
+        const float flow = (n * steady.tw - steady.t * steady.w) / denominator;
+        std::array<float, 4> phi{};
+        for (size_t i = 0; i < 4; i++) {
+            phi[i] = steady.regressors[i] / n;
+        }
+
+        std::array<float, 4> gain{}; // covariance · phi
+        float predicted = 0.0f;
+        float variance = MEASUREMENT_NOISE;
+        for (size_t i = 0; i < 4; i++) {
+            for (size_t j = 0; j < 4; j++) {
+                gain[i] += shotCovariance[i][j] * phi[j];
+            }
+            predicted += phi[i] * shotTheta[i];
+            variance += phi[i] * gain[i];
+        }
+        const float innovation = flow - predicted;
+        if (innovation * innovation > OUTLIER_THRESHOLD * variance) {
+            return;
+        }
+        for (size_t i = 0; i < 4; i++) {
+            shotTheta[i] += gain[i] / variance * innovation;
+        }
+        for (size_t i = 0; i < 4; i++) {
+            for (size_t j = i; j < 4; j++) {
+                shotCovariance[i][j] -= gain[i] * gain[j] / variance;
+                shotCovariance[j][i] = shotCovariance[i][j];
+            }
+        }
+        blocks++;
+    }
+
+    static bool parse(const char *coefficients, std::array<float, 4> &out) {
+        float values[4];
+        size_t count = 0;
+        const char *cursor = coefficients;
+        while (count < 4) {
+            char *end = nullptr;
+            values[count] = strtof(cursor, &end);
+            if (end == cursor || !std::isfinite(values[count])) {
+                return false;
+            }
+            count++;
+            while (*end == ' ') {
+                end++;
+            }
+            if (*end != ',') {
+                if (*end != '\0') {
+                    return false;
+                }
+                break;
+            }
+            cursor = end + 1;
+        }
+        if (count == 2) {
+            // Same line through the flows at 1 and 9 bar as PressureController::setPumpFlowCoeff
+            const float slope = (values[1] - values[0]) / 8.0f;
+            out = {0.0f, 0.0f, slope, values[0] - slope};
+            return true;
+        }
+        if (count == 4) {
+            out = {values[0], values[1], values[2], values[3]};
+            return true;
+        }
+        return false;
+    }
+
+    static float evaluate(const std::array<float, 4> &coefficients, float pressure) {
+        return ((coefficients[0] * pressure + coefficients[1]) * pressure + coefficients[2]) * pressure + coefficients[3];
+    }
+
+    static std::array<float, 4> normalize(const std::array<float, 4> &coefficients) {
+        const float s = PRESSURE_NORMALIZATION;
+        return {coefficients[0] * s * s * s, coefficients[1] * s * s, coefficients[2] * s, coefficients[3]};
+    }
+
+    static std::array<float, 4> denormalize(const std::array<float, 4> &normalized) {
+        const float s = PRESSURE_NORMALIZATION;
+        return {normalized[0] / (s * s * s), normalized[1] / (s * s), normalized[2] / s, normalized[3]};
+    }
+
+    std::array<float, 4> active{}; // coefficients the controller board runs with
+    std::array<float, 4> theta{};  // normalized coefficients of the model
+    Matrix covariance{};
+    std::array<float, 4> priorVariance{};
+    std::array<float, 4> shotTheta{}; // model including the updates of the running shot
+    Matrix shotCovariance{};
+    Block block;
+    size_t blocks = 0;
+    float originWeight = 0.0f;
+    bool hasOrigin = false;
+    bool running = false;
+};
+
+#endif // PUMPMODELCALIBRATOR_H
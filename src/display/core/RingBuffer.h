@@ -0,0 +1,46 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Fixed capacity FIFO with preallocated storage.
+// Safe for exactly one producer and one consumer running on different tasks.
+template <typename T, size_t N> class RingBuffer {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+  public:
+    bool push(const T &item) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) >= N) {
+            return false;
+        }
+        _items[head & (N - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = _items[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    void clear() { _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release); }
+
+    size_t size() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return N; }
+
+  private:
+    std::array<T, N> _items{};
+    std::atomic<size_t> _head{0};
+    std::atomic<size_t> _tail{0};
+};
+
+#endif // RINGBUFFER_H
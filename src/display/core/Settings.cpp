@@ -20,6 +20,7 @@ Settings::Settings() {
     pressureScaling = preferences.getFloat("ps", DEFAULT_PRESSURE_SCALING);
     pid = preferences.getString("pid", DEFAULT_PID);
     pumpModelCoeffs = preferences.getString("pmc", DEFAULT_PUMP_MODEL_COEFFS);
+    pumpModelAdjust = preferences.getBool("pmc_ad", true);
     wifiSsid = preferences.getString("ws", "");
     wifiPassword = preferences.getString("wp", "");
     mdnsName = preferences.getString("mn", DEFAULT_MDNS_NAME);
@@ -54,6 +55,9 @@ Settings::Settings() {
     steamPumpPercentage = preferences.getFloat("spp", DEFAULT_STEAM_PUMP_PERCENTAGE);
     steamPumpCutoff = preferences.getFloat("spc", DEFAULT_STEAM_PUMP_CUTOFF);
     historyIndex = preferences.getInt("hi", 0);
+    historyTolerance = preferences.getInt("h_tol", 100);
+    historySampleRate = preferences.getInt("h_rate", 10);
+    controlInterval = preferences.getInt("c_int", DEFAULT_CONTROL_INTERVAL_MS);
 
     // Display settings
     mainBrightness = preferences.getInt("main_b", 16);
@@ -184,6 +188,11 @@ void Settings::setPumpModelCoeffs(const String &pumpModelCoeffs) {
     save();
 }
 
+void Settings::setPumpModelAdjust(bool pump_model_adjust) {
+    pumpModelAdjust = pump_model_adjust;
+    save();
+}
+
 void Settings::setWifiSsid(const String &wifiSsid) {
     this->wifiSsid = wifiSsid;
     save();
@@ -372,6 +381,21 @@ void Settings::setHistoryIndex(int history_index) {
     save();
 }
 
+void Settings::setHistoryTolerance(int history_tolerance) {
+    historyTolerance = history_tolerance;
+    save();
+}
+
+void Settings::setHistorySampleRate(int history_sample_rate) {
+    historySampleRate = history_sample_rate;
+    save();
+}
+
+void Settings::setControlInterval(int control_interval) {
+    controlInterval = control_interval;
+    save();
+}
+
 void Settings::setSunriseR(int sunrise_r) {
     sunriseR = sunrise_r;
     save();
@@ -429,6 +453,7 @@ void Settings::doSave() {
     preferences.putFloat("ps", pressureScaling);
     preferences.putString("pid", pid);
     preferences.putString("pmc", pumpModelCoeffs);
+    preferences.putBool("pmc_ad", pumpModelAdjust);
     preferences.putString("ws", wifiSsid);
     preferences.putString("wp", wifiPassword);
     preferences.putString("mn", mdnsName);
@@ -463,6 +488,9 @@ void Settings::doSave() {
     preferences.putFloat("spp", steamPumpPercentage);
     preferences.putFloat("spc", steamPumpCutoff);
     preferences.putInt("hi", historyIndex);
+    preferences.putInt("h_tol", historyTolerance);
+    preferences.putInt("h_rate", historySampleRate);
+    preferences.putInt("c_int", controlInterval);
 
     // Display settings
     preferences.putInt("main_b", mainBrightness);
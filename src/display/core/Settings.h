@@ -39,6 +39,7 @@ class Settings {
     bool isDelayAdjust() const { return delayAdjust; }
     String getPid() const { return pid; }
     String getPumpModelCoeffs() const { return pumpModelCoeffs; }
+    bool isPumpModelAdjust() const { return pumpModelAdjust; }
     String getWifiSsid() const { return wifiSsid; }
     String getWifiPassword() const { return wifiPassword; }
     String getMdnsName() const { return mdnsName; }
@@ -73,6 +74,9 @@ class Settings {
     float getSteamPumpCutoff() const { return steamPumpCutoff; }
     int getThemeMode() const { return themeMode; }
     int getHistoryIndex() const { return historyIndex; }
+    int getHistoryTolerance() const { return historyTolerance; }
+    int getHistorySampleRate() const { return historySampleRate; }
+    int getControlInterval() const { return controlInterval; }
     int getSunriseR() const { return sunriseR; }
     int getSunriseG() const { return sunriseG; }
     int getSunriseB() const { return sunriseB; }
@@ -99,6 +103,7 @@ class Settings {
     void setDelayAdjust(bool delay_adjust);
     void setPid(const String &pid);
     void setPumpModelCoeffs(const String &pumpModelCoeffs);
+    void setPumpModelAdjust(bool pump_model_adjust);
     void setWifiSsid(const String &wifiSsid);
     void setWifiPassword(const String &wifiPassword);
     void setMdnsName(const String &mdnsName);
@@ -135,6 +140,9 @@ class Settings {
     void setSteamPumpCutoff(float steam_pump_cutoff);
     void setThemeMode(int theme_mode);
     void setHistoryIndex(int history_index);
+    void setHistoryTolerance(int history_tolerance);
+    void setHistorySampleRate(int history_sample_rate);
+    void setControlInterval(int control_interval);
     void setSunriseR(int sunrise_r);
     void setSunriseG(int sunrise_g);
     void setSunriseB(int sunrise_b);
@@ -162,6 +170,7 @@ class Settings {
     int standbyTimeout = DEFAULT_STANDBY_TIMEOUT_MS;
     String pid = DEFAULT_PID;
     String pumpModelCoeffs = DEFAULT_PUMP_MODEL_COEFFS;
+    bool pumpModelAdjust = true;
     String wifiSsid = "";
     String wifiPassword = "";
     String mdnsName = DEFAULT_MDNS_NAME;
@@ -190,6 +199,9 @@ class Settings {
     float steamPumpPercentage = DEFAULT_STEAM_PUMP_PERCENTAGE;
     float steamPumpCutoff = DEFAULT_STEAM_PUMP_CUTOFF;
     int historyIndex = 0;
+    int historyTolerance = 100; // percent of the default shot recording tolerances, 0 keeps every change
+    int historySampleRate = 10; // shot recording rate in Hz
+    int controlInterval = DEFAULT_CONTROL_INTERVAL_MS;
 
     // Deprecated, use profiles
     int targetBrewTemp = 93;
@@ -0,0 +1,283 @@
+#include "ShotIndex.h"
+#include <ArduinoJson.h>
+
+#include <utility>
+
+namespace {
+constexpr size_t SHOT_INDEX_COMPACT_SLACK = 16;
+
+class IndexLock {
+  public:
+    explicit IndexLock(SemaphoreHandle_t mutex) : _mutex(mutex) { xSemaphoreTake(_mutex, portMAX_DELAY); }
+    ~IndexLock() { xSemaphoreGive(_mutex); }
+
+  private:
+    SemaphoreHandle_t _mutex;
+};
+} // namespace
+
+ShotIndex::ShotIndex(fs::FS &fs, String dir) : _fs(fs), _dir(std::move(dir)) {}
+
+void ShotIndex::setup() {
+    if (_mutex == nullptr) {
+        _mutex = xSemaphoreCreateMutex();
+    }
+}
+
+std::vector<ShotIndexEntry> ShotIndex::load() {
+    std::map<uint32_t, ShotIndexEntry> entries;
+    {
+        IndexLock lock(_mutex);
+        size_t records = 0;
+        if (!read(entries, records)) {
+            rebuildLocked(entries);
+        } else if (records > entries.size() * 2 + SHOT_INDEX_COMPACT_SLACK) {
+            // Mostly superseded entries, rewrite the live ones only
+            write(entries);
+        }
+    }
+    std::vector<ShotIndexEntry> result;
+    result.reserve(entries.size());
+    for (const auto &entry : entries) {
+        result.push_back(entry.second);
+    }
+    return result;
+}
+
+bool ShotIndex::find(uint32_t id, ShotIndexEntry &entry) {
+    IndexLock lock(_mutex);
+    std::map<uint32_t, ShotIndexEntry> entries;
+    readOrRebuild(entries);
+    auto it = entries.find(id);
+    if (it == entries.end()) {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+void ShotIndex::put(ShotIndexEntry entry) {
+    IndexLock lock(_mutex);
+    entry.flags &= ~SHOT_INDEX_FLAG_DELETED;
+    append(entry);
+}
+
+void ShotIndex::remove(uint32_t id) {
+    IndexLock lock(_mutex);
+    ShotIndexEntry entry{};
+    entry.id = id;
+    entry.flags = SHOT_INDEX_FLAG_DELETED;
+    append(entry);
+}
+
+void ShotIndex::setNotes(uint32_t id, uint8_t rating) {
+    IndexLock lock(_mutex);
+    std::map<uint32_t, ShotIndexEntry> entries;
+    readOrRebuild(entries);
+    auto it = entries.find(id);
+    if (it == entries.end() || (it->second.rating == rating && it->second.flags & SHOT_INDEX_FLAG_PINNED)) {
+        return;
+    }
+    it->second.rating = rating;
+    it->second.flags |= SHOT_INDEX_FLAG_PINNED;
+    append(it->second);
+}
+
+void ShotIndex::addFlags(uint32_t id, uint8_t flags) {
+    IndexLock lock(_mutex);
+    std::map<uint32_t, ShotIndexEntry> entries;
+    readOrRebuild(entries);
+    auto it = entries.find(id);
+    if (it == entries.end() || (it->second.flags & flags) == flags) {
+        return;
+    }
+    it->second.flags |= flags;
+    append(it->second);
+}
+
+void ShotIndex::rebuild() {
+    IndexLock lock(_mutex);
+    std::map<uint32_t, ShotIndexEntry> entries;
+    rebuildLocked(entries);
+}
+
+bool ShotIndex::read(std::map<uint32_t, ShotIndexEntry> &entries, size_t &records) {
+    File file = _fs.open(indexPath(), "r");
+    if (!file) {
+        return false;
+    }
+    ShotIndexHeader header{};
+    const bool headerValid = file.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) == sizeof(header) &&
+                             header.magic == SHOT_INDEX_MAGIC && header.version == SHOT_INDEX_VERSION &&
+                             header.entrySize == sizeof(ShotIndexEntry);
+    if (!headerValid) {
+        file.close();
+        return false;
+    }
+    ShotIndexEntry entry{};
+    size_t read;
+    bool valid = true;
+    records = 0;
+    while ((read = file.read(reinterpret_cast<uint8_t *>(&entry), sizeof(entry))) == sizeof(entry)) {
+        if (entry.crc != shotIndexCrc(entry)) {
+            valid = false;
+            break;
+        }
+        records++;
+        if (entry.flags & SHOT_INDEX_FLAG_DELETED) {
+            entries.erase(entry.id);
+        } else {
+            entries[entry.id] = entry;
+        }
+    }
+    file.close();
+    // A partial trailing entry means a write was torn
+    return valid && read == 0;
+}
+
+void ShotIndex::readOrRebuild(std::map<uint32_t, ShotIndexEntry> &entries) {
+    size_t records = 0;
+    if (!read(entries, records)) {
+        rebuildLocked(entries);
+    }
+}
+
+bool ShotIndex::append(ShotIndexEntry &entry) {
+    if (!_fs.exists(indexPath())) {
+        // Starting a fresh index here would hide all older shots, rebuild it from the shot files instead
+        std::map<uint32_t, ShotIndexEntry> entries;
+        rebuildLocked(entries);
+        return true;
+    }
+    entry.crc = shotIndexCrc(entry);
+    File file = _fs.open(indexPath(), FILE_APPEND);
+    if (!file) {
+        return false;
+    }
+    const bool result = file.write(reinterpret_cast<const uint8_t *>(&entry), sizeof(entry)) == sizeof(entry);
+    file.close();
+    return result;
+}
+
+void ShotIndex::write(const std::map<uint32_t, ShotIndexEntry> &entries) {
+    const String tmpPath = _dir + "/index.tmp";
+    File file = _fs.open(tmpPath, FILE_WRITE);
+    if (!file) {
+        return;
+    }
+    ShotIndexHeader header{SHOT_INDEX_MAGIC, SHOT_INDEX_VERSION, sizeof(ShotIndexEntry)};
+    file.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+    for (const auto &it : entries) {
+        ShotIndexEntry entry = it.second;
+        entry.crc = shotIndexCrc(entry);
+        file.write(reinterpret_cast<const uint8_t *>(&entry), sizeof(entry));
+    }
+    file.close();
+    _fs.remove(indexPath());
+    _fs.rename(tmpPath, indexPath());
+}
+
+void ShotIndex::rebuildLocked(std::map<uint32_t, ShotIndexEntry> &entries) {
+    ESP_LOGI("ShotIndex", "Rebuilding shot index");
+    entries.clear();
+    if (!_fs.exists(_dir)) {
+        _fs.mkdir(_dir);
+    }
+    File root = _fs.open(_dir);
+    String name = root.getNextFileName();
+    while (name != "") {
+        if (name.endsWith(".dat")) {
+            ShotIndexEntry entry{};
+            entry.id = name.substring(name.lastIndexOf('/') + 1, name.lastIndexOf('.')).toInt();
+            if (summarize(name, entry)) {
+                if (readNotes(entry.id, entry.rating)) {
+                    entry.flags |= SHOT_INDEX_FLAG_PINNED;
+                }
+                entries[entry.id] = entry;
+            }
+        }
+        name = root.getNextFileName();
+    }
+    root.close();
+    write(entries);
+}
+
+bool ShotIndex::summarize(const String &path, ShotIndexEntry &entry) {
+    File file = _fs.open(path, "r");
+    if (!file) {
+        return false;
+    }
+    ShotLogHeader header{};
+    if (file.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) != sizeof(header) || header.magic != SHOT_LOG_MAGIC) {
+        const bool result = summarizeLegacy(file, entry);
+        file.close();
+        return result;
+    }
+    entry.timestamp = header.timestamp;
+    strncpy(entry.profileName, header.profileName, sizeof(entry.profileName) - 1);
+    if (header.sampleInterval >= SHOT_LOG_DOWNSAMPLED_INTERVAL) {
+        entry.flags |= SHOT_INDEX_FLAG_DOWNSAMPLED;
+    }
+
+    ShotStats stats;
+    ShotLogBlockHeader block{};
+    ShotLogRecord records[SHOT_LOG_BLOCK_RECORDS];
+    file.seek(header.headerSize);
+    while (file.read(reinterpret_cast<uint8_t *>(&block), sizeof(block)) == sizeof(block)) {
+        const size_t length = block.count * sizeof(ShotLogRecord);
+        if (block.count == 0 || block.count > SHOT_LOG_BLOCK_RECORDS ||
+            file.read(reinterpret_cast<uint8_t *>(records), length) != length ||
+            shotLogCrc16(reinterpret_cast<const uint8_t *>(records), length) != block.crc) {
+            break;
+        }
+        for (uint16_t i = 0; i < block.count; i++) {
+            const ShotLogRecord &record = records[i];
+            stats.add(record.t * header.timeUnit, shotLogDequantize(record.values[SHOT_LOG_CT], header.scales[SHOT_LOG_CT]),
+                      shotLogDequantize(record.values[SHOT_LOG_CP], header.scales[SHOT_LOG_CP]),
+                      shotLogDequantize(record.values[SHOT_LOG_V], header.scales[SHOT_LOG_V]),
+                      shotLogDequantize(record.values[SHOT_LOG_EV], header.scales[SHOT_LOG_EV]));
+        }
+    }
+    file.close();
+    stats.apply(entry);
+    return true;
+}
+
+bool ShotIndex::summarizeLegacy(File &file, ShotIndexEntry &entry) {
+    // CSV files from older firmware: "1,<profile>,<timestamp>" followed by one line per sample
+    file.seek(0);
+    const String headerLine = file.readStringUntil('\n');
+    const int first = headerLine.indexOf(',');
+    const int last = headerLine.lastIndexOf(',');
+    if (first < 0 || last <= first) {
+        return false;
+    }
+    strncpy(entry.profileName, headerLine.substring(first + 1, last).c_str(), sizeof(entry.profileName) - 1);
+    entry.timestamp = headerLine.substring(last + 1).toInt();
+
+    ShotStats stats;
+    while (file.available()) {
+        const String line = file.readStringUntil('\n');
+        unsigned long t;
+        float values[SHOT_LOG_CHANNELS];
+        if (sscanf(line.c_str(), "%lu,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f", &t, &values[0], &values[1], &values[2], &values[3],
+                   &values[4], &values[5], &values[6], &values[7], &values[8], &values[9], &values[10]) < 11) {
+            continue;
+        }
+        stats.add(t, values[SHOT_LOG_CT], values[SHOT_LOG_CP], values[SHOT_LOG_V], values[SHOT_LOG_EV]);
+    }
+    stats.apply(entry);
+    return true;
+}
+
+bool ShotIndex::readNotes(uint32_t id, uint8_t &rating) {
+    File file = _fs.open(shotPath(id, ".json"), "r");
+    if (!file) {
+        return false;
+    }
+    JsonDocument notes;
+    deserializeJson(notes, file);
+    file.close();
+    rating = notes["rating"] | 0;
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef SHOTINDEX_H
+#define SHOTINDEX_H
+
+#include <FS.h>
+#include <display/models/shot_index.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <map>
+#include <vector>
+
+// Persistent summary of all recorded shots in <dir>/index.bin.
+// Listing history only needs a single sequential read of this file instead of opening every shot.
+class ShotIndex {
+  public:
+    ShotIndex(fs::FS &fs, String dir);
+
+    void setup();
+
+    // Live entries in ascending id order. Rebuilds the index when it is missing or corrupt.
+    std::vector<ShotIndexEntry> load();
+    bool find(uint32_t id, ShotIndexEntry &entry);
+    void put(ShotIndexEntry entry);
+    void remove(uint32_t id);
+    void setNotes(uint32_t id, uint8_t rating);
+    // Sets flags on the current entry, so updates made since the caller loaded the index are kept
+    void addFlags(uint32_t id, uint8_t flags);
+    void rebuild();
+
+  private:
+    bool read(std::map<uint32_t, ShotIndexEntry> &entries, size_t &records);
+    void readOrRebuild(std::map<uint32_t, ShotIndexEntry> &entries);
+    bool append(ShotIndexEntry &entry);
+    void write(const std::map<uint32_t, ShotIndexEntry> &entries);
+    void rebuildLocked(std::map<uint32_t, ShotIndexEntry> &entries);
+    bool summarize(const String &path, ShotIndexEntry &entry);
+    bool summarizeLegacy(File &file, ShotIndexEntry &entry);
+    bool readNotes(uint32_t id, uint8_t &rating);
+
+    String indexPath() const { return _dir + "/index.bin"; }
+    String shotPath(uint32_t id, const char *extension) const { return _dir + "/" + shotIdToString(id) + extension; }
+
+    fs::FS &_fs;
+    String _dir;
+    SemaphoreHandle_t _mutex = nullptr;
+};
+
+#endif // SHOTINDEX_H
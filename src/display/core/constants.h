@@ -32,6 +32,15 @@
 #define MODE_WATER 3
 #define MODE_GRIND 4
 
+#define SENSOR_EVENT_MIN_INTERVAL_MS 100
+#define SENSOR_EVENT_MAX_INTERVAL_MS 1000
+#define SENSOR_SAMPLE_QUEUE_SIZE 64 // about 2s of controller samples at 30ms
+#define PROFILE_STATUS_QUEUE_SIZE 8
+
+#define DEFAULT_CONTROL_INTERVAL_MS 250 // control updates without a triggering event
+#define MIN_CONTROL_INTERVAL_MS 50
+#define MAX_CONTROL_INTERVAL_MS 1000
+
 #define WIFI_CONNECT_TIMEOUT_MS 30000
 #define DEFAULT_WIFI_AP_TIMEOUT_MS 600000
 
@@ -2,63 +2,120 @@
 #define PREDICTIVE_H
 
 #include <Arduino.h>
+#include <array>
+#include <cstddef>
 
+// Least squares slope of the volume over the last windowDuration ms.
+//
+// The samples of the window are kept in a fixed ring together with their running sums, which are updated as samples
+// enter and leave. Adding a measurement and reading the rate take constant time and nothing is allocated during a
+// shot. Times are stored relative to the first measurement so the sums of squares stay well conditioned.
 class VolumetricRateCalculator {
   public:
+    static constexpr size_t CAPACITY = 64; // 6.4 s of scale readings at 10 Hz, older samples leave the window early
+
     explicit VolumetricRateCalculator(double window_duration) : windowDuration(window_duration) {}
 
-    void addMeasurement(double volume) {
-        measurements.emplace_back(volume);
-        measurementTimes.emplace_back(millis());
+    void addMeasurement(double volume) { addMeasurement(volume, millis()); }
+
+    void addMeasurement(double volume, double time) {
+        if (!hasOrigin) {
+            origin = time;
+            hasOrigin = true;
+        }
+        const Sample sample{time - origin, volume};
+        if (count == CAPACITY) {
+            removeOldest();
+        }
+        samples[(first + count) % CAPACITY] = sample;
+        count++;
+        sums.add(sample);
+        while (samples[first].time <= sample.time - windowDuration) {
+            removeOldest();
+        }
     }
 
+    // Volume per millisecond over the window ending at time, 0 if it is not rising
     double getRate(double time = 0) const {
         if (time == 0) {
             time = millis();
         }
-        // perform a linear fit through the last PREDICTIVE_TIME (ms) of data time & measurement data and return the slope
-        if (measurements.size() < 2)
+        if (count < 2) {
             return 0.0;
-
-        size_t i = measurementTimes.size();
-        double cutoff = time - windowDuration;
-        while (measurementTimes[i - 1] > cutoff) { // check from the most recent time
-            i--;
         }
-        // i is the index of the first entry after the cutoff
-
-        if (measurements.size() - i < 2)
+        // Samples that left the window since the last measurement, usually none or one
+        const double cutoff = time - origin - windowDuration;
+        Sums window = sums;
+        size_t n = count;
+        for (size_t i = first; n > 0 && samples[i].time <= cutoff; i = (i + 1) % CAPACITY) {
+            window.remove(samples[i]);
+            n--;
+        }
+        if (n < 2) {
             return 0.0;
-
-        double v_mean = 0.0;
-        double t_mean = 0.0;
-        for (size_t j = i; j < measurements.size(); j++) {
-            v_mean += measurements[j];
-            t_mean += measurementTimes[j];
         }
-        v_mean = v_mean / (measurements.size() - i);
-        t_mean = t_mean / (measurements.size() - i);
-
-        double tdev2 = 0.0;
-        double tdev_vdev = 0.0;
-        for (size_t j = i; j < measurements.size(); j++) {
-            tdev_vdev += (measurementTimes[i] - t_mean) * (measurements[i] - v_mean);
-            tdev2 += pow(measurementTimes[i] - t_mean, 2.0);
+        const double denominator = n * window.tt - window.t * window.t;
+        if (denominator <= 0.0) {
+            return 0.0;
         }
-        double volumePerMilliSecond = tdev_vdev / tdev2;              // the slope (volume per millisecond) of the linear best fit
-        return volumePerMilliSecond > 0 ? volumePerMilliSecond : 0.0; // return 0 if it is not positive, convert to seconds
+        const double volumePerMilliSecond = (n * window.tv - window.t * window.v) / denominator;
+        return volumePerMilliSecond > 0 ? volumePerMilliSecond : 0.0;
     }
 
-    double getOvershootAdjustMillis(double expectedVolume, double actualVolume) {
-        if (measurementTimes.size() < 2)
+    double getOvershootAdjustMillis(double expectedVolume, double actualVolume) const {
+        if (count < 2) {
             return 0.0;
-        double overshoot = actualVolume - expectedVolume;
-        return overshoot / getRate(measurementTimes.back());
+        }
+        const double rate = getRate(samples[(first + count - 1) % CAPACITY].time + origin);
+        if (rate <= 0.0) {
+            return 0.0;
+        }
+        const double overshoot = actualVolume - expectedVolume;
+        return overshoot / rate;
     }
 
   private:
-    std::vector<double> measurements;
-    std::vector<double> measurementTimes;
+    struct Sample {
+        double time; // ms since the first measurement
+        double volume;
+    };
+
+    struct Sums {
+        double t = 0.0;
+        double v = 0.0;
+        double tt = 0.0;
+        double tv = 0.0;
+
+        void add(const Sample &sample) {
+            t += sample.time;
+            v += sample.volume;
+            tt += sample.time * sample.time;
+            tv += sample.time * sample.volume;
+        }
+
+        void remove(const Sample &sample) {
+            t -= sample.time;
+            v -= sample.volume;
+            tt -= sample.time * sample.time;
+            tv -= sample.time * sample.volume;
+        }
+    };
+
+    void removeOldest() {
+        sums.remove(samples[first]);
+        first = (first + 1) % CAPACITY;
+        count--;
+        if (count == 0) {
+            sums = Sums{}; // drop the rounding error accumulated by the updates
+        }
+    }
+
+    std::array<Sample, CAPACITY> samples{};
+    size_t first = 0;
+    size_t count = 0;
+    Sums sums;
+    double origin = 0.0;
+    bool hasOrigin = false;
     const double windowDuration;
 };
 
@@ -2,6 +2,7 @@
 #define BREWPROCESS_H
 
 #include <algorithm>
+#include <atomic>
 #include <display/core/constants.h>
 #include <display/core/predictive.h>
 #include <display/core/process/Process.h>
@@ -25,6 +26,13 @@ class BrewProcess : public Process {
     float waterPumped = 0.0f;
     VolumetricRateCalculator volumetricRateCalculator{PREDICTIVE_TIME};
 
+    // Set while the controller board runs the phases, see applyRemoteStatus. Cleared by the control task if the
+    // profile could not be started remotely, and by the main loop when the board reconnects during the brew.
+    std::atomic<bool> remote{false};
+    bool remoteStarted = false;            // control task only
+    bool remoteRunning = false;            // the board reported this brew running, main loop only
+    std::atomic<int> requestedAdvance{-1}; // phase whose volumetric or safety target was reached locally
+
     explicit BrewProcess(Profile profile, ProcessTarget target, double brewDelay = 0.0)
         : profile(profile), target(target), brewDelay(brewDelay) {
         currentPhase = profile.phases.at(phaseIndex);
@@ -54,15 +62,45 @@ class BrewProcess : public Process {
         if (millis() - currentPhaseStarted > BREW_SAFETY_DURATION_MS) {
             return true;
         }
-        double volume = currentVolume;
-        if (volume > 0.0) {
-            double currentRate = volumetricRateCalculator.getRate();
-            const double predictedAddedVolume = currentRate * brewDelay;
-            volume = currentVolume + predictedAddedVolume;
-        }
         float timeInPhase = static_cast<float>(millis() - currentPhaseStarted) / 1000.0f;
-        return currentPhase.isFinished(target == ProcessTarget::VOLUMETRIC, volume, timeInPhase, currentFlow, currentPressure,
-                                       waterPumped, profile.type);
+        return currentPhase.isFinished(target == ProcessTarget::VOLUMETRIC, getPredictedVolume(), timeInPhase, currentFlow,
+                                       currentPressure, waterPumped, profile.type);
+    }
+
+    // The controller board evaluates all other targets of a remote phase
+    bool isRemotePhaseFinished() {
+        if (target != ProcessTarget::VOLUMETRIC) {
+            return false;
+        }
+        const double volume = getPredictedVolume();
+        for (const auto &phaseTarget : currentPhase.targets) {
+            if (phaseTarget.type == TargetType::TARGET_TYPE_VOLUMETRIC && phaseTarget.isReached(volume)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Follows the phase changes reported by the controller board
+    void applyRemoteStatus(unsigned int index, bool completed) {
+        remoteRunning = true;
+        while (processPhase == ProcessPhase::RUNNING && phaseIndex < index && phaseIndex + 1 < profile.phases.size()) {
+            finishCurrentPhase();
+        }
+        if (completed && processPhase == ProcessPhase::RUNNING) {
+            previousPhaseFinished = millis();
+            processPhase = ProcessPhase::FINISHED;
+            finished = millis();
+        }
+    }
+
+    // The controller board stopped the profile on its own, e.g. on a ping timeout or a thermal shutdown
+    void abortRemote() {
+        if (processPhase == ProcessPhase::RUNNING) {
+            previousPhaseFinished = millis();
+            processPhase = ProcessPhase::FINISHED;
+            finished = millis();
+        }
     }
 
     double getBrewVolume() const {
@@ -120,6 +158,9 @@ class BrewProcess : public Process {
         return startVal + (endVal - startVal) * a;
     }
 
+    // True while the pump targets ramp from the previous phase towards the targets of the current phase
+    bool isInTransition() const { return isAdvancedPump() && transitionAlpha() < 1.0f; }
+
     float getTemperature() const {
         if (currentPhase.temperature > 0.0f) {
             return currentPhase.temperature;
@@ -130,21 +171,21 @@ class BrewProcess : public Process {
     void progress() override {
         // Progress should be called around every 100ms, as defined in PROGRESS_INTERVAL, while the Process is active
         waterPumped += currentFlow / 10.0f; // Add current flow divided to 100ms to water pumped counter
-        while (isCurrentPhaseFinished() && processPhase == ProcessPhase::RUNNING) {
-            previousPhaseFinished = millis();
-            if (phaseIndex + 1 < profile.phases.size()) {
-                waterPumped = 0.0f;
-                phaseIndex++;
-                Phase nextPhase = profile.phases.at(phaseIndex);
-                phaseStartPressure = nextPhase.transition.adaptive ? currentPressure : getPumpPressure();
-                phaseStartFlow = nextPhase.transition.adaptive ? currentFlow : getPumpFlow();
-                currentPhase = nextPhase;
-                currentPhaseStarted = millis();
-                computeEffectiveTargetsForCurrentPhase();
-            } else {
-                processPhase = ProcessPhase::FINISHED;
-                finished = millis();
+        if (remote) {
+            if (processPhase != ProcessPhase::RUNNING) {
+                return;
+            }
+            if (millis() - currentPhaseStarted > BREW_SAFETY_DURATION_MS) {
+                // Enforced here as well, the status of the board can get lost while the link is down
+                requestedAdvance = static_cast<int>(phaseIndex);
+                finishCurrentPhase();
+            } else if (isRemotePhaseFinished()) {
+                requestedAdvance = static_cast<int>(phaseIndex);
             }
+            return;
+        }
+        while (isCurrentPhaseFinished() && processPhase == ProcessPhase::RUNNING) {
+            finishCurrentPhase();
         }
     }
 
@@ -160,6 +201,33 @@ class BrewProcess : public Process {
     int getType() override { return MODE_BREW; }
 
   private:
+    double getPredictedVolume() const {
+        double volume = currentVolume;
+        if (volume > 0.0) {
+            double currentRate = volumetricRateCalculator.getRate();
+            const double predictedAddedVolume = currentRate * brewDelay;
+            volume = currentVolume + predictedAddedVolume;
+        }
+        return volume;
+    }
+
+    void finishCurrentPhase() {
+        previousPhaseFinished = millis();
+        if (phaseIndex + 1 < profile.phases.size()) {
+            waterPumped = 0.0f;
+            phaseIndex++;
+            Phase nextPhase = profile.phases.at(phaseIndex);
+            phaseStartPressure = nextPhase.transition.adaptive ? currentPressure : getPumpPressure();
+            phaseStartFlow = nextPhase.transition.adaptive ? currentFlow : getPumpFlow();
+            currentPhase = nextPhase;
+            currentPhaseStarted = millis();
+            computeEffectiveTargetsForCurrentPhase();
+        } else {
+            processPhase = ProcessPhase::FINISHED;
+            finished = millis();
+        }
+    }
+
     float phaseStartPressure = 0.0f;
     float phaseStartFlow = 0.0f;
 
@@ -0,0 +1,99 @@
+#ifndef SHOT_INDEX_H
+#define SHOT_INDEX_H
+
+#include <Arduino.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <display/models/shot_log.h>
+
+// Shot history index file layout. All fields are little-endian.
+//
+//   ShotIndexHeader        once per file
+//   ShotIndexEntry         appended for every change, the last entry for an id wins
+//
+// Deleting a shot appends an entry with SHOT_INDEX_FLAG_DELETED set. The file is compacted when
+// superseded entries make up most of it.
+
+constexpr uint32_t SHOT_INDEX_MAGIC = 0x58494D47; // "GMIX"
+constexpr uint16_t SHOT_INDEX_VERSION = 1;
+constexpr size_t SHOT_INDEX_PROFILE_ID_LENGTH = 40;
+
+constexpr uint8_t SHOT_INDEX_FLAG_DELETED = 1 << 0;
+constexpr uint8_t SHOT_INDEX_FLAG_PINNED = 1 << 1;      // shot has notes and is never removed by retention
+constexpr uint8_t SHOT_INDEX_FLAG_DOWNSAMPLED = 1 << 2; // samples were thinned out to save space
+
+struct __attribute__((packed)) ShotIndexHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entrySize;
+};
+
+struct __attribute__((packed)) ShotIndexEntry {
+    uint32_t id;
+    uint32_t timestamp;      // unix time of the shot start
+    uint32_t duration;       // ms
+    float volume;            // final weight in g, scale weight if available, estimate otherwise
+    float peakPressure;      // bar
+    float avgTemperature;    // °C
+    uint8_t rating;          // 0-5 from the shot notes
+    uint8_t flags;
+    char profileId[SHOT_INDEX_PROFILE_ID_LENGTH];
+    char profileName[SHOT_LOG_PROFILE_NAME_LENGTH];
+    uint16_t crc;            // CRC-16/CCITT-FALSE over all preceding fields
+};
+
+static_assert(sizeof(ShotIndexHeader) == 8, "ShotIndexHeader layout changed");
+static_assert(sizeof(ShotIndexEntry) == 100, "ShotIndexEntry layout changed");
+
+inline uint16_t shotIndexCrc(const ShotIndexEntry &entry) {
+    return shotLogCrc16(reinterpret_cast<const uint8_t *>(&entry), offsetof(ShotIndexEntry, crc));
+}
+
+inline String shotIdToString(uint32_t id) {
+    String result(id);
+    while (result.length() < 6) {
+        result = "0" + result;
+    }
+    return result;
+}
+
+// Accumulates index statistics from samples, used while recording and when rebuilding the index. The temperature is
+// averaged over time, so the evenly spaced samples of a recording and the irregular breakpoints of a stored shot agree.
+struct ShotStats {
+    uint32_t duration = 0;
+    float volume = 0.0f;
+    float estimatedVolume = 0.0f;
+    float peakPressure = 0.0f;
+    float temperatureIntegral = 0.0f; // °C·ms, trapezoids between samples
+    float lastTemperature = 0.0f;
+    uint32_t startTime = 0;
+    uint32_t samples = 0;
+
+    void add(uint32_t t, float temperature, float pressure, float weight, float estimatedWeight) {
+        if (samples == 0) {
+            startTime = t;
+        } else if (t > duration) {
+            temperatureIntegral += (lastTemperature + temperature) * 0.5f * static_cast<float>(t - duration);
+        }
+        duration = t;
+        volume = weight;
+        estimatedVolume = estimatedWeight;
+        peakPressure = std::max(peakPressure, pressure);
+        lastTemperature = temperature;
+        samples++;
+    }
+
+    void apply(ShotIndexEntry &entry) const {
+        entry.duration = duration;
+        entry.volume = volume > 0.0f ? volume : estimatedVolume;
+        entry.peakPressure = peakPressure;
+        if (duration > startTime) {
+            entry.avgTemperature = temperatureIntegral / static_cast<float>(duration - startTime);
+        } else {
+            entry.avgTemperature = samples > 0 ? lastTemperature : 0.0f;
+        }
+    }
+};
+
+#endif // SHOT_INDEX_H
@@ -0,0 +1,243 @@
+#ifndef SHOT_LOG_H
+#define SHOT_LOG_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Binary shot history file layout. All fields are little-endian.
+//
+//   ShotLogHeader                                  once per file
+//   ShotLogBlockHeader + ShotLogRecord[count]      repeated, count <= SHOT_LOG_BLOCK_RECORDS
+//
+// A full block fits into a single 256 byte SPIFFS page. The CRC of a block covers its records only,
+// so a torn write at the end of a file only invalidates the last block.
+// Channel values are stored as int16 and divided by the per-file scale from the header when decoding.
+// Records are breakpoints of a piecewise linear signal (see ShotLogEncoder), so their spacing is irregular
+// and values in between are reconstructed by linear interpolation.
+//
+// This header has no Arduino dependencies so it can be used by host tools, see scripts/bench.
+
+constexpr uint32_t SHOT_LOG_MAGIC = 0x48534D47; // "GMSH"
+constexpr uint16_t SHOT_LOG_VERSION = 3;
+constexpr size_t SHOT_LOG_CHANNELS = 11;
+constexpr size_t SHOT_LOG_BLOCK_RECORDS = 10;
+constexpr size_t SHOT_LOG_PROFILE_NAME_LENGTH = 32;
+constexpr uint16_t SHOT_LOG_TIME_UNIT_MS = 10;
+constexpr uint16_t SHOT_LOG_DOWNSAMPLED_INTERVAL = 1000; // sampling interval of shots thinned out by retention
+
+// Channel order matches the legacy CSV columns: tt, ct, tp, cp, fl, tf, pf, vf, v, ev, pr
+enum ShotLogChannel : uint8_t {
+    SHOT_LOG_TT = 0,
+    SHOT_LOG_CT,
+    SHOT_LOG_TP,
+    SHOT_LOG_CP,
+    SHOT_LOG_FL,
+    SHOT_LOG_TF,
+    SHOT_LOG_PF,
+    SHOT_LOG_VF,
+    SHOT_LOG_V,
+    SHOT_LOG_EV,
+    SHOT_LOG_PR,
+};
+
+constexpr uint16_t SHOT_LOG_DEFAULT_SCALES[SHOT_LOG_CHANNELS] = {10, 10, 100, 100, 100, 100, 100, 100, 10, 10, 100};
+// Swinging door tolerance per channel in quantized units: 0.1 °C, 0.2 °C, 0.05 bar, 0.05 bar, 0.05 ml/s (x4), 0.1 g,
+// 0.1 g, 0.05 resistance. Breakpoints are rounded to whole units when they are stored, so the reconstruction is off by
+// up to the tolerance plus half a unit, e.g. 0.055 bar. A tolerance of 0 stores every sample that differs from the
+// interpolation.
+constexpr uint16_t SHOT_LOG_DEFAULT_TOLERANCES[SHOT_LOG_CHANNELS] = {1, 2, 5, 5, 5, 5, 5, 5, 1, 1, 5};
+
+struct __attribute__((packed)) ShotLogHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint16_t sampleInterval; // nominal sampling interval in ms
+    uint16_t timeUnit;       // ms per tick of ShotLogRecord::t
+    uint32_t timestamp;      // unix time of the shot start
+    uint16_t channelCount;
+    uint16_t scales[SHOT_LOG_CHANNELS];
+    char profileName[SHOT_LOG_PROFILE_NAME_LENGTH];
+};
+
+struct __attribute__((packed)) ShotLogBlockHeader {
+    uint16_t count;
+    uint16_t crc;
+};
+
+struct __attribute__((packed)) ShotLogRecord {
+    uint16_t t;
+    int16_t values[SHOT_LOG_CHANNELS];
+};
+
+constexpr size_t SHOT_LOG_BLOCK_SIZE = sizeof(ShotLogBlockHeader) + SHOT_LOG_BLOCK_RECORDS * sizeof(ShotLogRecord);
+
+static_assert(sizeof(ShotLogHeader) == 72, "ShotLogHeader layout changed");
+static_assert(sizeof(ShotLogRecord) == 24, "ShotLogRecord layout changed");
+static_assert(SHOT_LOG_BLOCK_SIZE <= 256, "A shot log block must fit into one SPIFFS page");
+
+// CRC-16/CCITT-FALSE
+inline uint16_t shotLogCrc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+inline int16_t shotLogQuantize(float value, uint16_t scale) {
+    if (std::isnan(value)) {
+        return 0;
+    }
+    const float scaled = std::round(value * static_cast<float>(scale));
+    return static_cast<int16_t>(std::clamp(scaled, -32768.0f, 32767.0f));
+}
+
+inline float shotLogDequantize(int16_t value, uint16_t scale) { return static_cast<float>(value) / static_cast<float>(scale); }
+
+inline uint16_t shotLogTicks(unsigned long elapsedMs, uint16_t timeUnit) {
+    return static_cast<uint16_t>(std::min<unsigned long>(elapsedMs / timeUnit, UINT16_MAX));
+}
+
+inline void initShotLogHeader(ShotLogHeader &header, const char *profileName, uint32_t timestamp, uint16_t sampleInterval) {
+    memset(&header, 0, sizeof(header));
+    header.magic = SHOT_LOG_MAGIC;
+    header.version = SHOT_LOG_VERSION;
+    header.headerSize = sizeof(ShotLogHeader);
+    header.sampleInterval = sampleInterval;
+    header.timeUnit = SHOT_LOG_TIME_UNIT_MS;
+    header.timestamp = timestamp;
+    header.channelCount = SHOT_LOG_CHANNELS;
+    memcpy(header.scales, SHOT_LOG_DEFAULT_SCALES, sizeof(header.scales));
+    strncpy(header.profileName, profileName, SHOT_LOG_PROFILE_NAME_LENGTH - 1);
+}
+
+// Decodes a binary shot log. Reading stops at the first torn or corrupt block, the records before it are kept.
+inline bool readShotLog(const uint8_t *data, size_t length, ShotLogHeader &header, std::vector<ShotLogRecord> &records) {
+    if (length < sizeof(ShotLogHeader)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(ShotLogHeader));
+    if (header.magic != SHOT_LOG_MAGIC || header.headerSize < sizeof(ShotLogHeader) || header.timeUnit == 0) {
+        return false;
+    }
+    size_t offset = header.headerSize;
+    while (offset + sizeof(ShotLogBlockHeader) <= length) {
+        ShotLogBlockHeader block{};
+        memcpy(&block, data + offset, sizeof(block));
+        offset += sizeof(block);
+        const size_t blockLength = block.count * sizeof(ShotLogRecord);
+        if (block.count == 0 || block.count > SHOT_LOG_BLOCK_RECORDS || offset + blockLength > length ||
+            shotLogCrc16(data + offset, blockLength) != block.crc) {
+            break;
+        }
+        for (size_t i = 0; i < block.count; i++) {
+            ShotLogRecord record{};
+            memcpy(&record, data + offset + i * sizeof(record), sizeof(record));
+            records.push_back(record);
+        }
+        offset += blockLength;
+    }
+    return !records.empty();
+}
+
+// Swinging door compression over all channels at once. A record is only kept when the straight line from the last
+// kept record can no longer represent every skipped sample within each channel's tolerance. All channels share their
+// breakpoints so records stay complete and readers need no changes, a flat or linearly changing shot collapses to
+// a handful of records.
+class ShotLogEncoder {
+  public:
+    void reset(const uint16_t tolerances[SHOT_LOG_CHANNELS] = SHOT_LOG_DEFAULT_TOLERANCES) {
+        memcpy(_tolerances, tolerances, sizeof(_tolerances));
+        _hasAnchor = false;
+        _hasPending = false;
+    }
+
+    // Feeds the next sample. Returns true and fills out when a breakpoint has to be stored.
+    bool push(const ShotLogRecord &record, ShotLogRecord &out) {
+        if (!_hasAnchor) {
+            _anchor = record;
+            _hasAnchor = true;
+            out = record;
+            return true;
+        }
+        if (record.t <= _anchor.t) {
+            return false;
+        }
+        float low[SHOT_LOG_CHANNELS];
+        float high[SHOT_LOG_CHANNELS];
+        if (_hasPending && narrow(record, low, high)) {
+            memcpy(_low, low, sizeof(_low));
+            memcpy(_high, high, sizeof(_high));
+            _pending = record;
+            return false;
+        }
+        bool emitted = false;
+        if (_hasPending) {
+            // The pending sample ends the current segment. Place it on the segment so every skipped sample stays within
+            // tolerance, its own value moves by at most the tolerance as well.
+            placePending(out);
+            emitted = true;
+        }
+        startSegment(record);
+        return emitted;
+    }
+
+    // Returns the last sample so the end of the shot is stored at its exact time
+    bool finish(ShotLogRecord &out) {
+        if (!_hasPending) {
+            return false;
+        }
+        placePending(out);
+        _hasPending = false;
+        return true;
+    }
+
+  private:
+    void placePending(ShotLogRecord &out) {
+        out = _pending;
+        const float dt = static_cast<float>(_pending.t - _anchor.t);
+        for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+            const float slope = (static_cast<float>(_pending.values[i]) - _anchor.values[i]) / dt;
+            const float value = _anchor.values[i] + std::clamp(slope, _low[i], _high[i]) * dt;
+            out.values[i] = static_cast<int16_t>(std::clamp(std::round(value), -32768.0f, 32767.0f));
+        }
+        _anchor = out;
+    }
+
+    void startSegment(const ShotLogRecord &record) {
+        const float dt = static_cast<float>(record.t - _anchor.t);
+        for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+            _low[i] = (static_cast<float>(record.values[i]) - _tolerances[i] - _anchor.values[i]) / dt;
+            _high[i] = (static_cast<float>(record.values[i]) + _tolerances[i] - _anchor.values[i]) / dt;
+        }
+        _pending = record;
+        _hasPending = true;
+    }
+
+    bool narrow(const ShotLogRecord &record, float low[SHOT_LOG_CHANNELS], float high[SHOT_LOG_CHANNELS]) const {
+        const float dt = static_cast<float>(record.t - _anchor.t);
+        for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+            low[i] = std::max(_low[i], (static_cast<float>(record.values[i]) - _tolerances[i] - _anchor.values[i]) / dt);
+            high[i] = std::min(_high[i], (static_cast<float>(record.values[i]) + _tolerances[i] - _anchor.values[i]) / dt);
+            if (low[i] > high[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint16_t _tolerances[SHOT_LOG_CHANNELS] = {};
+    ShotLogRecord _anchor{};
+    ShotLogRecord _pending{};
+    float _low[SHOT_LOG_CHANNELS] = {};
+    float _high[SHOT_LOG_CHANNELS] = {};
+    bool _hasAnchor = false;
+    bool _hasPending = false;
+};
+
+#endif // SHOT_LOG_H
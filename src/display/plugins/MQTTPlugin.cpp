@@ -118,32 +118,18 @@ void MQTTPlugin::publishBrewState(const char *state) {
 }
 
 void MQTTPlugin::setup(Controller *controller, PluginManager *pluginManager) {
-    pluginManager->on("controller:wifi:connect", [this, controller](const Event &) {
+    // Publishing blocks on the network, so events are delivered through the plugin queue instead of the triggering task
+    pluginManager->on(this, "controller:wifi:connect", [this, controller](const Event &) {
         if (!connect(controller))
             return;
         publishDiscovery(controller);
     });
 
-    pluginManager->on("boiler:currentTemperature:change", [this](Event const &event) {
-        if (!client.connected())
-            return;
-        char json[50];
-        const float temp = event.getFloat("value");
-        if (temp != lastTemperature) {
-            snprintf(json, sizeof(json), R"***({"temperature":%02f})***", temp);
-            publish("boilers/0/temperature", json);
-        }
-        lastTemperature = temp;
-    });
-    pluginManager->on("boiler:targetTemperature:change", [this](Event const &event) {
-        if (!client.connected())
-            return;
-        char json[50];
-        const float temp = event.getFloat("value");
-        snprintf(json, sizeof(json), R"***({"temperature":%02f})***", temp);
-        publish("boilers/0/targetTemperature", json);
-    });
-    pluginManager->on("controller:mode:change", [this](Event const &event) {
+    pluginManager->on(this, EVENT_BOILER_CURRENT_TEMPERATURE_CHANGE, [this](Event const &event) { publishTemperature(event); },
+                      EventDelivery::COALESCE);
+    pluginManager->on(this, "boiler:targetTemperature:change", [this](Event const &event) { publishTargetTemperature(event); },
+                      EventDelivery::COALESCE);
+    pluginManager->on(this, "controller:mode:change", [this](Event const &event) {
         int newMode = event.getInt("value");
         const char *modeStr;
         switch (newMode) {
@@ -170,7 +156,28 @@ void MQTTPlugin::setup(Controller *controller, PluginManager *pluginManager) {
         snprintf(json, sizeof(json), R"({"mode":%d,"mode_str":"%s"})", newMode, modeStr);
         publish("controller/mode", json);
     });
-    pluginManager->on("controller:brew:start", [this](Event const &) { publishBrewState("brewing"); });
+    pluginManager->on(this, "controller:brew:start", [this](Event const &) { publishBrewState("brewing"); });
+
+    pluginManager->on(this, "controller:brew:end", [this](Event const &) { publishBrewState("not brewing"); });
+}
 
-    pluginManager->on("controller:brew:end", [this](Event const &) { publishBrewState("not brewing"); });
+void MQTTPlugin::publishTemperature(Event const &event) {
+    if (!client.connected())
+        return;
+    char json[50];
+    const float temp = event.getFloat(EVENT_KEY_VALUE);
+    if (temp != lastTemperature) {
+        snprintf(json, sizeof(json), R"***({"temperature":%02f})***", temp);
+        publish("boilers/0/temperature", json);
+    }
+    lastTemperature = temp;
+}
+
+void MQTTPlugin::publishTargetTemperature(Event const &event) {
+    if (!client.connected())
+        return;
+    char json[50];
+    const float temp = event.getFloat(EVENT_KEY_VALUE);
+    snprintf(json, sizeof(json), R"***({"temperature":%02f})***", temp);
+    publish("boilers/0/targetTemperature", json);
 }
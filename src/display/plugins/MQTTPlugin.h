@@ -7,6 +7,8 @@
 constexpr int MQTT_CONNECTION_RETRIES = 5;
 constexpr int MQTT_CONNECTION_DELAY = 1000;
 
+struct Event;
+
 class MQTTPlugin : public Plugin {
   public:
     void setup(Controller *controller, PluginManager *pluginManager) override;
@@ -18,6 +20,8 @@ class MQTTPlugin : public Plugin {
   private:
     void publish(const std::string &topic, const std::string &message);
     void publishBrewState(const char *state);
+    void publishTemperature(Event const &event);
+    void publishTargetTemperature(Event const &event);
     void publishDiscovery(Controller *controller);
     MQTTClient client;
     WiFiClient net;
@@ -5,17 +5,21 @@
 #include <display/core/ProfileManager.h>
 #include <display/core/utils.h>
 
+#include <algorithm>
+#include <functional>
+
 ShotHistoryPlugin ShotHistory;
 
 void ShotHistoryPlugin::setup(Controller *c, PluginManager *pm) {
     controller = c;
     pluginManager = pm;
+    shotIndex.setup();
     pm->on("controller:brew:start", [this](Event const &) { startRecording(); });
     pm->on("controller:brew:end", [this](Event const &) { endRecording(); });
-    pm->on("controller:volumetric-measurement:estimation:change",
-           [this](Event const &event) { currentEstimatedWeight = event.getFloat("value"); });
-    pm->on("controller:volumetric-measurement:bluetooth:change", [this](Event const &event) {
-        const float weight = event.getFloat("value");
+    pm->on(EVENT_VOLUMETRIC_ESTIMATION_CHANGE,
+           [this](Event const &event) { currentEstimatedWeight = event.getFloat(EVENT_KEY_VALUE); });
+    pm->on(EVENT_VOLUMETRIC_BLUETOOTH_CHANGE, [this](Event const &event) {
+        const float weight = event.getFloat(EVENT_KEY_VALUE);
         const unsigned long now = millis();
         if (lastVolumeSample != 0) {
             const unsigned long timeDiff = now - lastVolumeSample;
@@ -26,57 +30,153 @@ void ShotHistoryPlugin::setup(Controller *c, PluginManager *pm) {
         lastVolumeSample = now;
         currentBluetoothWeight = weight;
     });
-    pm->on("boiler:currentTemperature:change", [this](Event const &event) { currentTemperature = event.getFloat("value"); });
-    pm->on("pump:puck-resistance:change", [this](Event const &event) { currentPuckResistance = event.getFloat("value"); });
-    xTaskCreatePinnedToCore(loopTask, "ShotHistoryPlugin::loop", configMINIMAL_STACK_SIZE * 3, this, 1, &taskHandle, 0);
+    pm->on(EVENT_BOILER_CURRENT_TEMPERATURE_CHANGE,
+           [this](Event const &event) { currentTemperature = event.getFloat(EVENT_KEY_VALUE); });
+    pm->on(EVENT_PUMP_PUCK_RESISTANCE_CHANGE,
+           [this](Event const &event) { currentPuckResistance = event.getFloat(EVENT_KEY_VALUE); });
+    // Sampling runs above the flash writer so slow SPIFFS writes cannot delay the next sample
+    xTaskCreatePinnedToCore(samplerTask, "ShotHistoryPlugin::sample", configMINIMAL_STACK_SIZE * 3, this, 2, &samplerHandle, 0);
+    xTaskCreatePinnedToCore(writerTask, "ShotHistoryPlugin::write", SHOT_HISTORY_WRITER_STACK_SIZE, this, 1, &writerHandle, 0);
 }
 
-void ShotHistoryPlugin::record() {
-    static File file;
-    if (recording && controller->getMode() == MODE_BREW) {
-        if (!isFileOpen) {
-            if (!SPIFFS.exists("/h")) {
-                SPIFFS.mkdir("/h");
-            }
-            file = SPIFFS.open("/h/" + currentId + ".dat", FILE_APPEND);
-            if (file) {
-                isFileOpen = true;
+void ShotHistoryPlugin::sample() {
+    SensorSample sensor{};
+    if (!recording || controller->getMode() != MODE_BREW) {
+        // Only samples taken during the shot are recorded
+        while (controller->popSensorSample(sensor)) {
+        }
+        return;
+    }
+    if (controller->hasSensorSampleStream()) {
+        // Every sample of the controller board is recorded at its own timestamp, targets and weights are the latest
+        while (controller->popSensorSample(sensor)) {
+            if (static_cast<long>(sensor.timestamp - shotStart) < 0) {
+                continue;
             }
+            queueSample(ShotSample{sensor.timestamp - shotStart, controller->getTargetTemp(), sensor.temperature,
+                                   controller->getTargetPressure(), sensor.pressure, sensor.pumpFlow,
+                                   controller->getTargetFlow(), sensor.puckFlow, currentBluetoothFlow, currentBluetoothWeight,
+                                   currentEstimatedWeight, sensor.puckResistance});
         }
-        if (!headerWritten) {
-            file.printf("1,%s,%ld\n", currentProfileName.c_str(), getTime());
-            headerWritten = true;
+        return;
+    }
+    queueSample(ShotSample{millis() - shotStart, controller->getTargetTemp(), currentTemperature, controller->getTargetPressure(),
+                           controller->getCurrentPressure(), controller->getCurrentPumpFlow(), controller->getTargetFlow(),
+                           controller->getCurrentPuckFlow(), currentBluetoothFlow, currentBluetoothWeight,
+                           currentEstimatedWeight, currentPuckResistance});
+}
+
+void ShotHistoryPlugin::queueSample(const ShotSample &s) {
+    sampleCount++;
+    if (!sampleQueue.push(s.quantize())) {
+        droppedSamples++;
+    }
+    const uint32_t queued = sampleQueue.size();
+    if (queued > peakQueue) {
+        peakQueue = queued;
+    }
+}
+
+void ShotHistoryPlugin::record() {
+    if (recording && !isFileOpen) {
+        if (!SPIFFS.exists("/h")) {
+            SPIFFS.mkdir("/h");
+        }
+        file = SPIFFS.open("/h/" + currentId + ".dat", FILE_WRITE);
+        if (file) {
+            isFileOpen = true;
+            initShotLogHeader(header, currentProfileName.c_str(), getTime(), logInterval);
+            file.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+            currentEntry = ShotIndexEntry{};
+            currentEntry.id = currentId.toInt();
+            currentEntry.timestamp = header.timestamp;
+            strncpy(currentEntry.profileId, currentProfileId.c_str(), sizeof(currentEntry.profileId) - 1);
+            strncpy(currentEntry.profileName, currentProfileName.c_str(), sizeof(currentEntry.profileName) - 1);
+            currentStats = ShotStats{};
+            blockCount = 0;
+            uint16_t tolerances[SHOT_LOG_CHANNELS];
+            const int tolerancePercent = std::max(0, controller->getSettings().getHistoryTolerance());
+            for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+                tolerances[i] = SHOT_LOG_DEFAULT_TOLERANCES[i] * tolerancePercent / 100;
+            }
+            encoder.reset(tolerances);
         }
-        ShotSample s{millis() - shotStart,
-                     controller->getTargetTemp(),
-                     currentTemperature,
-                     controller->getTargetPressure(),
-                     controller->getCurrentPressure(),
-                     controller->getCurrentPumpFlow(),
-                     controller->getTargetFlow(),
-                     controller->getCurrentPuckFlow(),
-                     currentBluetoothFlow,
-                     currentBluetoothWeight,
-                     currentEstimatedWeight,
-                     currentPuckResistance};
+    }
+    // Drain everything the sampler queued since the last run, samples without an open file are discarded
+    ShotLogRecord s{};
+    while (sampleQueue.pop(s)) {
         if (isFileOpen) {
-            file.println(s.serialize().c_str());
+            encode(s);
         }
     }
     if (!recording && isFileOpen) {
-        file.close();
-        isFileOpen = false;
-        unsigned long duration = millis() - shotStart;
-        if (duration <= 7500) { // Exclude failed shots and flushes
-            SPIFFS.remove("/h/" + currentId + ".dat");
-            SPIFFS.remove("/h/" + currentId + ".json"); // Also remove notes file if it exists
-        } else {
-            controller->getSettings().setHistoryIndex(controller->getSettings().getHistoryIndex() + 1);
-            cleanupHistory();
-        }
+        finishShot();
     }
 }
 
+void ShotHistoryPlugin::encode(const ShotLogRecord &sample) {
+    currentStats.add(sample.t * header.timeUnit, shotLogDequantize(sample.values[SHOT_LOG_CT], header.scales[SHOT_LOG_CT]),
+                     shotLogDequantize(sample.values[SHOT_LOG_CP], header.scales[SHOT_LOG_CP]),
+                     shotLogDequantize(sample.values[SHOT_LOG_V], header.scales[SHOT_LOG_V]),
+                     shotLogDequantize(sample.values[SHOT_LOG_EV], header.scales[SHOT_LOG_EV]));
+    ShotLogRecord record{};
+    if (encoder.push(sample, record)) {
+        appendRecord(record);
+    }
+}
+
+void ShotHistoryPlugin::appendRecord(const ShotLogRecord &record) {
+    // Collect whole blocks so SPIFFS sees whole pages
+    blockRecords[blockCount++] = record;
+    if (blockCount == SHOT_LOG_BLOCK_RECORDS) {
+        writeBlock(file, blockRecords, blockCount);
+        blockCount = 0;
+    }
+}
+
+void ShotHistoryPlugin::finishShot() {
+    ShotLogRecord record{};
+    if (encoder.finish(record)) {
+        appendRecord(record);
+    }
+    writeBlock(file, blockRecords, blockCount);
+    blockCount = 0;
+    file.close();
+    isFileOpen = false;
+    const String path = "/h/" + shotIdToString(currentEntry.id);
+    if (currentStats.duration <= 7500) { // Exclude failed shots and flushes
+        SPIFFS.remove(path + ".dat");
+        SPIFFS.remove(path + ".json"); // Also remove notes file if it exists
+        return;
+    }
+    currentStats.apply(currentEntry);
+    shotIndex.put(currentEntry);
+    controller->getSettings().setHistoryIndex(controller->getSettings().getHistoryIndex() + 1);
+    const ShotRecorderStats stats = getRecorderStats();
+    ESP_LOGI("ShotHistoryPlugin", "Recorded shot %s: %u samples, %u dropped, %u late, peak queue %u", path.c_str(),
+             static_cast<unsigned>(stats.samples), static_cast<unsigned>(stats.dropped), static_cast<unsigned>(stats.late),
+             static_cast<unsigned>(stats.peakQueue));
+    cleanupHistory();
+}
+
+ShotRecorderStats ShotHistoryPlugin::getRecorderStats() const {
+    return ShotRecorderStats{sampleCount.load(), droppedSamples.load(), lateSamples.load(), peakQueue.load()};
+}
+
+// Returns false if the block was not written completely
+bool ShotHistoryPlugin::writeBlock(File &target, const ShotLogRecord *records, uint16_t count) {
+    if (count == 0) {
+        return true;
+    }
+    // Assembled in one buffer and written with a single call
+    auto *block = reinterpret_cast<ShotLogBlockHeader *>(blockBuffer);
+    const size_t recordBytes = count * sizeof(ShotLogRecord);
+    memcpy(blockBuffer + sizeof(ShotLogBlockHeader), records, recordBytes);
+    block->count = count;
+    block->crc = shotLogCrc16(reinterpret_cast<const uint8_t *>(records), recordBytes);
+    return target.write(blockBuffer, sizeof(ShotLogBlockHeader) + recordBytes) == sizeof(ShotLogBlockHeader) + recordBytes;
+}
+
 void ShotHistoryPlugin::startRecording() {
     currentId = controller->getSettings().getHistoryIndex();
     while (currentId.length() < 6) {
@@ -87,9 +187,18 @@ void ShotHistoryPlugin::startRecording() {
     currentBluetoothWeight = 0.0f;
     currentEstimatedWeight = 0.0f;
     currentBluetoothFlow = 0.0f;
-    currentProfileName = controller->getProfileManager()->getSelectedProfile().label;
+    const Profile profile = controller->getProfileManager()->getSelectedProfile();
+    currentProfileName = profile.label;
+    currentProfileId = profile.id;
+    const int rate = std::clamp(controller->getSettings().getHistorySampleRate(), SHOT_HISTORY_MIN_SAMPLE_RATE,
+                                SHOT_HISTORY_MAX_SAMPLE_RATE);
+    sampleInterval = 1000 / rate;
+    logInterval = controller->hasSensorSampleStream() ? SHOT_HISTORY_STREAM_INTERVAL : sampleInterval;
+    sampleCount = 0;
+    droppedSamples = 0;
+    lateSamples = 0;
+    peakQueue = 0;
     recording = true;
-    headerWritten = false;
 }
 
 unsigned long ShotHistoryPlugin::getTime() {
@@ -101,20 +210,133 @@ unsigned long ShotHistoryPlugin::getTime() {
 void ShotHistoryPlugin::endRecording() { recording = false; }
 
 void ShotHistoryPlugin::cleanupHistory() {
-    File directory = SPIFFS.open("/h");
-    std::vector<String> entries;
-    String filename = directory.getNextFileName();
-    while (filename != "") {
-        entries.push_back(filename);
-        filename = directory.getNextFileName();
-    }
-    sort(entries.begin(), entries.end(), [](String a, String b) { return a < b; });
-    if (entries.size() > MAX_HISTORY_ENTRIES) {
-        for (unsigned int i = 0; i < entries.size() - MAX_HISTORY_ENTRIES; i++) {
-            String name = entries[i];
-            SPIFFS.remove(name);
+    // Bounded amount of work per call, the loop task continues while idle if the budget is still exceeded
+    lastCleanup = millis();
+    std::vector<ShotIndexEntry> entries = shotIndex.load();
+    for (size_t step = 0; step < SHOT_HISTORY_CLEANUP_STEPS; step++) {
+        const bool overCount = entries.size() > MAX_HISTORY_ENTRIES;
+        if (!overCount && hasHistorySpace()) {
+            cleanupPending = false;
+            return;
+        }
+
+        // Short on space: thin out older shots first, the newest ones keep their full resolution
+        if (!overCount && entries.size() > SHOT_HISTORY_FULL_RESOLUTION_ENTRIES) {
+            const auto last = entries.end() - SHOT_HISTORY_FULL_RESOLUTION_ENTRIES;
+            auto it = std::find_if(entries.begin(), last,
+                                   [](const ShotIndexEntry &entry) { return !(entry.flags & SHOT_INDEX_FLAG_DOWNSAMPLED); });
+            if (it != last) {
+                downsampleShot(*it);
+                continue;
+            }
+        }
+
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [](const ShotIndexEntry &entry) { return !(entry.flags & SHOT_INDEX_FLAG_PINNED); });
+        if (it == entries.end()) {
+            ESP_LOGW("ShotHistoryPlugin", "History budget exceeded but all shots are pinned");
+            cleanupPending = false;
+            return;
+        }
+        removeShot(it->id);
+        entries.erase(it);
+    }
+    cleanupPending = true;
+}
+
+bool ShotHistoryPlugin::hasHistorySpace() {
+    const size_t total = SPIFFS.totalBytes();
+    return total - SPIFFS.usedBytes() >= static_cast<size_t>(static_cast<float>(total) * SHOT_HISTORY_MIN_FREE_RATIO);
+}
+
+void ShotHistoryPlugin::downsampleShot(ShotIndexEntry &entry) {
+    const String path = "/h/" + shotIdToString(entry.id);
+    // Flagged up front, a shot that can't be thinned out (legacy CSV, no room for the copy) is kept as it is and not
+    // picked again by every cleanup. Only the flag is set so a rating saved in the meantime is not overwritten.
+    entry.flags |= SHOT_INDEX_FLAG_DOWNSAMPLED;
+    shotIndex.addFlags(entry.id, SHOT_INDEX_FLAG_DOWNSAMPLED);
+
+    File source = SPIFFS.open(path + ".dat", "r");
+    ShotLogHeader sourceHeader{};
+    if (!source || source.read(reinterpret_cast<uint8_t *>(&sourceHeader), sizeof(sourceHeader)) != sizeof(sourceHeader) ||
+        sourceHeader.magic != SHOT_LOG_MAGIC || sourceHeader.sampleInterval == 0) {
+        source.close();
+        return;
+    }
+    File target = SPIFFS.open(path + ".tmp", FILE_WRITE);
+    if (!target) {
+        ESP_LOGW("ShotHistoryPlugin", "Could not create %s.tmp, keeping shot as recorded", path.c_str());
+        source.close();
+        return;
+    }
+    ShotLogHeader targetHeader = sourceHeader;
+    targetHeader.headerSize = sizeof(ShotLogHeader);
+    targetHeader.sampleInterval = SHOT_LOG_DOWNSAMPLED_INTERVAL;
+    bool written = target.write(reinterpret_cast<const uint8_t *>(&targetHeader), sizeof(targetHeader)) == sizeof(targetHeader);
+    size_t expectedSize = sizeof(targetHeader);
+
+    // Records are breakpoints with irregular spacing, so thin them out by time rather than by count
+    const uint16_t spacing = SHOT_LOG_DOWNSAMPLED_INTERVAL / std::max<uint16_t>(1, sourceHeader.timeUnit);
+    ShotLogBlockHeader block{};
+    ShotLogRecord records[SHOT_LOG_BLOCK_RECORDS];
+    ShotLogRecord output[SHOT_LOG_BLOCK_RECORDS];
+    ShotLogRecord last{};
+    ShotLogRecord kept{};
+    uint16_t outputCount = 0;
+    size_t index = 0;
+    bool lastKept = true;
+    source.seek(sourceHeader.headerSize);
+    while (source.read(reinterpret_cast<uint8_t *>(&block), sizeof(block)) == sizeof(block)) {
+        const size_t length = block.count * sizeof(ShotLogRecord);
+        if (block.count == 0 || block.count > SHOT_LOG_BLOCK_RECORDS ||
+            source.read(reinterpret_cast<uint8_t *>(records), length) != length ||
+            shotLogCrc16(reinterpret_cast<const uint8_t *>(records), length) != block.crc) {
+            break;
         }
+        for (uint16_t i = 0; i < block.count; i++, index++) {
+            last = records[i];
+            lastKept = index == 0 || last.t - kept.t >= spacing;
+            if (lastKept) {
+                kept = last;
+                output[outputCount++] = last;
+            }
+            if (outputCount == SHOT_LOG_BLOCK_RECORDS) {
+                written = written && writeBlock(target, output, outputCount);
+                expectedSize += sizeof(ShotLogBlockHeader) + outputCount * sizeof(ShotLogRecord);
+                outputCount = 0;
+            }
+        }
+    }
+    // Always keep the final sample so duration and weight stay intact
+    if (!lastKept && index > 0) {
+        output[outputCount++] = last;
+    }
+    if (outputCount > 0) {
+        written = written && writeBlock(target, output, outputCount);
+        expectedSize += sizeof(ShotLogBlockHeader) + outputCount * sizeof(ShotLogRecord);
+    }
+    source.close();
+    target.close();
+
+    // The original is only replaced by a complete copy, a full file system leaves it untouched
+    File copy = SPIFFS.open(path + ".tmp", "r");
+    written = written && copy && copy.size() == expectedSize;
+    copy.close();
+    if (!written) {
+        ESP_LOGW("ShotHistoryPlugin", "Could not write %s.tmp, keeping shot as recorded", path.c_str());
+        SPIFFS.remove(path + ".tmp");
+        return;
     }
+    SPIFFS.remove(path + ".dat");
+    SPIFFS.rename(path + ".tmp", path + ".dat");
+    ESP_LOGI("ShotHistoryPlugin", "Downsampled shot %s to %dms", shotIdToString(entry.id).c_str(), SHOT_LOG_DOWNSAMPLED_INTERVAL);
+}
+
+void ShotHistoryPlugin::removeShot(uint32_t id) {
+    const String path = "/h/" + shotIdToString(id);
+    SPIFFS.remove(path + ".dat");
+    SPIFFS.remove(path + ".json"); // Also remove notes file if it exists
+    shotIndex.remove(id);
 }
 
 void ShotHistoryPlugin::handleRequest(JsonDocument &request, JsonDocument &response) {
@@ -123,38 +345,12 @@ void ShotHistoryPlugin::handleRequest(JsonDocument &request, JsonDocument &respo
     response["rid"] = request["rid"].as<String>();
 
     if (type == "req:history:list") {
-        JsonArray arr = response["history"].to<JsonArray>();
-        File root = SPIFFS.open("/h");
-        if (root && root.isDirectory()) {
-            File file = root.openNextFile();
-            while (file) {
-                if (String(file.name()).endsWith(".dat")) {
-                    auto o = arr.add<JsonObject>();
-                    auto name = String(file.name());
-                    int start = name.lastIndexOf('/') + 1;
-                    int end = name.lastIndexOf('.');
-                    String id = name.substring(start, end);
-                    o["id"] = id;
-                    o["history"] = file.readString();
-                    
-                    // Also include notes if they exist
-                    JsonDocument notes;
-                    loadNotes(id, notes);
-                    if (!notes.isNull() && notes.size() > 0) {
-                        o["notes"] = notes;
-                    }
-                }
-                file = root.openNextFile();
-            }
-        }
+        listHistory(request, response);
     } else if (type == "req:history:get") {
         auto id = request["id"].as<String>();
-        File file = SPIFFS.open("/h/" + id + ".dat", "r");
-        if (file) {
-            String data = file.readString();
-            response["history"] = data;
-            file.close();
-            
+        if (SPIFFS.exists("/h/" + id + ".dat")) {
+            response["id"] = id;
+
             // Also include notes if they exist
             JsonDocument notes;
             loadNotes(id, notes);
@@ -165,9 +361,7 @@ void ShotHistoryPlugin::handleRequest(JsonDocument &request, JsonDocument &respo
             response["error"] = "not found";
         }
     } else if (type == "req:history:delete") {
-        auto id = request["id"].as<String>();
-        SPIFFS.remove("/h/" + id + ".dat");
-        SPIFFS.remove("/h/" + id + ".json"); // Also remove notes file if it exists
+        removeShot(request["id"].as<String>().toInt());
         response["msg"] = "Ok";
     } else if (type == "req:history:notes:get") {
         auto id = request["id"].as<String>();
@@ -179,6 +373,7 @@ void ShotHistoryPlugin::handleRequest(JsonDocument &request, JsonDocument &respo
         const JsonDocument& notesDoc = request["notes"];
         
         saveNotes(id, notesDoc);
+        shotIndex.setNotes(id.toInt(), notesDoc["rating"] | 0);
 
     } 
 }
@@ -202,10 +397,88 @@ void ShotHistoryPlugin::loadNotes(const String &id, JsonDocument &notes) {
     }
 }
 
-void ShotHistoryPlugin::loopTask(void *arg) {
+File ShotHistoryPlugin::openHistory(const String &id) { return SPIFFS.open("/h/" + id + ".dat", "r"); }
+
+void ShotHistoryPlugin::listHistory(JsonDocument &request, JsonDocument &response) {
+    // Answered from the index alone. Sample data is streamed separately by the web server.
+    std::vector<ShotIndexEntry> entries = shotIndex.load();
+
+    const String profile = request["profile"] | "";
+    const uint8_t minRating = request["minRating"] | 0;
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&](const ShotIndexEntry &entry) {
+                                     return entry.rating < minRating || (profile != "" && profile != entry.profileId &&
+                                                                          profile != entry.profileName);
+                                 }),
+                  entries.end());
+
+    const String sort = request["sort"] | "id";
+    const bool ascending = request["order"] == "asc";
+    std::function<float(const ShotIndexEntry &)> key = [](const ShotIndexEntry &entry) { return static_cast<float>(entry.id); };
+    if (sort == "timestamp") {
+        key = [](const ShotIndexEntry &entry) { return static_cast<float>(entry.timestamp); };
+    } else if (sort == "duration") {
+        key = [](const ShotIndexEntry &entry) { return static_cast<float>(entry.duration); };
+    } else if (sort == "volume") {
+        key = [](const ShotIndexEntry &entry) { return entry.volume; };
+    } else if (sort == "peakPressure") {
+        key = [](const ShotIndexEntry &entry) { return entry.peakPressure; };
+    } else if (sort == "rating") {
+        key = [](const ShotIndexEntry &entry) { return static_cast<float>(entry.rating); };
+    }
+    std::stable_sort(entries.begin(), entries.end(), [&](const ShotIndexEntry &a, const ShotIndexEntry &b) {
+        return ascending ? key(a) < key(b) : key(a) > key(b);
+    });
+
+    const size_t offset = request["offset"] | 0;
+    const size_t limit = request["limit"] | SHOT_HISTORY_PAGE_SIZE;
+    response["total"] = entries.size();
+    JsonArray arr = response["history"].to<JsonArray>();
+    for (size_t i = offset; i < entries.size() && i < offset + limit; i++) {
+        const ShotIndexEntry &entry = entries[i];
+        auto o = arr.add<JsonObject>();
+        o["id"] = shotIdToString(entry.id);
+        o["profile"] = entry.profileName;
+        o["profileId"] = entry.profileId;
+        o["timestamp"] = entry.timestamp;
+        o["duration"] = entry.duration;
+        o["volume"] = entry.volume;
+        o["peakPressure"] = entry.peakPressure;
+        o["avgTemperature"] = entry.avgTemperature;
+        o["rating"] = entry.rating;
+    }
+}
+
+void ShotHistoryPlugin::samplerTask(void *arg) {
+    auto *plugin = static_cast<ShotHistoryPlugin *>(arg);
+    TickType_t lastWake = xTaskGetTickCount();
+    while (true) {
+        plugin->sample();
+        // Fixed rate independent of how long sampling took, a missed deadline means the sample came late
+        if (xTaskDelayUntil(&lastWake, pdMS_TO_TICKS(plugin->sampleInterval)) == pdFALSE && plugin->recording) {
+            plugin->lateSamples++;
+        }
+    }
+}
+
+void ShotHistoryPlugin::writerTask(void *arg) {
     auto *plugin = static_cast<ShotHistoryPlugin *>(arg);
+    UBaseType_t headroom = SHOT_HISTORY_WRITER_STACK_SIZE;
     while (true) {
         plugin->record();
-        vTaskDelay(250 / portTICK_PERIOD_MS);
+        if (!plugin->recording && plugin->cleanupPending && millis() - plugin->lastCleanup > SHOT_HISTORY_CLEANUP_INTERVAL) {
+            plugin->cleanupHistory();
+        }
+        // Index rebuilds and downsampling are the deepest paths, report every new low
+        const UBaseType_t watermark = uxTaskGetStackHighWaterMark(nullptr);
+        if (watermark < headroom) {
+            headroom = watermark;
+            if (headroom < SHOT_HISTORY_MIN_STACK_HEADROOM) {
+                ESP_LOGW("ShotHistoryPlugin", "Writer stack headroom down to %u bytes", static_cast<unsigned>(headroom));
+            } else {
+                ESP_LOGD("ShotHistoryPlugin", "Writer stack headroom %u bytes", static_cast<unsigned>(headroom));
+            }
+        }
+        vTaskDelay(SHOT_HISTORY_WRITE_INTERVAL / portTICK_PERIOD_MS);
     }
 }
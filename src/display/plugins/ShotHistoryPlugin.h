@@ -4,10 +4,36 @@
 #include <ArduinoJson.h>
 #include <SPIFFS.h>
 #include <display/core/Plugin.h>
+#include <display/core/RingBuffer.h>
+#include <display/core/ShotIndex.h>
 #include <display/core/utils.h>
+#include <display/models/shot_log.h>
+#include <atomic>
+#include <vector>
 
 constexpr size_t SHOT_HISTORY_INTERVAL = 100;
-constexpr size_t MAX_HISTORY_ENTRIES = 3;
+constexpr int SHOT_HISTORY_MIN_SAMPLE_RATE = 4;  // Hz
+constexpr int SHOT_HISTORY_MAX_SAMPLE_RATE = 20; // Hz
+constexpr uint16_t SHOT_HISTORY_STREAM_INTERVAL = 30; // ms between samples streamed by the controller board
+constexpr unsigned long SHOT_HISTORY_WRITE_INTERVAL = 500;
+constexpr size_t SHOT_HISTORY_QUEUE_SIZE = 128; // samples buffered between sampler and writer, 6.4s at 20 Hz
+constexpr size_t SHOT_HISTORY_PAGE_SIZE = 10;
+constexpr size_t MAX_HISTORY_ENTRIES = 100;
+constexpr size_t SHOT_HISTORY_FULL_RESOLUTION_ENTRIES = 10; // newest shots that are never downsampled
+constexpr float SHOT_HISTORY_MIN_FREE_RATIO = 0.15f;        // share of SPIFFS that history leaves free
+constexpr size_t SHOT_HISTORY_CLEANUP_STEPS = 2;            // downsample or remove operations per cleanup run
+constexpr unsigned long SHOT_HISTORY_CLEANUP_INTERVAL = 60000;
+// bytes, the writer also rebuilds the shot index (legacy CSV parsing, notes JSON) and downsamples shots
+constexpr uint32_t SHOT_HISTORY_WRITER_STACK_SIZE = 8192;
+constexpr uint32_t SHOT_HISTORY_MIN_STACK_HEADROOM = 1024; // bytes, less is logged as a warning
+
+// Recorder health since the start of the current shot
+struct ShotRecorderStats {
+    uint32_t samples;   // samples taken
+    uint32_t dropped;   // samples lost because the writer fell behind
+    uint32_t late;      // sampler wakeups that missed their deadline
+    uint32_t peakQueue; // highest number of samples waiting for the writer
+};
 
 class ShotHistoryPlugin : public Plugin {
   public:
@@ -17,12 +43,16 @@ class ShotHistoryPlugin : public Plugin {
     void loop() override {};
 
     void record();
+    ShotRecorderStats getRecorderStats() const;
 
     void handleRequest(JsonDocument &request, JsonDocument &response);
+    File openHistory(const String &id);
 
   private:
     void saveNotes(const String &id, const JsonDocument &notes);
     void loadNotes(const String &id, JsonDocument &notes);
+    void listHistory(JsonDocument &request, JsonDocument &response);
+    void removeShot(uint32_t id);
     struct ShotSample {
         unsigned long t;
         float tt;
@@ -37,26 +67,41 @@ class ShotHistoryPlugin : public Plugin {
         float ev;
         float pr;
 
-        std::string serialize() {
-            return string_format("%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f", t, tt, ct, tp, cp, fl, tf, pf, vf,
-                                 v, ev, pr);
+        ShotLogRecord quantize() const {
+            const float values[SHOT_LOG_CHANNELS] = {tt, ct, tp, cp, fl, tf, pf, vf, v, ev, pr};
+            ShotLogRecord record{};
+            record.t = shotLogTicks(t, SHOT_LOG_TIME_UNIT_MS);
+            for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+                record.values[i] = shotLogQuantize(values[i], SHOT_LOG_DEFAULT_SCALES[i]);
+            }
+            return record;
         }
     };
 
     void startRecording();
+    void sample();
+    void queueSample(const ShotSample &sample);
+    void encode(const ShotLogRecord &sample);
+    void appendRecord(const ShotLogRecord &record);
+    void finishShot();
 
     unsigned long getTime();
 
     void endRecording();
+    bool writeBlock(File &target, const ShotLogRecord *records, uint16_t count);
     void cleanupHistory();
+    bool hasHistorySpace();
+    void downsampleShot(ShotIndexEntry &entry);
 
     Controller *controller = nullptr;
     PluginManager *pluginManager = nullptr;
     String currentId = "";
+    File file;
     bool isFileOpen = false;
 
-    bool recording = false;
-    bool headerWritten = false;
+    volatile bool recording = false;
+    bool cleanupPending = false;
+    unsigned long lastCleanup = 0;
     unsigned long shotStart = 0;
     unsigned long lastVolumeSample = 0;
     float currentTemperature = 0.0f;
@@ -65,9 +110,31 @@ class ShotHistoryPlugin : public Plugin {
     float currentEstimatedWeight = 0.0f;
     float currentPuckResistance = 0.0f;
     String currentProfileName;
-
-    xTaskHandle taskHandle;
-    static void loopTask(void *arg);
+    String currentProfileId;
+
+    uint16_t sampleInterval = 100; // sampler period
+    uint16_t logInterval = 100;    // nominal interval of the recorded samples
+
+    // Filled by the sampler, drained by the writer. Everything below the queue is owned by the writer task.
+    RingBuffer<ShotLogRecord, SHOT_HISTORY_QUEUE_SIZE> sampleQueue;
+    std::atomic<uint32_t> sampleCount{0};
+    std::atomic<uint32_t> droppedSamples{0};
+    std::atomic<uint32_t> lateSamples{0};
+    std::atomic<uint32_t> peakQueue{0};
+
+    ShotLogHeader header{};
+    ShotIndexEntry currentEntry{};
+    ShotStats currentStats;
+    ShotLogEncoder encoder;
+    ShotLogRecord blockRecords[SHOT_LOG_BLOCK_RECORDS];
+    uint16_t blockCount = 0;
+    uint8_t blockBuffer[SHOT_LOG_BLOCK_SIZE] = {};
+    ShotIndex shotIndex{SPIFFS, "/h"};
+
+    xTaskHandle samplerHandle;
+    xTaskHandle writerHandle;
+    static void samplerTask(void *arg);
+    static void writerTask(void *arg);
 };
 
 extern ShotHistoryPlugin ShotHistory;
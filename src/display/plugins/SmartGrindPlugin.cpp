@@ -7,8 +7,9 @@
 
 void SmartGrindPlugin::setup(Controller *controller, PluginManager *pluginManager) {
     this->controller = controller;
-    pluginManager->on("controller:grind:start", [this](Event const &event) { start(); });
-    pluginManager->on("controller:grind:end", [this](Event const &event) { stop(); });
+    // The relay is switched with a blocking HTTP request, keep it off the controller task
+    pluginManager->on(this, "controller:grind:start", [this](Event const &event) { start(); });
+    pluginManager->on(this, "controller:grind:end", [this](Event const &event) { stop(); });
 }
 
 void SmartGrindPlugin::start() {
@@ -78,6 +78,12 @@ void WebUIPlugin::loop() {
         doc["bta"] = controller->isVolumetricAvailable() ? 1 : 0;
         doc["bt"] = controller->isVolumetricAvailable() && controller->getSettings().isVolumetricTarget() ? 1 : 0;
         doc["led"] = controller->getSystemInfo().capabilities.ledControl;
+        const ShotRecorderStats recorder = ShotHistory.getRecorderStats();
+        auto hrObj = doc["hr"].to<JsonObject>();
+        hrObj["s"] = recorder.samples;
+        hrObj["d"] = recorder.dropped;
+        hrObj["l"] = recorder.late;
+        hrObj["q"] = recorder.peakQueue;
 
         Process *process = controller->getProcess();
         if (process == nullptr) {
@@ -108,6 +114,7 @@ void WebUIPlugin::loop() {
 
         ws.textAll(doc.as<String>());
     }
+    processHistoryStream();
     if (now > lastCleanup + CLEANUP_PERIOD) {
         lastCleanup = now;
         ws.cleanupClients();
@@ -144,6 +151,7 @@ void WebUIPlugin::setupServer() {
         serializeJson(doc, *response);
         request->send(response);
     });
+    server.on("/api/diagnostics", [this](AsyncWebServerRequest *request) { handleDiagnostics(request); });
     server.on("/api/scales/list", [this](AsyncWebServerRequest *request) { handleBLEScaleList(request); });
     server.on("/api/scales/connect", [this](AsyncWebServerRequest *request) { handleBLEScaleConnect(request); });
     server.on("/api/scales/scan", [this](AsyncWebServerRequest *request) { handleBLEScaleScan(request); });
@@ -248,10 +256,23 @@ void WebUIPlugin::handleWebSocketData(AsyncWebSocket *server, AsyncWebSocketClie
                 } else if (msgType.startsWith("req:history")) {
                     JsonDocument resp;
                     ShotHistory.handleRequest(doc, resp);
+                    const std::vector<String> ids = historyStreamIds(doc, resp);
+                    // Only this handler adds jobs, so the room checked here is still there after the response is sent
+                    const bool stream = !ids.empty() && historyJobs.capacity() - historyJobs.size() >= ids.size();
+                    if (!ids.empty() && !stream) {
+                        ESP_LOGW("WebUIPlugin", "History stream queue full, dropping request");
+                        resp["error"] = "History stream queue full";
+                    }
+                    // Tells the client whether binary frames follow for this rid
+                    resp["stream"] = stream;
                     size_t bufferSize = measureJson(resp);
                     auto *buffer = ws.makeBuffer(bufferSize);
                     serializeJson(resp, buffer->get(), bufferSize);
                     client->text(buffer);
+                    // Queued after the response so the index always arrives before the sample data
+                    if (stream) {
+                        queueHistoryStream(client->id(), doc["rid"].as<String>(), ids);
+                    }
                 } else if (msgType == "req:flush:start") {
                     handleFlushStart(client->id(), doc);
                 }
@@ -374,6 +395,7 @@ void WebUIPlugin::handleSettings(AsyncWebServerRequest *request) const {
                 settings->setPid(request->arg("pid"));
             if (request->hasArg("pumpModelCoeffs"))
                 settings->setPumpModelCoeffs(request->arg("pumpModelCoeffs"));
+            settings->setPumpModelAdjust(request->hasArg("pumpModelAdjust"));
             if (request->hasArg("wifiSsid"))
                 settings->setWifiSsid(request->arg("wifiSsid"));
             if (request->hasArg("mdnsName"))
@@ -423,6 +445,12 @@ void WebUIPlugin::handleSettings(AsyncWebServerRequest *request) const {
                 settings->setSteamPumpPercentage(request->arg("steamPumpPercentage").toFloat());
             if (request->hasArg("steamPumpCutoff"))
                 settings->setSteamPumpCutoff(request->arg("steamPumpCutoff").toFloat());
+            if (request->hasArg("historyTolerance"))
+                settings->setHistoryTolerance(request->arg("historyTolerance").toInt());
+            if (request->hasArg("historySampleRate"))
+                settings->setHistorySampleRate(request->arg("historySampleRate").toInt());
+            if (request->hasArg("controlInterval"))
+                settings->setControlInterval(request->arg("controlInterval").toInt());
             if (request->hasArg("themeMode"))
                 settings->setThemeMode(request->arg("themeMode").toInt());
             if (request->hasArg("sunriseR"))
@@ -460,6 +488,7 @@ void WebUIPlugin::handleSettings(AsyncWebServerRequest *request) const {
     doc["haTopic"] = settings.getHomeAssistantTopic();
     doc["pid"] = settings.getPid();
     doc["pumpModelCoeffs"] = settings.getPumpModelCoeffs();
+    doc["pumpModelAdjust"] = settings.isPumpModelAdjust();
     doc["wifiSsid"] = settings.getWifiSsid();
     doc["wifiPassword"] = apMode ? "---unchanged---" : settings.getWifiPassword();
     doc["mdnsName"] = settings.getMdnsName();
@@ -483,6 +512,9 @@ void WebUIPlugin::handleSettings(AsyncWebServerRequest *request) const {
     doc["standbyBrightnessTimeout"] = settings.getStandbyBrightnessTimeout() / 1000;
     doc["steamPumpPercentage"] = settings.getSteamPumpPercentage();
     doc["steamPumpCutoff"] = settings.getSteamPumpCutoff();
+    doc["historyTolerance"] = settings.getHistoryTolerance();
+    doc["historySampleRate"] = settings.getHistorySampleRate();
+    doc["controlInterval"] = settings.getControlInterval();
     doc["themeMode"] = settings.getThemeMode();
     doc["sunriseR"] = settings.getSunriseR();
     doc["sunriseG"] = settings.getSunriseG();
@@ -549,6 +581,63 @@ void WebUIPlugin::handleBLEScaleInfo(AsyncWebServerRequest *request) {
     request->send(response);
 }
 
+void WebUIPlugin::handleDiagnostics(AsyncWebServerRequest *request) const {
+    JsonDocument doc;
+    auto events = doc["events"].to<JsonObject>();
+    events["dropped"] = pluginManager->getDroppedEvents();
+    auto streams = events["streams"].to<JsonArray>();
+    for (const auto &stats : pluginManager->getStreamStats()) {
+        auto stream = streams.add<JsonObject>();
+        stream["id"] = stats.name;
+        stream["raw"] = stats.raw;
+        stream["delivered"] = stats.delivered;
+    }
+    NimBLEClientController *clientController = controller->getClientController();
+    const BleSequenceTracker &sensorStats = clientController->getSensorStats();
+    auto ble = doc["ble"].to<JsonObject>();
+    ble["protocol"] = clientController->getBinaryProtocol();
+    ble["frames"] = sensorStats.frames;
+    ble["dropped"] = sensorStats.dropped;
+    ble["outOfOrder"] = sensorStats.outOfOrder;
+    const ControlWriteStats writeStats = clientController->getControlWriteStats();
+    ble["controlWrites"] = writeStats.written;
+    ble["suppressedWrites"] = writeStats.suppressed;
+    const BleLinkStats linkStats = clientController->getLinkStats();
+    auto link = ble["link"].to<JsonObject>();
+    static const char *const LINK_MODES[] = {"idle", "brewing", "standby"};
+    link["mode"] = LINK_MODES[static_cast<uint8_t>(linkStats.mode)];
+    link["mtu"] = linkStats.mtu;
+    link["intervalMs"] = linkStats.interval * 1.25f;
+    link["latency"] = linkStats.latency;
+    link["rssi"] = linkStats.rssi;
+    link["notificationRate"] = linkStats.notificationRate;
+    link["notifications"] = linkStats.notifications;
+    link["writeErrors"] = linkStats.writeErrors;
+    link["paramUpdates"] = linkStats.paramUpdates;
+    const BleConnectionStats connectionStats = clientController->getConnectionStats();
+    auto connection = ble["connection"].to<JsonObject>();
+    static const char *const CONNECTION_STATES[] = {"scanning", "connecting", "connected", "backoff"};
+    connection["state"] = CONNECTION_STATES[static_cast<uint8_t>(connectionStats.state)];
+    connection["connects"] = connectionStats.connects;
+    connection["failedConnects"] = connectionStats.failedConnects;
+    connection["lastReconnectMs"] = connectionStats.lastReconnectTime;
+    connection["maxReconnectMs"] = connectionStats.maxReconnectTime;
+    const ControlLatencyStats latency = controller->getControlLatencyStats();
+    auto control = doc["control"].to<JsonObject>();
+    control["updates"] = latency.updates;
+    control["triggered"] = latency.triggered;
+    control["lastLatencyUs"] = latency.last;
+    control["maxLatencyUs"] = latency.max;
+    control["avgLatencyUs"] = latency.triggered > 0 ? latency.total / latency.triggered : 0;
+    const LoopStallStats stall = controller->getLoopStallStats();
+    auto loop = doc["loop"].to<JsonObject>();
+    loop["lastStallUs"] = stall.last;
+    loop["maxStallUs"] = stall.max;
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    serializeJson(doc, *response);
+    request->send(response);
+}
+
 void WebUIPlugin::updateOTAStatus(const String &version) {
     Settings const &settings = controller->getSettings();
     JsonDocument doc;
@@ -582,6 +671,104 @@ void WebUIPlugin::sendAutotuneResult() {
     ws.textAll(message);
 }
 
+std::vector<String> WebUIPlugin::historyStreamIds(JsonDocument &request, JsonDocument &response) {
+    const String type = request["tp"].as<String>();
+    std::vector<String> ids;
+    if (type == "req:history:get" && response["error"].isNull()) {
+        ids.push_back(response["id"].as<String>());
+    } else if (type == "req:history:list" && request["data"].as<bool>()) {
+        for (JsonObject shot : response["history"].as<JsonArray>()) {
+            ids.push_back(shot["id"].as<String>());
+        }
+    }
+    return ids;
+}
+
+void WebUIPlugin::queueHistoryStream(uint32_t clientId, const String &rid, const std::vector<String> &ids) {
+    for (size_t i = 0; i < ids.size(); i++) {
+        HistoryStreamJob job{};
+        job.clientId = clientId;
+        strlcpy(job.rid, rid.c_str(), sizeof(job.rid));
+        strlcpy(job.id, ids[i].c_str(), sizeof(job.id));
+        job.last = i == ids.size() - 1;
+        historyJobs.push(job);
+    }
+}
+
+void WebUIPlugin::processHistoryStream() {
+    size_t sent = 0;
+    while (sent < HISTORY_CHUNKS_PER_LOOP) {
+        if (!historyStreaming) {
+            if (!historyJobs.pop(historyJob)) {
+                return;
+            }
+            historyFile = ShotHistory.openHistory(historyJob.id);
+            historyStreaming = true;
+        }
+
+        AsyncWebSocketClient *client = ws.client(historyJob.clientId);
+        if (client == nullptr || client->status() != WS_CONNECTED) {
+            historyFile.close();
+            historyStreaming = false;
+            continue;
+        }
+        // Leave room in the client queue, a full queue closes the connection
+        if (client->queueLen() >= HISTORY_MAX_QUEUED_MESSAGES) {
+            return;
+        }
+
+        uint8_t *payload = nullptr;
+        const size_t remaining = historyFile ? static_cast<size_t>(historyFile.available()) : 0;
+        if (remaining > 0) {
+            const size_t length = std::min(remaining, HISTORY_CHUNK_SIZE);
+            auto *buffer = makeHistoryFrame(WS_BINARY_HISTORY_CHUNK, historyJob, length, payload);
+            if (buffer == nullptr) {
+                return;
+            }
+            if (historyFile.read(payload, length) == length) {
+                client->binary(buffer);
+                sent++;
+                continue;
+            }
+            // The writer task removed or replaced the file, end the shot here instead of sending stale buffer bytes.
+            // Readers stop at the last complete block.
+            ESP_LOGW("WebUIPlugin", "Short read streaming shot %s", historyJob.id);
+            delete buffer;
+        }
+
+        historyFile.close();
+        historyStreaming = false;
+        if (auto *buffer = makeHistoryFrame(WS_BINARY_HISTORY_END, historyJob, 0, payload)) {
+            client->binary(buffer);
+        }
+        if (historyJob.last) {
+            if (auto *buffer = makeHistoryFrame(WS_BINARY_HISTORY_STREAM_END, historyJob, 0, payload)) {
+                client->binary(buffer);
+            }
+        }
+    }
+}
+
+AsyncWebSocketMessageBuffer *WebUIPlugin::makeHistoryFrame(uint8_t type, const HistoryStreamJob &job, size_t payloadLength,
+                                                           uint8_t *&payload) {
+    const size_t ridLength = strlen(job.rid);
+    const size_t idLength = strlen(job.id);
+    auto *buffer = ws.makeBuffer(3 + ridLength + idLength + payloadLength);
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+    uint8_t *out = buffer->get();
+    *out++ = type;
+    *out++ = static_cast<uint8_t>(ridLength);
+    memcpy(out, job.rid, ridLength);
+    out += ridLength;
+    *out++ = static_cast<uint8_t>(idLength);
+    memcpy(out, job.id, idLength);
+    out += idLength;
+    payload = out;
+    return buffer;
+}
+
 void WebUIPlugin::handleFlushStart(uint32_t clientId, JsonDocument &request) {
     controller->onFlush();
 
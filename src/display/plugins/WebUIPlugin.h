@@ -6,6 +6,7 @@
 #include <DNSServer.h>
 
 #include "../core/Plugin.h"
+#include "../core/RingBuffer.h"
 #include "GitHubOTA.h"
 #include "ShotHistoryPlugin.h"
 #include <ArduinoJson.h>
@@ -17,12 +18,28 @@ constexpr size_t UPDATE_CHECK_INTERVAL = 5 * 60 * 1000;
 constexpr size_t CLEANUP_PERIOD = 5 * 1000;
 constexpr size_t STATUS_PERIOD = 500;
 constexpr size_t DNS_PERIOD = 10;
+constexpr size_t HISTORY_CHUNK_SIZE = 1024;
+constexpr size_t HISTORY_CHUNKS_PER_LOOP = 4;
+constexpr size_t HISTORY_MAX_QUEUED_MESSAGES = 4;
+constexpr size_t HISTORY_STREAM_QUEUE_SIZE = 16;
+
+// Binary websocket frames: [type][rid length][rid][id length][id][payload]
+constexpr uint8_t WS_BINARY_HISTORY_CHUNK = 0x01;      // next part of a shot file
+constexpr uint8_t WS_BINARY_HISTORY_END = 0x02;        // shot file complete, no payload
+constexpr uint8_t WS_BINARY_HISTORY_STREAM_END = 0x03; // all shots of the request sent, no payload
 
 const String LOCAL_URL = "http://4.4.4.1/";
 const String RELEASE_URL = "https://github.com/jniebuhr/gaggimate/releases/";
 
 class ProfileManager;
 
+struct HistoryStreamJob {
+    uint32_t clientId;
+    char rid[40];
+    char id[16];
+    bool last;
+};
+
 class WebUIPlugin : public Plugin {
   public:
     WebUIPlugin();
@@ -49,9 +66,15 @@ class WebUIPlugin : public Plugin {
     void handleBLEScaleScan(AsyncWebServerRequest *request);
     void handleBLEScaleConnect(AsyncWebServerRequest *request);
     void handleBLEScaleInfo(AsyncWebServerRequest *request);
+    void handleDiagnostics(AsyncWebServerRequest *request) const;
     void updateOTAStatus(const String &version);
     void updateOTAProgress(uint8_t phase, int progress);
     void sendAutotuneResult();
+    static std::vector<String> historyStreamIds(JsonDocument &request, JsonDocument &response);
+    void queueHistoryStream(uint32_t clientId, const String &rid, const std::vector<String> &ids);
+    void processHistoryStream();
+    AsyncWebSocketMessageBuffer *makeHistoryFrame(uint8_t type, const HistoryStreamJob &job, size_t payloadLength,
+                                                  uint8_t *&payload);
 
     GitHubOTA *ota = nullptr;
     AsyncWebServer server;
@@ -69,6 +92,12 @@ class WebUIPlugin : public Plugin {
     bool apMode = false;
     bool serverRunning = false;
     String updateComponent = "";
+
+    // Filled by the websocket handler, drained by loop() as the client queue allows
+    RingBuffer<HistoryStreamJob, HISTORY_STREAM_QUEUE_SIZE> historyJobs;
+    HistoryStreamJob historyJob{};
+    File historyFile;
+    bool historyStreaming = false;
 };
 
 #endif // WEBUIPLUGIN_H
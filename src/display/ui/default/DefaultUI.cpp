@@ -87,8 +87,8 @@ void DefaultUI::init() {
             rerender = true;
         }
     });
-    pluginManager->on("boiler:pressure:change", [=](Event const &event) {
-        float newPressure = event.getFloat("value");
+    pluginManager->on(EVENT_BOILER_PRESSURE_COALESCED, [=](Event const &event) {
+        float newPressure = event.getFloat(EVENT_KEY_VALUE);
         if (round(newPressure * 10.0f) != round(pressure * 10.0f)) {
             pressure = newPressure;
             rerender = true;
@@ -0,0 +1,76 @@
+#include "MachineModel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr float WATER_HEAT_CAPACITY = 4.186f; // J/(g K)
+constexpr float VENT_CONDUCTANCE = 3.0f;      // ml/s per bar through the 3-way valve while it is closed
+} // namespace
+
+MachineModel::MachineModel(const MachineParameters &params, uint32_t seed)
+    : params(params), rng(seed != 0 ? seed : 1), boilerTemperature(params.ambientTemperature),
+      sensorTemperature(params.ambientTemperature) {}
+
+void MachineModel::step(float dt, const MachineInputs &inputs) {
+    const float slope = (params.pumpFlowOneBar - params.pumpFlowNineBar) / 8.0f;
+    const float maxFlow = std::max(0.0f, params.pumpFlowOneBar + slope - slope * pressure);
+    pumpFlow = maxFlow * std::clamp(inputs.pumpPower, 0.0f, 100.0f) / 100.0f;
+    const float opvFlow = params.opvConductance * std::max(0.0f, pressure - params.opvPressure);
+
+    if (!inputs.valve) {
+        headspaceFill = 0.0f;
+        puckFlow = 0.0f;
+        pressure += (pumpFlow - opvFlow - VENT_CONDUCTANCE * pressure) / params.compliance * dt;
+    } else if (headspaceFill < params.headspace) {
+        headspaceFill += pumpFlow * dt;
+        puckFlow = 0.0f;
+    } else {
+        const float conductance = params.puckConductance * (1.0f + params.puckErosion * throughPuck);
+        puckFlow = conductance * std::sqrt(pressure);
+        pressure += (pumpFlow - puckFlow - opvFlow) / params.compliance * dt;
+        const float volume = puckFlow * dt;
+        throughPuck += volume;
+        if (absorbed < params.puckAbsorption) {
+            absorbed += volume;
+        } else {
+            cupWeight += volume;
+        }
+    }
+    pressure = std::max(0.0f, pressure);
+
+    const float heating = inputs.heater ? params.heaterPower : 0.0f;
+    const float loss = (boilerTemperature - params.ambientTemperature) / params.thermalResistance;
+    const float refill = pumpFlow * WATER_HEAT_CAPACITY * (boilerTemperature - params.inletTemperature);
+    boilerTemperature += (heating - loss - refill) / params.thermalMass * dt;
+    sensorTemperature += (boilerTemperature - sensorTemperature) / params.sensorLag * dt;
+}
+
+void MachineModel::newShot() {
+    pressure = 0.0f;
+    headspaceFill = 0.0f;
+    absorbed = 0.0f;
+    throughPuck = 0.0f;
+    cupWeight = 0.0f;
+}
+
+void MachineModel::setBoilerTemperature(float temperature) {
+    boilerTemperature = temperature;
+    sensorTemperature = temperature;
+}
+
+float MachineModel::readPressure() { return std::max(0.0f, pressure + noise(params.pressureNoise)); }
+
+float MachineModel::readWeight() { return cupWeight + noise(params.scaleNoise); }
+
+// Approximately normal, sum of four uniform samples. Deterministic for a given seed.
+float MachineModel::noise(float deviation) {
+    float sum = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        sum += static_cast<float>(rng) / 4294967296.0f;
+    }
+    return (sum - 2.0f) * std::sqrt(3.0f) * deviation;
+}
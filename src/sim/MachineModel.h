@@ -0,0 +1,75 @@
+#ifndef MACHINEMODEL_H
+#define MACHINEMODEL_H
+
+#include <cstdint>
+
+// Lumped parameter model of a single boiler machine with a vibratory pump, a 3-way valve and a puck.
+//
+// Boiler: one thermal mass heated by the element, losing heat to the room and to the cold water the pump pushes in.
+// The thermocouple follows the boiler with a first order lag.
+// Hydraulics: the pump delivers less flow the higher the pressure, the headspace above the puck has to fill before
+// pressure builds, the OPV bypasses flow above its cracking pressure. Flow through the puck grows with the square
+// root of the pressure, the puck soaks up water before the first drops and erodes as water passes through it.
+struct MachineParameters {
+    float heaterPower = 1425.0f;    // W
+    float thermalMass = 1050.0f;    // J/K, boiler water and body
+    float thermalResistance = 1.2f; // K/W to the room
+    float ambientTemperature = 22.0f;
+    float inletTemperature = 22.0f;
+    float sensorLag = 3.0f;       // s
+    float pumpFlowOneBar = 10.0f; // ml/s at full power
+    float pumpFlowNineBar = 5.8f; // ml/s at full power
+    float compliance = 1.4f;      // ml/bar
+    float headspace = 6.0f;       // ml above the puck
+    float opvPressure = 12.0f;    // bar
+    float opvConductance = 5.0f;  // ml/s per bar above the cracking pressure
+    float puckConductance = 0.6f; // ml/s per sqrt(bar) of a fresh puck
+    float puckErosion = 0.012f;   // relative conductance increase per ml through the puck
+    float puckAbsorption = 18.0f; // ml the puck holds before it drips
+    float pressureNoise = 0.03f;  // bar, standard deviation
+    float scaleNoise = 0.05f;     // g, standard deviation
+};
+
+struct MachineInputs {
+    bool heater;
+    bool valve;
+    float pumpPower; // %
+};
+
+class MachineModel {
+  public:
+    explicit MachineModel(const MachineParameters &params, uint32_t seed = 1);
+
+    void step(float dt, const MachineInputs &inputs);
+    // Fresh puck and empty cup for the next shot, the boiler keeps its temperature
+    void newShot();
+    void setBoilerTemperature(float temperature);
+
+    float readTemperature() const { return sensorTemperature; }
+    float readPressure();
+    float readWeight();
+
+    float getPressure() const { return pressure; }
+    float getBoilerTemperature() const { return boilerTemperature; }
+    float getPumpFlow() const { return pumpFlow; }
+    float getPuckFlow() const { return puckFlow; }
+    float getWeight() const { return cupWeight; }
+
+  private:
+    float noise(float deviation);
+
+    MachineParameters params;
+    uint32_t rng;
+
+    float boilerTemperature;
+    float sensorTemperature;
+    float pressure = 0.0f;
+    float headspaceFill = 0.0f;
+    float absorbed = 0.0f;
+    float throughPuck = 0.0f;
+    float cupWeight = 0.0f;
+    float pumpFlow = 0.0f;
+    float puckFlow = 0.0f;
+};
+
+#endif // MACHINEMODEL_H
@@ -0,0 +1,62 @@
+#include "ProfileLoader.h"
+
+#include <ArduinoJson.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+Profile defaultProfile() {
+    Phase preinfusion{.name = "Preinfusion",
+                      .phase = PhaseType::PHASE_TYPE_PREINFUSION,
+                      .valve = 1,
+                      .duration = 8,
+                      .pumpIsSimple = false,
+                      .pumpSimple = 0,
+                      .temperature = 0,
+                      .transition = Transition{.type = TransitionType::INSTANT, .duration = 0, .adaptive = false},
+                      .pumpAdvanced = PumpAdvanced{.target = PumpTarget::PUMP_TARGET_PRESSURE, .pressure = 3, .flow = 8},
+                      .targets = {}};
+    Phase brew{.name = "Brew",
+               .phase = PhaseType::PHASE_TYPE_BREW,
+               .valve = 1,
+               .duration = 40,
+               .pumpIsSimple = false,
+               .pumpSimple = 0,
+               .temperature = 0,
+               .transition = Transition{.type = TransitionType::LINEAR, .duration = 2, .adaptive = true},
+               .pumpAdvanced = PumpAdvanced{.target = PumpTarget::PUMP_TARGET_PRESSURE, .pressure = 9, .flow = 8},
+               .targets = {Target{.type = TargetType::TARGET_TYPE_VOLUMETRIC, .operator_ = TargetOperator::GTE, .value = 36}}};
+    return Profile{.id = "sim",
+                   .label = "Simulator 9 bar",
+                   .type = "pro",
+                   .description = "",
+                   .temperature = 93,
+                   .phases = {preinfusion, brew}};
+}
+
+bool loadProfile(const std::string &path, Profile &profile) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    JsonDocument doc;
+    if (deserializeJson(doc, contents.str())) {
+        return false;
+    }
+    return parseProfile(doc.as<JsonObject>(), profile) && !profile.phases.empty();
+}
+
+size_t loadProfiles(const std::string &directory, std::vector<Profile> &profiles) {
+    std::error_code error;
+    size_t loaded = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, error)) {
+        Profile profile;
+        if (entry.path().extension() == ".json" && loadProfile(entry.path().string(), profile)) {
+            profiles.push_back(profile);
+            loaded++;
+        }
+    }
+    return loaded;
+}
@@ -0,0 +1,17 @@
+#ifndef PROFILELOADER_H
+#define PROFILELOADER_H
+
+#include <display/models/profile.h>
+#include <string>
+#include <vector>
+
+// 8 s preinfusion at 3 bar, then 9 bar until 36 g
+Profile defaultProfile();
+
+// Reads a profile JSON as exported from the web UI or stored in /p on the display
+bool loadProfile(const std::string &path, Profile &profile);
+
+// Reads all profile JSON files of a directory, e.g. a copy of /p
+size_t loadProfiles(const std::string &directory, std::vector<Profile> &profiles);
+
+#endif // PROFILELOADER_H
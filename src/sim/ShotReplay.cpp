@@ -0,0 +1,325 @@
+#include "ShotReplay.h"
+
+#include "ProfileLoader.h"
+#include "SimulatedController.h"
+
+#include <display/core/constants.h>
+#include <display/core/process/BrewProcess.h>
+#include <display/models/shot_log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr unsigned long REPLAY_STEP_MS = 1; // resolution of the pressure sample times
+
+struct ReplayOptions {
+    std::string profilePath;
+    std::string profileDirectory;
+    double brewDelay = SIM_BREW_DELAY_MS;
+    bool volumetric = true;
+    bool csv = false;
+};
+
+struct RecordedShot {
+    std::string name;
+    ShotLogHeader header{};
+    std::vector<ShotLogRecord> records;
+
+    unsigned long getDuration() const { return static_cast<unsigned long>(records.back().t) * header.timeUnit; }
+
+    // Linear interpolation between the breakpoints, like the web UI draws the shot
+    float value(ShotLogChannel channel, unsigned long ms, size_t &cursor) const {
+        const auto t = static_cast<float>(ms) / static_cast<float>(header.timeUnit);
+        while (cursor + 1 < records.size() && records[cursor + 1].t <= t) {
+            cursor++;
+        }
+        const ShotLogRecord &a = records[cursor];
+        float raw = a.values[channel];
+        if (cursor + 1 < records.size() && t > a.t) {
+            const ShotLogRecord &b = records[cursor + 1];
+            raw += (b.values[channel] - a.values[channel]) * (t - a.t) / static_cast<float>(b.t - a.t);
+        }
+        return raw / static_cast<float>(header.scales[channel]);
+    }
+
+    bool hasWeight() const {
+        return std::any_of(records.begin(), records.end(), [](const ShotLogRecord &r) { return r.values[SHOT_LOG_V] > 0; });
+    }
+};
+
+struct ReplayResult {
+    std::vector<std::pair<unsigned int, unsigned long>> transitions; // phase index, ms
+    bool stopped = false;
+    unsigned long stopTime = 0;
+    float weightAtStop = 0.0f;
+    float rate = 0.0f;      // g/s at the stop
+    float predicted = 0.0f; // weight predicted at the stop
+    float target = 0.0f;
+    float finalWeight = 0.0f;
+    double newDelay = 0.0;
+    float estimatedVolume = 0.0f;
+    float recordedEstimate = 0.0f;
+    float puckResistance = 0.0f;
+    float recordedResistance = 0.0f;
+};
+
+bool loadCsv(const std::string &content, RecordedShot &shot) {
+    std::istringstream input(content);
+    std::string line;
+    if (!std::getline(input, line)) {
+        return false;
+    }
+    initShotLogHeader(shot.header, "", 0, 250);
+    while (std::getline(input, line)) {
+        unsigned long t;
+        float values[SHOT_LOG_CHANNELS] = {};
+        if (sscanf(line.c_str(), "%lu,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f", &t, &values[0], &values[1], &values[2], &values[3],
+                   &values[4], &values[5], &values[6], &values[7], &values[8], &values[9], &values[10]) < 11) {
+            continue;
+        }
+        ShotLogRecord record{};
+        record.t = shotLogTicks(t, shot.header.timeUnit);
+        for (size_t i = 0; i < SHOT_LOG_CHANNELS; i++) {
+            record.values[i] = shotLogQuantize(values[i], shot.header.scales[i]);
+        }
+        shot.records.push_back(record);
+    }
+    return !shot.records.empty();
+}
+
+bool loadShot(const std::string &path, RecordedShot &shot) {
+    std::ifstream file(path, std::ios::binary);
+    const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    shot.name = path;
+    uint32_t magic = 0;
+    if (content.size() >= sizeof(magic)) {
+        memcpy(&magic, content.data(), sizeof(magic));
+    }
+    if (magic == SHOT_LOG_MAGIC) {
+        return readShotLog(reinterpret_cast<const uint8_t *>(content.data()), content.size(), shot.header, shot.records);
+    }
+    return loadCsv(content, shot);
+}
+
+const Profile *findProfile(const RecordedShot &shot, const std::vector<Profile> &profiles, bool forced) {
+    if (forced) {
+        return &profiles.front();
+    }
+    for (const auto &profile : profiles) {
+        // The shot log stores the label, truncated to the header field
+        if (!profile.label.empty() &&
+            strncmp(profile.label.c_str(), shot.header.profileName, SHOT_LOG_PROFILE_NAME_LENGTH - 1) == 0) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+// Runs the display's brew process and the board's pressure controller on the recorded sensor channels. The valve
+// stays open for the whole recording since the display only records while brewing.
+ReplayResult replay(const RecordedShot &shot, const Profile &profile, const ReplayOptions &options) {
+    ReplayResult result;
+    const bool volumetric = options.volumetric && shot.hasWeight();
+    BrewProcess process(profile, volumetric ? ProcessTarget::VOLUMETRIC : ProcessTarget::TIME, options.brewDelay);
+    result.target = volumetric ? static_cast<float>(process.getBrewVolume()) : 0.0f;
+    result.transitions.emplace_back(0, 0);
+
+    float ctrlPressure = 0.0f;
+    float ctrlFlow = 0.0f;
+    float pressure = shot.records.front().values[SHOT_LOG_CP] / static_cast<float>(shot.header.scales[SHOT_LOG_CP]);
+    float power = 0.0f;
+    int valve = 1;
+    PressureController pressureController(SIM_PRESSURE_SAMPLE_US / 1000000.0f, &ctrlPressure, &ctrlFlow, &pressure, &power,
+                                          &valve);
+    pressureController.setPumpFlowCoeff(10.205f, 5.521f); // DEFAULT_PUMP_MODEL_COEFFS
+    pressureController.tare();
+    pressureController.reset();
+    auto mode = PressureController::ControlMode::POWER;
+
+    size_t pumpCursor = 0;
+    unsigned long nextSample = SIM_PRESSURE_SAMPLE_US; // us
+    unsigned long lastSample = 0;
+    size_t processCursor = 0;
+    const unsigned long duration = shot.getDuration();
+    for (unsigned long t = REPLAY_STEP_MS; t <= duration; t += REPLAY_STEP_MS) {
+        host::advanceMicros(REPLAY_STEP_MS * 1000);
+        if (t * 1000 >= nextSample) {
+            nextSample += SIM_PRESSURE_SAMPLE_US;
+            pressure = shot.value(SHOT_LOG_CP, t, pumpCursor);
+            ctrlPressure = shot.value(SHOT_LOG_TP, t, pumpCursor);
+            ctrlFlow = shot.value(SHOT_LOG_TF, t, pumpCursor);
+            if (process.isAdvancedPump()) {
+                mode = process.getPumpTarget() == PumpTarget::PUMP_TARGET_PRESSURE ? PressureController::ControlMode::PRESSURE
+                                                                                    : PressureController::ControlMode::FLOW;
+            } else if (process.isActive()) {
+                // DimmedPump::setPower
+                mode = PressureController::ControlMode::POWER;
+                power = process.getPumpValue();
+                ctrlPressure = power > 0.0f ? 20.0f : 0.0f;
+            }
+            pressureController.update(mode, (t - lastSample) / 1000.0f);
+            lastSample = t;
+        }
+        if (t % PROGRESS_INTERVAL != 0) {
+            continue;
+        }
+        const float weight = shot.value(SHOT_LOG_V, t, processCursor);
+        process.updatePressure(shot.value(SHOT_LOG_CP, t, processCursor));
+        process.updateFlow(shot.value(SHOT_LOG_FL, t, processCursor));
+        if (volumetric) {
+            process.updateVolume(weight);
+        }
+        const bool wasActive = process.isActive();
+        const unsigned int phase = process.phaseIndex;
+        process.progress();
+        if (process.phaseIndex != phase) {
+            result.transitions.emplace_back(process.phaseIndex, t);
+        }
+        if (wasActive && !process.isActive()) {
+            const double rate = process.volumetricRateCalculator.getRate(); // g/ms
+            result.stopped = true;
+            result.stopTime = t;
+            result.weightAtStop = weight;
+            result.rate = static_cast<float>(rate * 1000.0);
+            result.predicted = weight > 0.0f ? static_cast<float>(weight + rate * options.brewDelay) : 0.0f;
+        }
+    }
+
+    size_t cursor = 0;
+    result.finalWeight = shot.value(SHOT_LOG_V, duration, cursor);
+    result.recordedEstimate = shot.value(SHOT_LOG_EV, duration, cursor);
+    result.recordedResistance = shot.value(SHOT_LOG_PR, duration, cursor);
+    result.newDelay = volumetric ? process.getNewDelayTime() : options.brewDelay;
+    result.estimatedVolume = pressureController.getcoffeeOutputEstimate();
+    result.puckResistance = pressureController.getPuckResistance();
+    return result;
+}
+
+void printResult(const RecordedShot &shot, const Profile &profile, const ReplayResult &result, const ReplayOptions &options) {
+    const float recordedEnd = static_cast<float>(shot.getDuration()) / 1000.0f;
+    if (options.csv) {
+        char stop[64] = ",,,";
+        if (result.stopped) {
+            snprintf(stop, sizeof(stop), "%.1f,%.2f,%.2f,%.2f", result.stopTime / 1000.0f, result.weightAtStop, result.predicted,
+                     result.predicted - result.target);
+        }
+        printf("%s,%s,%.1f,%.1f,%s,%.2f,%.0f,%.2f,%.2f,%.3f,%.3f\n", shot.name.c_str(), profile.label.c_str(), recordedEnd,
+               result.target, stop, result.finalWeight, result.newDelay, result.estimatedVolume, result.recordedEstimate,
+               result.puckResistance, result.recordedResistance);
+        return;
+    }
+    printf("%s (%s): recorded %.1f s, %.1f g\n", shot.name.c_str(), profile.label.c_str(), recordedEnd, result.finalWeight);
+    for (const auto &[phase, time] : result.transitions) {
+        printf("  %6.1f s  phase %u %s\n", time / 1000.0f, phase, profile.phases.at(phase).name.c_str());
+    }
+    if (result.stopped) {
+        printf("  %6.1f s  stop at %.1f g, %.2f g/s", result.stopTime / 1000.0f, result.weightAtStop, result.rate);
+        if (result.target > 0.0f) {
+            printf(", predicted %.1f g for %.1f g (%+.1f g)", result.predicted, result.target, result.predicted - result.target);
+        }
+        printf("\n");
+    } else {
+        printf("  not stopped before the end of the recording\n");
+    }
+    if (result.target > 0.0f) {
+        printf("  recorded overshoot %+.1f g, brew delay %.0f -> %.0f ms\n", result.finalWeight - result.target,
+               options.brewDelay, result.newDelay);
+    }
+    printf("  estimator: %.1f g (recorded %.1f g), puck resistance %.3f (recorded %.3f)\n", result.estimatedVolume,
+           result.recordedEstimate, result.puckResistance, result.recordedResistance);
+}
+} // namespace
+
+// Usage: program replay [--profile FILE | --profiles DIR] [--delay MS] [--time] [--csv] <shot.dat>...
+//   --profile FILE   profile JSON used for all shots
+//   --profiles DIR   profile JSON files matched to the shots by label, e.g. a copy of /p
+//   --delay MS       predictive scale delay, 1000 ms by default
+//   --time           ignore volumetric targets
+//   --csv            one line per shot instead of the report
+int runReplay(int argc, char **argv) {
+    ReplayOptions options;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--profile") && hasValue) {
+            options.profilePath = argv[++i];
+        } else if (!strcmp(argv[i], "--profiles") && hasValue) {
+            options.profileDirectory = argv[++i];
+        } else if (!strcmp(argv[i], "--delay") && hasValue) {
+            options.brewDelay = strtod(argv[++i], nullptr);
+        } else if (!strcmp(argv[i], "--time")) {
+            options.volumetric = false;
+        } else if (!strcmp(argv[i], "--csv")) {
+            options.csv = true;
+        } else {
+            paths.emplace_back(argv[i]);
+        }
+    }
+
+    std::vector<Profile> profiles;
+    const bool forced = !options.profilePath.empty();
+    if (forced) {
+        profiles.emplace_back();
+        if (!loadProfile(options.profilePath, profiles.back())) {
+            fprintf(stderr, "Failed to load profile %s\n", options.profilePath.c_str());
+            return 1;
+        }
+    } else if (!options.profileDirectory.empty()) {
+        loadProfiles(options.profileDirectory, profiles);
+    }
+    if (paths.empty() || profiles.empty()) {
+        fprintf(stderr, "usage: %s replay [--profile FILE | --profiles DIR] [--delay MS] [--time] [--csv] <shot.dat>...\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (options.csv) {
+        printf("shot,profile,recorded_end_s,target_g,stop_s,weight_at_stop_g,predicted_g,predicted_overshoot_g,final_g,"
+               "new_delay_ms,estimated_g,recorded_estimate_g,puck_resistance,recorded_puck_resistance\n");
+    }
+    const auto wallStarted = std::chrono::steady_clock::now();
+    unsigned int replayed = 0;
+    unsigned int stopped = 0;
+    double recordedSeconds = 0.0;
+    double stopDifference = 0.0;
+    double predictedOvershoot = 0.0;
+    for (const auto &path : paths) {
+        RecordedShot shot;
+        if (!loadShot(path, shot)) {
+            fprintf(stderr, "%s: no samples\n", path.c_str());
+            continue;
+        }
+        const Profile *profile = findProfile(shot, profiles, forced);
+        if (profile == nullptr) {
+            fprintf(stderr, "%s: no profile named \"%s\"\n", path.c_str(), shot.header.profileName);
+            continue;
+        }
+        const ReplayResult result = replay(shot, *profile, options);
+        printResult(shot, *profile, result, options);
+        replayed++;
+        recordedSeconds += shot.getDuration() / 1000.0;
+        if (result.stopped) {
+            stopped++;
+            stopDifference += (static_cast<double>(result.stopTime) - shot.getDuration()) / 1000.0;
+            predictedOvershoot += result.target > 0.0f ? result.predicted - result.target : 0.0f;
+        }
+    }
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStarted).count();
+    fprintf(stderr, "replayed %u shots (%.0f s of brewing) in %.3f s", replayed, recordedSeconds, wallSeconds);
+    if (stopped > 0) {
+        fprintf(stderr, ", %u stopped, mean stop %+.2f s vs recording, mean predicted overshoot %+.2f g", stopped,
+                stopDifference / stopped, predictedOvershoot / stopped);
+    }
+    fprintf(stderr, "\n");
+    return replayed > 0 ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+#ifndef SHOTREPLAY_H
+#define SHOTREPLAY_H
+
+// Feeds recorded shots from /h back through BrewProcess, VolumetricRateCalculator and PressureController on a
+// virtual clock and reports where the current code would change phases and stop, see runReplay for the options.
+int runReplay(int argc, char **argv);
+
+#endif // SHOTREPLAY_H
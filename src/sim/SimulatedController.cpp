@@ -0,0 +1,158 @@
+#include "SimulatedController.h"
+
+#include <Arduino.h>
+#include <algorithm>
+
+SimulatedController::SimulatedController(MachineModel &machine)
+    : machine(machine), pid(&heaterOutput, &temperature, &temperatureSetpoint),
+      pressureController(SIM_PRESSURE_SAMPLE_US / 1000000.0f, &ctrlPressure, &ctrlFlow, &currentPressure, &controllerPower,
+                         &valveStatus) {
+    // Heater::setupPid
+    pid.setSamplingFrequency(SIM_TUNER_OUTPUT_SPAN / 1000.0f);
+    pid.setCtrlOutputLimits(0.0f, SIM_TUNER_OUTPUT_SPAN);
+    pid.activateSetPointFilter(false);
+    pid.activateFeedForward(false);
+    pid.reset();
+    pressureController.setDeliveredPower(&deliveredPower);
+}
+
+void SimulatedController::step() {
+    if (micros() >= nextMainsCycle) {
+        nextMainsCycle += SIM_MAINS_CYCLE_US;
+        psmCycle();
+    }
+    machine.step(SIM_STEP_US / 1000000.0f, MachineInputs{relayStatus, valveStatus != 0, pumpStroke ? 100.0f : 0.0f});
+    host::advanceMicros(SIM_STEP_US);
+    const unsigned long now = millis();
+    if (now - lastHeaterLoop >= SIM_HEATER_INTERVAL_MS) {
+        lastHeaterLoop = now;
+        autotuning ? loopAutotune() : loopHeater();
+    }
+    // Samples land on the 1 ms simulation clock, 7 or 8 ms apart, so the controller sees a varying dt
+    if (micros() >= nextPressureSample) {
+        nextPressureSample += SIM_PRESSURE_SAMPLE_US;
+        const unsigned long sampled = micros();
+        loopPump(std::clamp((sampled - lastPumpLoop) / 1000000.0f, 0.001f, 0.1f)); // DimmedPump::MIN_STEP, MAX_STEP
+        lastPumpLoop = sampled;
+    }
+}
+
+void SimulatedController::setTunings(float Kp, float Ki, float Kd) {
+    if (pid.getKp() != Kp || pid.getKi() != Ki || pid.getKd() != Kd) {
+        pid.setControllerPIDGains(Kp, Ki, Kd, 0.0f);
+        pid.reset();
+    }
+}
+
+void SimulatedController::startAutotune(int goal, int windowSize) {
+    autotuner.setWindowsize(windowSize);
+    autotuner.setEpsilon(0.1f);
+    autotuner.setRequiredConfirmations(3);
+    autotuner.setTuningGoal(goal);
+    autotuner.reset();
+    pid.setMode(SimplePID::Control::manual);
+    lastAutotuneCycle = millis();
+    autotuning = true;
+}
+
+void SimulatedController::setPower(float setpoint) {
+    ctrlPressure = setpoint > 0 ? 20.0f : 0.0f;
+    mode = ControlMode::POWER;
+    power = std::clamp(setpoint, 0.0f, 100.0f);
+    controllerPower = power;
+    if (power == 0.0f) {
+        currentFlow = 0.0f;
+    }
+}
+
+void SimulatedController::setPressureTarget(float targetPressure, float flowLimit) {
+    mode = ControlMode::PRESSURE;
+    ctrlFlow = flowLimit;
+    ctrlPressure = targetPressure;
+    pressureController.setFlowLimit(flowLimit);
+}
+
+void SimulatedController::setFlowTarget(float targetFlow, float pressureLimit) {
+    mode = ControlMode::FLOW;
+    ctrlFlow = targetFlow;
+    ctrlPressure = pressureLimit;
+    pressureController.setPressureLimit(pressureLimit);
+}
+
+void SimulatedController::tare() {
+    pressureController.tare();
+    pressureController.reset();
+}
+
+// Heater::loop and Heater::loopPid
+void SimulatedController::loopHeater() {
+    temperature = machine.readTemperature();
+    if (temperatureSetpoint <= 0.0f) {
+        pid.setMode(SimplePID::Control::manual);
+        relayStatus = false;
+        return;
+    }
+    pid.setMode(SimplePID::Control::automatic);
+    softPwm();
+    pid.update();
+}
+
+// Heater::loopAutotune without blocking the other loops: one tuner cycle per output span, soft PWM in between
+void SimulatedController::loopAutotune() {
+    const unsigned long now = millis();
+    if (now - lastAutotuneCycle >= static_cast<unsigned long>(SIM_TUNER_OUTPUT_SPAN) - 1) {
+        lastAutotuneCycle = now;
+        temperature = machine.readTemperature();
+        heaterOutput = autotuner.maxPowerOn ? SIM_TUNER_OUTPUT_SPAN : 0.0f;
+        autotuner.update(temperature, now / 1000.0f);
+        if (temperature > SIM_MAX_AUTOTUNE_TEMP || autotuner.isFinished()) {
+            heaterOutput = 0.0f;
+            autotuning = false;
+            if (autotuner.isFinished()) {
+                setTunings(autotuner.getKp() * 1000.0f, autotuner.getKi() * 1000.0f, autotuner.getKd() * 1000.0f);
+            }
+        }
+    }
+    softPwm();
+}
+
+// Heater::softPwm
+void SimulatedController::softPwm() {
+    const unsigned long now = millis();
+    if (now - windowStartTime >= static_cast<unsigned long>(SIM_TUNER_OUTPUT_SPAN)) {
+        windowStartTime = now;
+    }
+    const auto onTime = static_cast<unsigned long>(heaterOutput);
+    if (!relayStatus && onTime > now - windowStartTime) {
+        relayStatus = true;
+    } else if (relayStatus && onTime < now - windowStartTime) {
+        relayStatus = false;
+    }
+}
+
+// PSM::calculateSkip: the pump runs whole mains cycles, as many as the integer power asks for on average
+void SimulatedController::psmCycle() {
+    psmAccumulator += static_cast<int>(power);
+    pumpStroke = psmAccumulator >= 100;
+    if (pumpStroke) {
+        psmAccumulator -= 100;
+        pumpStrokes++;
+    }
+}
+
+// DimmedPump::loop and DimmedPump::updatePower
+void SimulatedController::loopPump(float dt) {
+    currentPressure = machine.readPressure();
+    // DimmedPump::countPumpStrokes
+    pumpOnTime += static_cast<float>(pumpStrokes - lastPumpStrokes) * SIM_MAINS_CYCLE_US / 1000000.0f;
+    lastPumpStrokes = pumpStrokes;
+    const float onTime = std::min(pumpOnTime, dt);
+    pumpOnTime -= onTime;
+    deliveredPower = 100.0f * onTime / dt;
+    pressureController.update(static_cast<PressureController::ControlMode>(mode), dt);
+    if (mode != ControlMode::POWER) {
+        power = controllerPower;
+    }
+    const float alpha = dt / (0.27f + dt); // DimmedPump::FLOW_FILTER_TAU
+    currentFlow = alpha * pressureController.getPumFlowRate() + (1.0f - alpha) * currentFlow;
+}
@@ -0,0 +1,94 @@
+#ifndef SIMULATEDCONTROLLER_H
+#define SIMULATEDCONTROLLER_H
+
+#include "MachineModel.h"
+#include <Autotune/Autotune.h>
+#include <PressureController/PressureController.h>
+#include <SimplePID/SimplePID.h>
+
+constexpr unsigned long SIM_STEP_US = 1000;
+constexpr unsigned long SIM_HEATER_INTERVAL_MS = 10;            // Heater::loopTask
+constexpr unsigned long SIM_PRESSURE_SAMPLE_US = 1000000 / 128; // PressureSensor, one pump control step per sample
+constexpr unsigned long SIM_MAINS_CYCLE_US = 20000;             // 50 Hz, one PSM decision per cycle with its divider of 2
+constexpr float SIM_TUNER_OUTPUT_SPAN = 1000.0f;
+constexpr float SIM_MAX_AUTOTUNE_TEMP = 125.0f;
+constexpr double SIM_BREW_DELAY_MS = 1000.0; // default of the predictive scale delay setting
+
+// The heater and pump control loops of the controller board, wired up like Heater and DimmedPump but driving the
+// machine model instead of the SSRs. The pump runs on whole mains cycles like behind the PSM.
+class SimulatedController {
+  public:
+    explicit SimulatedController(MachineModel &machine);
+
+    // Advances the simulated clock by one step and runs the control loops that are due
+    void step();
+
+    void setTemperatureTarget(float setpoint) { temperatureSetpoint = setpoint; }
+    void setTunings(float Kp, float Ki, float Kd);
+    void startAutotune(int goal, int windowSize);
+    bool isAutotuning() const { return autotuning; }
+
+    void setPower(float setpoint);
+    void setPressureTarget(float targetPressure, float flowLimit);
+    void setFlowTarget(float targetFlow, float pressureLimit);
+    void setValveState(bool open) { valveStatus = open; }
+    void setPumpFlowCoeff(float oneBarFlow, float nineBarFlow) { pressureController.setPumpFlowCoeff(oneBarFlow, nineBarFlow); }
+    void setPumpFlowPolyCoeffs(float a, float b, float c, float d) { pressureController.setPumpFlowPolyCoeffs(a, b, c, d); }
+    void tare();
+
+    float getPressure() const { return currentPressure; }
+    float getTemperature() const { return temperature; }
+    float getPumpFlow() const { return currentFlow; }
+    float getPuckFlow() { return pressureController.getCoffeeFlowRate(); }
+    float getCoffeeVolume() { return pressureController.getcoffeeOutputEstimate(); }
+    float getPumpPower() const { return power; }
+    bool isHeating() const { return relayStatus; }
+    bool isValveOpen() const { return valveStatus; }
+    const Autotune &getAutotune() const { return autotuner; }
+
+  private:
+    enum class ControlMode { POWER, PRESSURE, FLOW };
+
+    void loopHeater();
+    void loopAutotune();
+    void softPwm();
+    void loopPump(float dt);
+    void psmCycle();
+
+    MachineModel &machine;
+    unsigned long lastHeaterLoop = 0;
+    unsigned long nextPressureSample = 0; // us
+    unsigned long lastPumpLoop = 0;       // us
+    unsigned long nextMainsCycle = 0;     // us
+
+    SimplePID pid;
+    Autotune autotuner;
+    float temperature = 0.0f;
+    float heaterOutput = 0.0f;
+    float temperatureSetpoint = 0.0f;
+    bool relayStatus = false;
+    unsigned long windowStartTime = 0;
+    bool autotuning = false;
+    unsigned long lastAutotuneCycle = 0;
+
+    // Declared before the pressure controller, which reads them on construction
+    ControlMode mode = ControlMode::POWER;
+    float power = 0.0f;
+    float controllerPower = 0.0f;
+    float ctrlPressure = 0.0f;
+    float ctrlFlow = 0.0f;
+    float currentPressure = 0.0f;
+    float currentFlow = 0.0f;
+    int valveStatus = 0;
+    PressureController pressureController;
+
+    // PSM
+    int psmAccumulator = 0;
+    bool pumpStroke = false;
+    long pumpStrokes = 0;
+    long lastPumpStrokes = 0;
+    float pumpOnTime = 0.0f; // s of counted strokes not yet attributed to a step
+    float deliveredPower = 0.0f;
+};
+
+#endif // SIMULATEDCONTROLLER_H
@@ -0,0 +1,26 @@
+#include "Arduino.h"
+
+namespace {
+uint64_t now = 0;
+} // namespace
+
+HostSerial Serial;
+
+unsigned long millis() { return static_cast<unsigned long>(now / 1000); }
+
+unsigned long micros() { return static_cast<unsigned long>(now); }
+
+void delay(unsigned long ms) { now += static_cast<uint64_t>(ms) * 1000; }
+
+void host::advanceMicros(uint64_t us) { now += us; }
+
+size_t HostSerial::printf(const char *format, ...) {
+    if (!enabled) {
+        return 0;
+    }
+    va_list args;
+    va_start(args, format);
+    const int written = vfprintf(stderr, format, args);
+    va_end(args);
+    return written > 0 ? static_cast<size_t>(written) : 0;
+}
@@ -0,0 +1,74 @@
+// Minimal stand-in for the Arduino core for the native simulator build. Time only moves when the simulation advances
+// it, so control code that reads millis() and micros() runs against simulated time.
+#ifndef SIM_HOST_ARDUINO_H
+#define SIM_HOST_ARDUINO_H
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#define HIGH 0x1
+#define LOW 0x0
+#define OUTPUT 0x03
+
+#define PI 3.1415926535897932384626433832795
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+namespace host {
+// Advances the simulated clock
+void advanceMicros(uint64_t us);
+} // namespace host
+
+// Output is discarded until begin() is called, the controllers print on every update
+class HostSerial {
+  public:
+    void begin(unsigned long) { enabled = true; }
+    bool isEnabled() const { return enabled; }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+  private:
+    bool enabled = false;
+};
+
+extern HostSerial Serial;
+
+#define HOST_LOG(level, tag, format, ...)                                                                                   \
+    do {                                                                                                                   \
+        if (Serial.isEnabled())                                                                                            \
+            Serial.printf("[%8lu][" level "][%s] " format "\n", millis(), tag, ##__VA_ARGS__);                              \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HOST_LOG("D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)
+
+// Covers the parts of the Arduino String API used by the models, ArduinoJson is built with
+// ARDUINOJSON_ENABLE_ARDUINO_STRING so as<String>() works like on the device
+class String : public std::string {
+  public:
+    String() = default;
+    String(const char *str) : std::string(str != nullptr ? str : "") {}
+    String(const std::string &str) : std::string(str) {}
+
+    unsigned char concat(const char *str) { return concat(str, strlen(str)); }
+    unsigned char concat(const char *str, size_t length) {
+        append(str, length);
+        return 1;
+    }
+    bool isEmpty() const { return empty(); }
+};
+
+#endif // SIM_HOST_ARDUINO_H
@@ -0,0 +1,7 @@
+// Included by the NayrodPID sources when ARDUINO is not defined
+#ifndef SIM_HOST_ARDUINOSTUB_H
+#define SIM_HOST_ARDUINOSTUB_H
+
+#include "Arduino.h"
+
+#endif // SIM_HOST_ARDUINOSTUB_H
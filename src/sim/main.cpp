@@ -0,0 +1,266 @@
+// Runs complete shots against a simulated machine: the heater PID, the pressure controller and the brew process
+// step in simulated time, thousands of times faster than on the machine.
+//
+// Build and run on the host:
+//   pio run -e native
+//   .pio/build/native/program [options]
+//   .pio/build/native/program replay [options] <shot.dat>...   see ShotReplay.cpp
+//
+// Options:
+//   --shots N          shots to pull back to back (default 1)
+//   --profile FILE     profile JSON as exported from the web UI, a 9 bar 1:2 shot otherwise
+//   --time             stop on the phase durations, ignore volumetric targets
+//   --rest S           seconds between shots (default 30)
+//   --warmup S         seconds to heat up from room temperature before the first shot (default 600)
+//   --seed N           seed for the sensor noise (default 1)
+//   --trace FILE       CSV trace of every 100 ms of all shots
+//   --autotune         run the heater autotune during warmup and report the gains
+//   --calibrate        learn the pump flow model from the weight of each shot like a display with a Bluetooth scale
+//   --pump-flow A,B    flow of the simulated pump at 1 and 9 bar in ml/s (default 10.0,5.8)
+//   --verbose          print the controller logs
+
+#include "MachineModel.h"
+#include "ProfileLoader.h"
+#include "ShotReplay.h"
+#include "SimulatedController.h"
+
+#include <display/core/PumpModelCalibrator.h>
+#include <display/core/constants.h>
+#include <display/core/process/BrewProcess.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+struct Options {
+    unsigned int shots = 1;
+    std::string profilePath;
+    bool volumetric = true;
+    unsigned long restSeconds = 30;
+    unsigned long warmupSeconds = 600;
+    uint32_t seed = 1;
+    std::string tracePath;
+    bool autotune = false;
+    bool calibrate = false;
+    MachineParameters machine;
+    bool verbose = false;
+};
+
+struct ShotResult {
+    float duration = 0.0f; // s, until the process finished
+    float weight = 0.0f;   // g in the cup when the process completed
+    float targetWeight = 0.0f;
+    float maxPressure = 0.0f;
+    float pressureError = 0.0f; // bar, RMS during pressure targets
+    float startTemperature = 0.0f;
+    float minTemperature = 0.0f;
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--shots") && hasValue) {
+            options.shots = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--profile") && hasValue) {
+            options.profilePath = argv[++i];
+        } else if (!strcmp(argv[i], "--time")) {
+            options.volumetric = false;
+        } else if (!strcmp(argv[i], "--rest") && hasValue) {
+            options.restSeconds = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--warmup") && hasValue) {
+            options.warmupSeconds = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--seed") && hasValue) {
+            options.seed = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--trace") && hasValue) {
+            options.tracePath = argv[++i];
+        } else if (!strcmp(argv[i], "--autotune")) {
+            options.autotune = true;
+        } else if (!strcmp(argv[i], "--calibrate")) {
+            options.calibrate = true;
+        } else if (!strcmp(argv[i], "--pump-flow") && hasValue) {
+            if (sscanf(argv[++i], "%f,%f", &options.machine.pumpFlowOneBar, &options.machine.pumpFlowNineBar) != 2) {
+                fprintf(stderr, "Invalid pump flow %s\n", argv[i]);
+                return false;
+            }
+        } else if (!strcmp(argv[i], "--verbose")) {
+            options.verbose = true;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+void runFor(SimulatedController &controller, unsigned long ms) {
+    for (unsigned long i = 0; i < ms * 1000 / SIM_STEP_US; i++) {
+        controller.step();
+    }
+}
+
+// Sends the outputs of the brew process like Controller::updateControl does for a machine with pressure control
+void applyOutputs(BrewProcess &process, SimulatedController &controller) {
+    if (process.isAdvancedPump()) {
+        if (process.getPumpTarget() == PumpTarget::PUMP_TARGET_PRESSURE) {
+            controller.setPressureTarget(process.getPumpPressure(), process.getPumpFlow());
+        } else {
+            controller.setFlowTarget(process.getPumpFlow(), process.getPumpPressure());
+        }
+    } else {
+        controller.setPower(process.isActive() ? process.getPumpValue() : 0.0f);
+    }
+    controller.setValveState(process.isActive() && process.isRelayActive());
+    controller.setTemperatureTarget(process.getTemperature());
+}
+
+ShotResult pullShot(const Profile &profile, bool volumetric, MachineModel &machine, SimulatedController &controller,
+                    PumpModelCalibrator *calibrator, FILE *trace, unsigned int shot) {
+    ShotResult result;
+    machine.newShot();
+    controller.tare();
+    result.startTemperature = machine.getBoilerTemperature();
+    result.minTemperature = result.startTemperature;
+
+    BrewProcess process(profile, volumetric ? ProcessTarget::VOLUMETRIC : ProcessTarget::TIME, SIM_BREW_DELAY_MS);
+    result.targetWeight = volumetric ? static_cast<float>(process.getBrewVolume()) : 0.0f;
+    const unsigned long started = millis();
+    float squaredError = 0.0f;
+    unsigned int pressureSamples = 0;
+    applyOutputs(process, controller);
+    if (calibrator != nullptr) {
+        calibrator->startShot();
+    }
+
+    while (!process.isComplete() && millis() - started < BREW_SAFETY_DURATION_MS + PREDICTIVE_TIME) {
+        runFor(controller, PROGRESS_INTERVAL);
+        const bool wasActive = process.isActive();
+        process.updatePressure(controller.getPressure());
+        process.updateFlow(controller.getPumpFlow());
+        if (volumetric) {
+            process.updateVolume(machine.readWeight());
+        }
+        if (wasActive && process.isAdvancedPump() && process.getPumpTarget() == PumpTarget::PUMP_TARGET_PRESSURE &&
+            !process.isInTransition()) {
+            const float error = machine.getPressure() - process.getPumpPressure();
+            squaredError += error * error;
+            pressureSamples++;
+        }
+        if (calibrator != nullptr && wasActive) {
+            calibrator->addSample(millis(), controller.getPressure(), controller.getPumpFlow(), machine.readWeight());
+        }
+        process.progress();
+        applyOutputs(process, controller);
+        if (wasActive && !process.isActive()) {
+            result.duration = static_cast<float>(millis() - started) / 1000.0f;
+        }
+
+        result.maxPressure = std::max(result.maxPressure, machine.getPressure());
+        result.minTemperature = std::min(result.minTemperature, machine.getBoilerTemperature());
+        if (trace != nullptr) {
+            fprintf(trace, "%u,%lu,%u,%d,%.1f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n", shot, millis() - started,
+                    process.phaseIndex, controller.isValveOpen(), controller.getPumpPower(), process.getPumpPressure(),
+                    machine.getPressure(), process.getPumpFlow(), controller.getPumpFlow(), machine.getPumpFlow(),
+                    machine.getPuckFlow(), machine.getWeight(), machine.getBoilerTemperature());
+        }
+    }
+    if (result.duration == 0.0f) {
+        result.duration = static_cast<float>(millis() - started) / 1000.0f;
+    }
+    result.weight = machine.getWeight();
+    // Controller::updatePumpModelCalibration
+    if (calibrator != nullptr && calibrator->finishShot()) {
+        const auto &coefficients = calibrator->getCoefficients();
+        controller.setPumpFlowPolyCoeffs(coefficients[0], coefficients[1], coefficients[2], coefficients[3]);
+    }
+    result.pressureError = pressureSamples > 0 ? std::sqrt(squaredError / static_cast<float>(pressureSamples)) : 0.0f;
+    return result;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "replay")) {
+        return runReplay(argc - 1, argv + 1);
+    }
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+    if (options.verbose) {
+        Serial.begin(115200);
+    }
+    Profile profile = defaultProfile();
+    if (!options.profilePath.empty() && !loadProfile(options.profilePath, profile)) {
+        fprintf(stderr, "Failed to load profile %s\n", options.profilePath.c_str());
+        return 1;
+    }
+    const bool volumetric = options.volumetric && profile.phases.back().hasVolumetricTarget();
+
+    FILE *trace = nullptr;
+    if (!options.tracePath.empty()) {
+        trace = fopen(options.tracePath.c_str(), "w");
+        if (trace == nullptr) {
+            fprintf(stderr, "Failed to open %s\n", options.tracePath.c_str());
+            return 1;
+        }
+        fprintf(trace, "shot,time_ms,phase,valve,pump_power,target_pressure,pressure,target_flow,estimated_pump_flow,"
+                       "pump_flow,puck_flow,weight,boiler_temperature\n");
+    }
+
+    const auto wallStarted = std::chrono::steady_clock::now();
+    MachineModel machine(options.machine, options.seed);
+    SimulatedController controller(machine);
+    controller.setPumpFlowCoeff(10.205f, 5.521f);     // DEFAULT_PUMP_MODEL_COEFFS
+    controller.setTunings(58.397f, 1.027f, 249.055f); // DEFAULT_PID
+    controller.setTemperatureTarget(profile.temperature);
+    if (options.autotune) {
+        controller.startAutotune(50, 4);
+        while (controller.isAutotuning()) {
+            runFor(controller, PROGRESS_INTERVAL);
+        }
+        const Autotune &autotune = controller.getAutotune();
+        printf("autotune: Kp=%.3f Ki=%.3f Kd=%.3f delay=%.2fs gain=%.4f\n", autotune.getKp() * 1000.0f,
+               autotune.getKi() * 1000.0f, autotune.getKd() * 1000.0f, autotune.getSystemDelay(), autotune.getSystemGain());
+    }
+    runFor(controller, options.warmupSeconds * 1000);
+    PumpModelCalibrator calibrator;
+
+    printf("shot  duration  weight  target  max bar  bar rms  temp start  temp min\n");
+    double weightError = 0.0;
+    double pressureError = 0.0;
+    for (unsigned int shot = 0; shot < options.shots; shot++) {
+        const ShotResult result =
+            pullShot(profile, volumetric, machine, controller, options.calibrate ? &calibrator : nullptr, trace, shot);
+        printf("%4u  %7.1fs  %5.1fg  %5.1fg  %7.2f  %7.2f  %10.1f  %8.1f\n", shot, result.duration, result.weight,
+               result.targetWeight, result.maxPressure, result.pressureError, result.startTemperature,
+               result.minTemperature);
+        if (options.calibrate) {
+            char coefficients[64];
+            calibrator.format(coefficients, sizeof(coefficients));
+            printf("      pump model %s from %zu blocks\n", coefficients, calibrator.getBlocks());
+        }
+        weightError += std::fabs(result.weight - result.targetWeight);
+        pressureError += result.pressureError;
+        runFor(controller, options.restSeconds * 1000);
+    }
+    if (trace != nullptr) {
+        fclose(trace);
+    }
+
+    const double wallSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStarted).count();
+    const double simulatedSeconds = millis() / 1000.0;
+    if (options.shots > 0) {
+        printf("mean pressure rms %.3f bar\n", pressureError / options.shots);
+        if (volumetric) {
+            printf("mean weight error %.2fg\n", weightError / options.shots);
+        }
+    }
+    printf("simulated %.0fs in %.2fs, %.0fx real time\n", simulatedSeconds, wallSeconds,
+           wallSeconds > 0.0 ? simulatedSeconds / wallSeconds : 0.0);
+    return 0;
+}
@@ -76,6 +76,9 @@ export function Settings() {
       if (key === 'delayAdjust') {
         value = !formData.delayAdjust;
       }
+      if (key === 'pumpModelAdjust') {
+        value = !formData.pumpModelAdjust;
+      }
       if (key === 'clock24hFormat') {
         value = !formData.clock24hFormat;
       }
@@ -257,6 +260,67 @@ export function Settings() {
               />
             </div>
 
+            <div className='form-control'>
+              <label htmlFor='historyTolerance' className='mb-2 block text-sm font-medium'>
+                Shot History Compression (%)
+              </label>
+              <div className='mb-2 text-xs opacity-70'>
+                How much recorded values may deviate to save space. 100% allows 0.2 °C, 0.05 bar and
+                0.1 g, 0% keeps every change.
+              </div>
+              <input
+                id='historyTolerance'
+                name='historyTolerance'
+                type='number'
+                className='input input-bordered w-full'
+                placeholder='100'
+                min='0'
+                value={formData.historyTolerance}
+                onChange={onChange('historyTolerance')}
+              />
+            </div>
+
+            <div className='form-control'>
+              <label htmlFor='historySampleRate' className='mb-2 block text-sm font-medium'>
+                Shot History Sample Rate (Hz)
+              </label>
+              <div className='mb-2 text-xs opacity-70'>
+                How often values are sampled while recording a shot, between 4 and 20.
+              </div>
+              <input
+                id='historySampleRate'
+                name='historySampleRate'
+                type='number'
+                className='input input-bordered w-full'
+                placeholder='10'
+                min='4'
+                max='20'
+                value={formData.historySampleRate}
+                onChange={onChange('historySampleRate')}
+              />
+            </div>
+
+            <div className='form-control'>
+              <label htmlFor='controlInterval' className='mb-2 block text-sm font-medium'>
+                Control Update Interval (ms)
+              </label>
+              <div className='mb-2 text-xs opacity-70'>
+                Setpoints are sent right away when a phase or mode changes. Otherwise they are
+                refreshed at this interval, between 50 and 1000.
+              </div>
+              <input
+                id='controlInterval'
+                name='controlInterval'
+                type='number'
+                className='input input-bordered w-full'
+                placeholder='250'
+                min='50'
+                max='1000'
+                value={formData.controlInterval}
+                onChange={onChange('controlInterval')}
+              />
+            </div>
+
             <div className='divider'>Predictive scale delay</div>
             <div className='mb-2 text-sm opacity-70'>
               Shuts off the process ahead of time based on the flow rate to account for any dripping
@@ -473,7 +537,8 @@ export function Settings() {
 
             <div className='form-control'>
               <label htmlFor='pumpModelCoeffs' className='mb-2 block text-sm font-medium'>
-                Pump Flow Coefficients <small>Enter 2 values (flow at 1bar, flow at 9bar)</small>
+                Pump Flow Coefficients{' '}
+                <small>Enter 2 values (flow at 1bar, flow at 9bar) or 4 polynomial coefficients</small>
               </label>
               <input
                 id='pumpModelCoeffs'
@@ -486,6 +551,24 @@ export function Settings() {
               />
             </div>
 
+            <div className='form-control'>
+              <label className='label cursor-pointer'>
+                <span className='label-text'>Auto Adjust Pump Flow</span>
+                <input
+                  id='pumpModelAdjust'
+                  name='pumpModelAdjust'
+                  value='pumpModelAdjust'
+                  type='checkbox'
+                  className='toggle toggle-primary'
+                  checked={!!formData.pumpModelAdjust}
+                  onChange={onChange('pumpModelAdjust')}
+                />
+              </label>
+              <div className='text-sm opacity-70'>
+                Learns the coefficients from shots weighed by a Bluetooth scale.
+              </div>
+            </div>
+
             <div className='form-control'>
               <label htmlFor='temperatureOffset' className='mb-2 block text-sm font-medium'>
                 Temperature Offset
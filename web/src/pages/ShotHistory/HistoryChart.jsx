@@ -11,7 +11,7 @@ function getChartData(data) {
           label: 'Current Temperature',
           borderColor: '#F0561D',
           pointStyle: false,
-          data: data.map((i, idx) => ({ x: (i.t / 1000).toFixed(1), y: i.ct })),
+          data: data.map((i, idx) => ({ x: i.t / 1000, y: i.ct })),
         },
         {
           label: 'Target Temperature',
@@ -19,14 +19,14 @@ function getChartData(data) {
           borderColor: '#731F00',
           borderDash: [6, 6],
           pointStyle: false,
-          data: data.map((i, idx) => ({ x: (i.t / 1000).toFixed(1), y: i.tt })),
+          data: data.map((i, idx) => ({ x: i.t / 1000, y: i.tt })),
         },
         {
           label: 'Current Pressure',
           borderColor: '#0066CC',
           pointStyle: false,
           yAxisID: 'y1',
-          data: data.map((i, idx) => ({ x: (i.t / 1000).toFixed(1), y: i.cp })),
+          data: data.map((i, idx) => ({ x: i.t / 1000, y: i.cp })),
         },
         {
           label: 'Target Pressure',
@@ -35,21 +35,21 @@ function getChartData(data) {
           borderDash: [6, 6],
           pointStyle: false,
           yAxisID: 'y1',
-          data: data.map((i, idx) => ({ x: (i.t / 1000).toFixed(1), y: i.tp })),
+          data: data.map((i, idx) => ({ x: i.t / 1000, y: i.tp })),
         },
         {
           label: 'Current Pump Flow',
           borderColor: '#63993D',
           pointStyle: false,
           yAxisID: 'y1',
-          data: data.map((i, idx) => ({ x: (i.t / 1000).toFixed(1), y: i.fl })),
+          data: data.map((i, idx) => ({ x: i.t / 1000, y: i.fl })),
         },
         {
           label: 'Current Puck Flow',
           borderColor: '#204D00',
           pointStyle: false,
           yAxisID: 'y1',
-          data: data.map((i, idx) => ({ x: (i.t / 1000).toFixed(1), y: i.pf })),
+          data: data.map((i, idx) => ({ x: i.t / 1000, y: i.pf })),
         },
         {
           label: 'Target Pump Flow',
@@ -57,7 +57,7 @@ function getChartData(data) {
           borderDash: [6, 6],
           pointStyle: false,
           yAxisID: 'y1',
-          data: data.map((i, idx) => ({ x: (i.t / 1000).toFixed(1), y: i.tf })),
+          data: data.map((i, idx) => ({ x: i.t / 1000, y: i.tf })),
         },
       ],
     },
@@ -111,6 +111,7 @@ function getChartData(data) {
           },
         },
         x: {
+          type: 'linear',
           ticks: {
             source: 'auto',
             font: {
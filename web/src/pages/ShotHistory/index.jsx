@@ -23,22 +23,31 @@ import { ApiServiceContext, machine } from '../../services/ApiService.js';
 import { useCallback, useEffect, useState, useContext } from 'preact/hooks';
 import { computed } from '@preact/signals';
 import { Spinner } from '../../components/Spinner.jsx';
-import { parseHistoryData } from './utils.js';
+import { parseHistoryData, parseHistoryIndex } from './utils.js';
 import HistoryCard from './HistoryCard.jsx';
 
 const connected = computed(() => machine.value.connected);
+const PAGE_SIZE = 10;
 
 export function ShotHistory() {
   const apiService = useContext(ApiServiceContext);
   const [history, setHistory] = useState([]);
+  const [total, setTotal] = useState(0);
   const [loading, setLoading] = useState(true);
-  const loadHistory = async () => {
-    const response = await apiService.request({ tp: 'req:history:list' });
-    const history = response.history
-      .map(parseHistoryData)
-      .filter(e => !!e)
-      .reverse();
-    setHistory(history);
+  const loadHistory = async (offset = 0) => {
+    // The index arrives first, sample data for each shot is streamed afterwards
+    const onData = (id, binary) => {
+      const data = parseHistoryData({ id, binary });
+      if (!data) return;
+      setHistory(entries => entries.map(entry => (entry.id === id ? { ...entry, ...data } : entry)));
+    };
+    const response = await apiService.request(
+      { tp: 'req:history:list', offset, limit: PAGE_SIZE, data: true },
+      onData,
+    );
+    const page = response.history.map(parseHistoryIndex);
+    setHistory(entries => (offset === 0 ? page : [...entries, ...page]));
+    setTotal(response.total || 0);
     setLoading(false);
   };
   useEffect(() => {
@@ -71,9 +80,16 @@ export function ShotHistory() {
       </div>
 
       <div className='grid grid-cols-1 gap-4 lg:grid-cols-12'>
-        {history.map((item, idx) => (
-          <HistoryCard shot={item} key={idx} onDelete={id => onDelete(id)} />
+        {history.map(item => (
+          <HistoryCard shot={item} key={item.id} onDelete={id => onDelete(id)} />
         ))}
+        {history.length < total && (
+          <div className='flex flex-row items-center justify-center lg:col-span-12'>
+            <button className='btn btn-outline' onClick={() => loadHistory(history.length)}>
+              Load more
+            </button>
+          </div>
+        )}
         {history.length === 0 && (
           <div className='flex flex-row items-center justify-center py-20 lg:col-span-12'>
             <span>No shots available</span>
@@ -1,9 +1,65 @@
-export function parseHistoryData(shot) {
-  const data = {
-    id: shot.id,
-  };
-  if (!shot.history) return null;
-  const lines = shot.history.split('\n');
+// Binary shot log layout, see src/display/models/shot_log.h
+const SHOT_LOG_MAGIC = 0x48534d47;
+const SHOT_LOG_CHANNELS = ['tt', 'ct', 'tp', 'cp', 'fl', 'tf', 'pf', 'vf', 'v', 'ev', 'pr'];
+const SHOT_LOG_PROFILE_OFFSET = 40;
+const SHOT_LOG_PROFILE_LENGTH = 32;
+const SHOT_LOG_BLOCK_HEADER_SIZE = 4;
+
+function crc16(bytes) {
+  let crc = 0xffff;
+  for (let i = 0; i < bytes.length; i++) {
+    crc ^= bytes[i] << 8;
+    for (let bit = 0; bit < 8; bit++) {
+      crc = crc & 0x8000 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+    }
+  }
+  return crc;
+}
+
+function parseBinaryHistory(bytes, data) {
+  const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+  const version = view.getUint16(4, true);
+  const headerSize = view.getUint16(6, true);
+  const timeUnit = view.getUint16(10, true);
+  const channelCount = view.getUint16(16, true);
+  const scales = [];
+  for (let i = 0; i < channelCount; i++) {
+    scales.push(view.getUint16(18 + i * 2, true));
+  }
+  const profileStart = SHOT_LOG_PROFILE_OFFSET;
+  let profileEnd = profileStart;
+  while (profileEnd < profileStart + SHOT_LOG_PROFILE_LENGTH && bytes[profileEnd] !== 0) {
+    profileEnd++;
+  }
+  data['version'] = String(version);
+  data['profile'] = new TextDecoder().decode(bytes.subarray(profileStart, profileEnd));
+  data['timestamp'] = view.getUint32(12, true);
+  data['samples'] = [];
+
+  const recordSize = 2 + channelCount * 2;
+  let offset = headerSize;
+  while (offset + SHOT_LOG_BLOCK_HEADER_SIZE <= bytes.length) {
+    const count = view.getUint16(offset, true);
+    const crc = view.getUint16(offset + 2, true);
+    const start = offset + SHOT_LOG_BLOCK_HEADER_SIZE;
+    const end = start + count * recordSize;
+    // A torn or corrupt block ends the readable part of the shot
+    if (count === 0 || end > bytes.length || crc16(bytes.subarray(start, end)) !== crc) {
+      break;
+    }
+    for (let record = start; record < end; record += recordSize) {
+      const sample = { t: view.getUint16(record, true) * timeUnit };
+      for (let i = 0; i < channelCount && i < SHOT_LOG_CHANNELS.length; i++) {
+        sample[SHOT_LOG_CHANNELS[i]] = view.getInt16(record + 2 + i * 2, true) / scales[i];
+      }
+      data['samples'].push(sample);
+    }
+    offset = end;
+  }
+}
+
+function parseCsvHistory(history, data) {
+  const lines = history.split('\n');
   const header = lines[0].split(',');
   data['version'] = header[0];
   data['profile'] = header[1];
@@ -29,8 +85,48 @@ export function parseHistoryData(shot) {
       pr: parseFloat(numbers[11]),
     });
   }
+}
+
+function isBinaryHistory(bytes) {
+  if (bytes.length < 4) {
+    return false;
+  }
+  return new DataView(bytes.buffer, bytes.byteOffset, 4).getUint32(0, true) === SHOT_LOG_MAGIC;
+}
+
+// Index entries from req:history:list, samples are filled in once the shot data is streamed
+export function parseHistoryIndex(shot) {
+  return {
+    id: shot.id,
+    profile: shot.profile,
+    timestamp: shot.timestamp,
+    duration: shot.duration,
+    volume: shot.volume,
+    peakPressure: shot.peakPressure,
+    avgTemperature: shot.avgTemperature,
+    rating: shot.rating,
+    samples: [],
+  };
+}
+
+export function parseHistoryData(shot) {
+  const data = {
+    id: shot.id,
+  };
+  if (shot.binary) {
+    // Shots recorded before the binary format are streamed as their original CSV contents
+    if (isBinaryHistory(shot.binary)) {
+      parseBinaryHistory(shot.binary, data);
+    } else {
+      parseCsvHistory(new TextDecoder().decode(shot.binary), data);
+    }
+  } else if (shot.history) {
+    parseCsvHistory(shot.history, data);
+  } else {
+    return null;
+  }
 
-  if (data['samples']) {
+  if (data['samples'].length) {
     const lastSample = data['samples'][data['samples'].length - 1];
     data.duration = lastSample.t;
     data.volume = lastSample.v;
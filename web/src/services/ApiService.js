@@ -2,6 +2,12 @@ import { createContext } from 'preact';
 import { signal } from '@preact/signals';
 import uuidv4 from '../utils/uuid.js';
 
+// Binary websocket frame types, see WebUIPlugin.h
+const BINARY_HISTORY_CHUNK = 0x01;
+const BINARY_HISTORY_END = 0x02;
+const BINARY_HISTORY_STREAM_END = 0x03;
+const textDecoder = new TextDecoder();
+
 function randomId() {
   return Math.random()
     .toString(36)
@@ -12,6 +18,7 @@ function randomId() {
 export default class ApiService {
   socket = null;
   listeners = {};
+  streams = {};
   reconnectAttempts = 0;
   maxReconnectDelay = 30000; // Maximum delay of 30 seconds
   baseReconnectDelay = 1000; // Start with 1 second delay
@@ -35,6 +42,7 @@ export default class ApiService {
       const apiHost = window.location.host;
       const wsProtocol = window.location.protocol === 'https:' ? 'wss://' : 'ws://';
       this.socket = new WebSocket(`${wsProtocol}${apiHost}/ws`);
+      this.socket.binaryType = 'arraybuffer';
 
       this.socket.addEventListener('message', this._onMessage.bind(this));
       this.socket.addEventListener('close', this._onClose.bind(this));
@@ -93,6 +101,10 @@ export default class ApiService {
   }
 
   _onMessage(event) {
+    if (event.data instanceof ArrayBuffer) {
+      this._onBinary(event.data);
+      return;
+    }
     const message = JSON.parse(event.data);
     const listeners = Object.values(this.listeners[message.tp] || {});
     if (message.tp === 'evt:status') {
@@ -103,6 +115,38 @@ export default class ApiService {
     }
   }
 
+  _onBinary(buffer) {
+    const bytes = new Uint8Array(buffer);
+    const type = bytes[0];
+    let offset = 1;
+    const ridLength = bytes[offset++];
+    const rid = textDecoder.decode(bytes.subarray(offset, offset + ridLength));
+    offset += ridLength;
+    const idLength = bytes[offset++];
+    const id = textDecoder.decode(bytes.subarray(offset, offset + idLength));
+    offset += idLength;
+
+    const stream = this.streams[rid];
+    if (!stream) {
+      return;
+    }
+    if (type === BINARY_HISTORY_CHUNK) {
+      (stream.parts[id] = stream.parts[id] || []).push(bytes.slice(offset));
+    } else if (type === BINARY_HISTORY_END) {
+      const parts = stream.parts[id] || [];
+      delete stream.parts[id];
+      const data = new Uint8Array(parts.reduce((sum, part) => sum + part.length, 0));
+      let position = 0;
+      for (const part of parts) {
+        data.set(part, position);
+        position += part.length;
+      }
+      stream.onData(id, data);
+    } else if (type === BINARY_HISTORY_STREAM_END) {
+      delete this.streams[rid];
+    }
+  }
+
   send(event) {
     if (this.socket && this.socket.readyState === WebSocket.OPEN) {
       this.socket.send(JSON.stringify(event));
@@ -111,7 +155,8 @@ export default class ApiService {
     }
   }
 
-  async request(data = {}) {
+  // onData(id, bytes) is called for every binary payload the firmware streams after the response
+  async request(data = {}, onData = null) {
     if (!this.socket || this.socket.readyState !== WebSocket.OPEN) {
       throw new Error('WebSocket is not connected');
     }
@@ -119,12 +164,19 @@ export default class ApiService {
     const returnType = `res:${data.tp.substring(4)}`;
     const rid = uuidv4();
     const message = { ...data, rid };
+    if (onData) {
+      this.streams[rid] = { onData, parts: {} };
+    }
     return new Promise((resolve, reject) => {
       // Create a listener for the response with matching rid
       const listenerId = this.on(returnType, response => {
         if (response.rid === rid) {
           // Clean up the listener
           this.off(returnType, listenerId);
+          clearTimeout(timeout);
+          if (response.error || !response.stream) {
+            delete this.streams[rid];
+          }
           resolve(response);
         }
       });
@@ -133,8 +185,9 @@ export default class ApiService {
       this.send(message);
 
       // Optional: Add timeout
-      setTimeout(() => {
+      const timeout = setTimeout(() => {
         this.off(returnType, listenerId);
+        delete this.streams[rid];
         reject(new Error(`Request ${data.tp} timed out`));
       }, 30000); // 30 second timeout
     });
@@ -165,10 +218,14 @@ export default class ApiService {
       brewTarget: message.bt || 0,
       volumetricAvailable: message.bta || false,
       process: message.process || null,
+      recorder: message.hr
+        ? { samples: message.hr.s, dropped: message.hr.d, late: message.hr.l, peakQueue: message.hr.q }
+        : null,
       timestamp: new Date(),
     };
     const historyEntry = { ...newStatus };
     delete historyEntry.process;
+    delete historyEntry.recorder;
     const newValue = {
       ...machine.value,
       connected: true,